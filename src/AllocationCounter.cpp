@@ -0,0 +1,53 @@
+#include "AllocationCounter.h"
+
+#ifdef CLP_COUNT_ALLOCATIONS
+namespace {
+    std::atomic<uint64_t> allocationCount = 0, allocatedBytes = 0;
+}
+
+// These replace the allocation functions for the whole program, which then pays one relaxed
+// atomic add per allocation.
+void* operator new(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+
+    if (void* memory = std::malloc(size != 0 ? size : 1)) return memory;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+bool AllocationCounter::enabled() {
+    return true;
+}
+
+AllocationCounter::Snapshot AllocationCounter::snapshot() {
+    return { allocationCount.load(std::memory_order_relaxed), allocatedBytes.load(std::memory_order_relaxed) };
+}
+#else
+bool AllocationCounter::enabled() {
+    return false;
+}
+
+AllocationCounter::Snapshot AllocationCounter::snapshot() {
+    return {};
+}
+#endif
@@ -0,0 +1,16 @@
+#pragma once
+#include "headers.hpp"
+
+// Heap traffic figures for the benchmarks. The counting replacements for the global operator
+// new and delete are only compiled into builds that define CLP_COUNT_ALLOCATIONS (msbuild
+// /p:CountAllocations=true); other builds keep the standard allocator and report no figures.
+class AllocationCounter {
+public:
+    struct Snapshot {
+        uint64_t count = 0;
+        uint64_t bytes = 0;
+    };
+
+    static bool enabled();
+    static Snapshot snapshot();
+};
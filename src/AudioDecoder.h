@@ -0,0 +1,30 @@
+#pragma once
+#include "headers.hpp"
+#include "InputSource.h"
+
+// One open track, decoded block by block into a buffer the decoder owns and reuses; a block
+// stays valid until the next decode() or seek(). Positions and lengths are in frames of
+// playable audio, i.e. after any encoder delay and padding have been trimmed.
+class AudioDecoder {
+public:
+    struct Block {
+        const int16_t* samples = nullptr;
+        size_t frames = 0;
+        int sampleRate = 0;
+        int channels = 0;
+    };
+
+    virtual ~AudioDecoder() = default;
+
+    virtual bool open(std::unique_ptr<InputSource> source) = 0;
+    virtual bool decode(Block& block) = 0;
+    virtual bool seek(uint64_t frame) = 0;
+
+    // Zero when the length is unknown; may scan the stream the first time it is asked.
+    virtual uint64_t getTotalFrames() = 0;
+    // A length for display that never scans: exact when the stream records it, otherwise an
+    // estimate. Opening a track must not wait for a scan.
+    virtual uint64_t estimateTotalFrames() { return getTotalFrames(); }
+    virtual int getSampleRate() const = 0;
+    virtual const char* getFormatName() const = 0;
+};
@@ -0,0 +1,238 @@
+#include "AudioSink.h"
+
+namespace {
+    void putLittleEndian(uint8_t* out, uint32_t value, int bytes) {
+        for (int i = 0; i < bytes; i++) out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+SdlAudioSink::SdlAudioSink() {
+    initialized = SDL_InitSubSystem(SDL_INIT_AUDIO) == 0;
+    if (!initialized) std::cerr << "SDL init error: " << SDL_GetError();
+}
+
+SdlAudioSink::~SdlAudioSink() {
+    close();
+    if (initialized) SDL_QuitSubSystem(SDL_INIT_AUDIO);
+}
+
+void SdlAudioSink::callback(void* userdata, uint8_t* stream, int len) {
+    SdlAudioSink* sink = static_cast<SdlAudioSink*>(userdata);
+    int16_t* output = reinterpret_cast<int16_t*>(stream);
+    size_t samples = len / sizeof(int16_t);
+
+    size_t rendered = sink->render(output, samples);
+    if (rendered < samples) std::memset(output + rendered, 0, (samples - rendered) * sizeof(int16_t));
+}
+
+bool SdlAudioSink::open(const AudioFormat& requested, RenderFunction render) {
+    close();
+    if (!initialized) return false;
+
+    this->render = std::move(render);
+
+    SDL_AudioSpec desired = {}, obtained = {};
+    desired.freq = requested.frequency;
+    desired.format = AUDIO_S16SYS;
+    desired.channels = static_cast<uint8_t>(requested.channels);
+    desired.samples = 1024;
+    desired.callback = callback;
+    desired.userdata = this;
+
+    deviceId = SDL_OpenAudioDevice(nullptr, 0, &desired, &obtained, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
+    if (deviceId == 0) return false;
+
+    format.frequency = obtained.freq;
+    format.channels = obtained.channels;
+    format.periodFrames = obtained.samples;
+    // SDL double-buffers: the period rendered now starts once the one just handed over ends.
+    format.latencyFrames = 2 * obtained.samples;
+    return true;
+}
+
+void SdlAudioSink::close() {
+    if (deviceId == 0) return;
+
+    SDL_CloseAudioDevice(deviceId);
+    deviceId = 0;
+}
+
+void SdlAudioSink::pause(bool paused) {
+    if (deviceId != 0) SDL_PauseAudioDevice(deviceId, paused ? 1 : 0);
+}
+
+void SdlAudioSink::lock() {
+    if (deviceId != 0) SDL_LockAudioDevice(deviceId);
+}
+
+void SdlAudioSink::unlock() {
+    if (deviceId != 0) SDL_UnlockAudioDevice(deviceId);
+}
+
+bool SdlAudioSink::isOpen() const {
+    return deviceId != 0;
+}
+
+AudioFormat SdlAudioSink::getFormat() const {
+    return format;
+}
+
+NullAudioSink::NullAudioSink(Pacing pacing) : pacing(pacing) {}
+
+NullAudioSink::~NullAudioSink() {
+    stopWorker();
+}
+
+bool NullAudioSink::open(const AudioFormat& requested, RenderFunction render) {
+    stopWorker();
+    if (requested.frequency <= 0 || requested.channels <= 0) return false;
+
+    format = requested;
+    format.periodFrames = PERIOD_FRAMES;
+    format.latencyFrames = (pacing == Pacing::Realtime) ? PERIOD_FRAMES : 0;
+    this->render = std::move(render);
+    buffer.assign(static_cast<size_t>(PERIOD_FRAMES) * format.channels, 0);
+
+    running = true;
+    paused = true;
+    worker = std::thread([this] { run(); });
+    return true;
+}
+
+void NullAudioSink::stopWorker() {
+    {
+        std::lock_guard<std::mutex> stateLock(stateMutex);
+        running = false;
+    }
+    stateCv.notify_one();
+
+    if (worker.joinable()) worker.join();
+}
+
+void NullAudioSink::close() {
+    stopWorker();
+}
+
+void NullAudioSink::run() {
+    auto period = std::chrono::duration<double>(static_cast<double>(PERIOD_FRAMES) / format.frequency);
+    auto deadline = std::chrono::steady_clock::now();
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> stateLock(stateMutex);
+            if (paused && running) {
+                stateCv.wait(stateLock, [this] { return !paused || !running; });
+                deadline = std::chrono::steady_clock::now();
+            }
+            if (!running) break;
+        }
+
+        size_t rendered = 0;
+        {
+            std::lock_guard<std::mutex> renderLock(renderMutex);
+            rendered = render(buffer.data(), buffer.size());
+        }
+        if (rendered > 0) consume(buffer.data(), rendered);
+
+        if (pacing == Pacing::Realtime) {
+            deadline += std::chrono::duration_cast<std::chrono::steady_clock::duration>(period);
+            std::this_thread::sleep_until(deadline);
+        }
+        else if (rendered == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+void NullAudioSink::consume(const int16_t*, size_t) {}
+
+void NullAudioSink::pause(bool paused) {
+    {
+        std::lock_guard<std::mutex> stateLock(stateMutex);
+        this->paused = paused;
+    }
+    stateCv.notify_one();
+}
+
+void NullAudioSink::lock() {
+    renderMutex.lock();
+}
+
+void NullAudioSink::unlock() {
+    renderMutex.unlock();
+}
+
+bool NullAudioSink::isOpen() const {
+    return worker.joinable();
+}
+
+AudioFormat NullAudioSink::getFormat() const {
+    return format;
+}
+
+WavFileSink::WavFileSink(const std::filesystem::path& path, Pacing pacing) : NullAudioSink(pacing), path(path) {}
+
+WavFileSink::~WavFileSink() {
+    close();
+}
+
+bool WavFileSink::open(const AudioFormat& requested, RenderFunction render) {
+    close();
+
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) return false;
+
+    dataBytes = 0;
+    if (!NullAudioSink::open(requested, std::move(render))) {
+        file.close();
+        return false;
+    }
+
+    writeHeader();
+    return true;
+}
+
+void WavFileSink::close() {
+    stopWorker();
+    if (!file.is_open()) return;
+
+    file.seekp(0);
+    writeHeader();
+    file.close();
+}
+
+void WavFileSink::writeHeader() {
+    AudioFormat format = getFormat();
+    uint32_t blockAlign = static_cast<uint32_t>(format.channels) * sizeof(int16_t);
+    uint32_t dataSize = static_cast<uint32_t>(std::min<uint64_t>(dataBytes, UINT32_MAX - 36));
+
+    uint8_t header[44];
+    std::memcpy(header, "RIFF", 4);
+    putLittleEndian(header + 4, 36 + dataSize, 4);
+    std::memcpy(header + 8, "WAVEfmt ", 8);
+    putLittleEndian(header + 16, 16, 4);
+    putLittleEndian(header + 20, 1, 2);
+    putLittleEndian(header + 22, static_cast<uint32_t>(format.channels), 2);
+    putLittleEndian(header + 24, static_cast<uint32_t>(format.frequency), 4);
+    putLittleEndian(header + 28, static_cast<uint32_t>(format.frequency) * blockAlign, 4);
+    putLittleEndian(header + 32, blockAlign, 2);
+    putLittleEndian(header + 34, 16, 2);
+    std::memcpy(header + 36, "data", 4);
+    putLittleEndian(header + 40, dataSize, 4);
+
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+}
+
+void WavFileSink::consume(const int16_t* samples, size_t count) {
+    if constexpr (std::endian::native == std::endian::little) {
+        file.write(reinterpret_cast<const char*>(samples), count * sizeof(int16_t));
+    }
+    else {
+        uint8_t bytes[2];
+        for (size_t i = 0; i < count; i++) {
+            putLittleEndian(bytes, static_cast<uint16_t>(samples[i]), 2);
+            file.write(reinterpret_cast<const char*>(bytes), 2);
+        }
+    }
+    dataBytes += count * sizeof(int16_t);
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include "headers.hpp"
+
+// latencyFrames is how far behind the most recently rendered frame the audible output is
+// at the moment the render function returns.
+struct AudioFormat {
+    int frequency = 0;
+    int channels = 0;
+    int periodFrames = 0;
+    int latencyFrames = 0;
+};
+
+// Destination for the final int16 output stream. A sink pulls samples through the render
+// function from its own thread (the SDL audio thread, or a worker for the null and WAV
+// sinks); lock()/unlock() keep that thread out while the producer resets shared state.
+class AudioSink {
+public:
+    using RenderFunction = std::function<size_t(int16_t* output, size_t samples)>;
+
+    virtual ~AudioSink() = default;
+
+    virtual bool open(const AudioFormat& requested, RenderFunction render) = 0;
+    virtual void close() = 0;
+    virtual void pause(bool paused) = 0;
+    virtual void lock() = 0;
+    virtual void unlock() = 0;
+
+    virtual bool isOpen() const = 0;
+    virtual AudioFormat getFormat() const = 0;
+};
+
+class SdlAudioSink : public AudioSink {
+private:
+    uint32_t deviceId = 0;
+    bool initialized = false;
+    AudioFormat format;
+    RenderFunction render;
+
+    static void callback(void* userdata, uint8_t* stream, int len);
+public:
+    SdlAudioSink();
+    ~SdlAudioSink() override;
+
+    bool open(const AudioFormat& requested, RenderFunction render) override;
+    void close() override;
+    void pause(bool paused) override;
+    void lock() override;
+    void unlock() override;
+
+    bool isOpen() const override;
+    AudioFormat getFormat() const override;
+};
+
+// Pulls from a worker thread instead of a device and throws the samples away, either at
+// wall-clock speed or as fast as the producer can fill the buffer.
+class NullAudioSink : public AudioSink {
+public:
+    enum class Pacing {
+        Realtime,
+        Unthrottled
+    };
+private:
+    static constexpr int PERIOD_FRAMES = 1024;
+
+    std::thread worker;
+    std::mutex renderMutex, stateMutex;
+    std::condition_variable stateCv;
+    bool running = false, paused = true;
+    Pacing pacing;
+    AudioFormat format;
+    RenderFunction render;
+    std::vector<int16_t> buffer;
+
+    void run();
+protected:
+    virtual void consume(const int16_t* samples, size_t count);
+    void stopWorker();
+public:
+    explicit NullAudioSink(Pacing pacing = Pacing::Realtime);
+    ~NullAudioSink() override;
+
+    bool open(const AudioFormat& requested, RenderFunction render) override;
+    void close() override;
+    void pause(bool paused) override;
+    void lock() override;
+    void unlock() override;
+
+    bool isOpen() const override;
+    AudioFormat getFormat() const override;
+};
+
+// Unthrottled null sink that appends everything it pulls to a 16-bit PCM WAV file.
+class WavFileSink : public NullAudioSink {
+private:
+    std::filesystem::path path;
+    std::ofstream file;
+    uint64_t dataBytes = 0;
+
+    void writeHeader();
+protected:
+    void consume(const int16_t* samples, size_t count) override;
+public:
+    explicit WavFileSink(const std::filesystem::path& path, Pacing pacing = Pacing::Unthrottled);
+    ~WavFileSink() override;
+
+    bool open(const AudioFormat& requested, RenderFunction render) override;
+    void close() override;
+};
@@ -0,0 +1,21 @@
+#pragma once
+#include "headers.hpp"
+
+// Simple Unicode case folding: maps a character to the single character it folds to, so text in
+// any cased script (Latin, Greek, Cyrillic, Armenian, Georgian, Cherokee, ...) compares without
+// regard to case. Characters whose full folding expands to several characters, like 'ß', are
+// left as they are. The table was generated from the Unicode 14.0 case folding data.
+class CaseFold {
+private:
+    // Every step-th character from first to last folds to itself plus delta.
+    struct Range {
+        uint32_t first, last;
+        int32_t delta;
+        uint32_t step;
+    };
+
+    static const Range RANGES[];
+    static const size_t RANGE_COUNT;
+public:
+    static wchar_t simple(wchar_t c);
+};
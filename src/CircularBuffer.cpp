@@ -0,0 +1,71 @@
+#include "CircularBuffer.h"
+
+CircularBuffer::CircularBuffer(size_t minCapacity) {
+    capacity = 1;
+    while (capacity < minCapacity) capacity <<= 1;
+    mask = capacity - 1;
+    buffer = std::make_unique<int16_t[]>(capacity);
+}
+
+size_t CircularBuffer::write(const int16_t* data, size_t count) {
+    size_t head = writeIndex.load(std::memory_order_relaxed);
+    size_t tail = readIndex.load(std::memory_order_acquire);
+
+    size_t toWrite = std::min(count, capacity - (head - tail));
+    if (toWrite == 0) return 0;
+
+    size_t start = head & mask;
+    size_t firstPart = std::min(toWrite, capacity - start);
+    std::memcpy(buffer.get() + start, data, firstPart * sizeof(int16_t));
+    std::memcpy(buffer.get(), data + firstPart, (toWrite - firstPart) * sizeof(int16_t));
+
+    writeIndex.store(head + toWrite, std::memory_order_release);
+    return toWrite;
+}
+
+size_t CircularBuffer::read(int16_t* out, size_t count) {
+    size_t tail = readIndex.load(std::memory_order_relaxed);
+    size_t head = writeIndex.load(std::memory_order_acquire);
+
+    size_t toRead = std::min(count, head - tail);
+    if (toRead == 0) return 0;
+
+    size_t start = tail & mask;
+    size_t firstPart = std::min(toRead, capacity - start);
+    std::memcpy(out, buffer.get() + start, firstPart * sizeof(int16_t));
+    std::memcpy(out + firstPart, buffer.get(), (toRead - firstPart) * sizeof(int16_t));
+
+    readIndex.store(tail + toRead, std::memory_order_release);
+    return toRead;
+}
+
+// Consumer-side operation: drops everything the producer has published so far.
+void CircularBuffer::clear() {
+    readIndex.store(writeIndex.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+size_t CircularBuffer::size() const {
+    size_t tail = readIndex.load(std::memory_order_acquire);
+    size_t head = writeIndex.load(std::memory_order_acquire);
+    return head - tail;
+}
+
+size_t CircularBuffer::freeSpace() const {
+    return capacity - size();
+}
+
+size_t CircularBuffer::getCapacity() const {
+    return capacity;
+}
+
+size_t CircularBuffer::readPosition() const {
+    return readIndex.load(std::memory_order_acquire);
+}
+
+size_t CircularBuffer::writePosition() const {
+    return writeIndex.load(std::memory_order_acquire);
+}
+
+bool CircularBuffer::empty() const {
+    return size() == 0;
+}
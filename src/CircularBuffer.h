@@ -0,0 +1,30 @@
+#pragma once
+#include "headers.hpp"
+
+// Fixed-capacity single-producer/single-consumer ring of interleaved PCM samples.
+// write() may only be called from one thread and read()/clear() from one other thread;
+// neither side takes locks or allocates after construction.
+class CircularBuffer {
+private:
+    std::unique_ptr<int16_t[]> buffer;
+    size_t capacity = 0, mask = 0;
+
+    alignas(64) std::atomic<size_t> writeIndex = 0;
+    alignas(64) std::atomic<size_t> readIndex = 0;
+public:
+    explicit CircularBuffer(size_t minCapacity);
+
+    CircularBuffer(const CircularBuffer&) = delete;
+    CircularBuffer& operator=(const CircularBuffer&) = delete;
+
+    size_t write(const int16_t* data, size_t count);
+    size_t read(int16_t* out, size_t count);
+    void clear();
+
+    size_t size() const;
+    size_t freeSpace() const;
+    size_t getCapacity() const;
+    size_t readPosition() const;
+    size_t writePosition() const;
+    bool empty() const;
+};
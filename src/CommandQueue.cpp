@@ -0,0 +1,63 @@
+#include "CommandQueue.h"
+
+SoundCommand SoundCommand::withValue(Type type, int value) {
+    SoundCommand command;
+    command.type = type;
+    command.value = value;
+    return command;
+}
+
+SoundCommand SoundCommand::withPath(Type type, std::filesystem::path path, ReplayGain replayGain) {
+    SoundCommand command;
+    command.type = type;
+    command.path = std::move(path);
+    command.replayGain = replayGain;
+    return command;
+}
+
+CommandQueue::CommandQueue(size_t minCapacity) {
+    capacity = 2;
+    while (capacity < minCapacity) capacity <<= 1;
+    mask = capacity - 1;
+
+    slots = std::make_unique<Slot[]>(capacity);
+    for (size_t i = 0; i < capacity; i++) slots[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+bool CommandQueue::push(SoundCommand command) {
+    size_t position = enqueuePosition.load(std::memory_order_relaxed);
+
+    while (true) {
+        Slot& slot = slots[position & mask];
+        size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        auto lag = static_cast<std::ptrdiff_t>(sequence - position);
+
+        if (lag < 0) return false;
+        if (lag > 0) {
+            position = enqueuePosition.load(std::memory_order_relaxed);
+            continue;
+        }
+        if (!enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) continue;
+
+        slot.command = std::move(command);
+        slot.sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+}
+
+bool CommandQueue::pop(SoundCommand& command) {
+    size_t position = dequeuePosition.load(std::memory_order_relaxed);
+    Slot& slot = slots[position & mask];
+    if (slot.sequence.load(std::memory_order_acquire) != position + 1) return false;
+
+    command = std::move(slot.command);
+    slot.command = SoundCommand();
+    slot.sequence.store(position + capacity, std::memory_order_release);
+    dequeuePosition.store(position + 1, std::memory_order_relaxed);
+    return true;
+}
+
+bool CommandQueue::empty() const {
+    size_t position = dequeuePosition.load(std::memory_order_relaxed);
+    return slots[position & mask].sequence.load(std::memory_order_acquire) != position + 1;
+}
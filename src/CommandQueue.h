@@ -0,0 +1,51 @@
+#pragma once
+#include "headers.hpp"
+#include "ReplayGain.h"
+
+struct SoundCommand {
+    enum class Type {
+        Play,
+        QueueNext,
+        ClearQueue,
+        TogglePause,
+        Stop,
+        SeekProgress,
+        SeekSeconds,
+        Volume
+    };
+
+    Type type = Type::Stop;
+    int value = 0;
+    std::filesystem::path path;
+    // Looked up by whoever posts a Play or QueueNext, so the engine never reads the library.
+    ReplayGain replayGain;
+
+    static SoundCommand withValue(Type type, int value = 0);
+    static SoundCommand withPath(Type type, std::filesystem::path path, ReplayGain replayGain = {});
+};
+
+// Bounded multi-producer/single-consumer queue of engine commands (Vyukov's sequenced ring).
+// push() may be called from any thread and fails instead of waiting when the ring is full;
+// pop() and empty() belong to the engine thread.
+class CommandQueue {
+private:
+    struct Slot {
+        std::atomic<size_t> sequence = 0;
+        SoundCommand command;
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    size_t capacity = 0, mask = 0;
+
+    alignas(64) std::atomic<size_t> enqueuePosition = 0;
+    alignas(64) std::atomic<size_t> dequeuePosition = 0;
+public:
+    explicit CommandQueue(size_t minCapacity);
+
+    CommandQueue(const CommandQueue&) = delete;
+    CommandQueue& operator=(const CommandQueue&) = delete;
+
+    bool push(SoundCommand command);
+    bool pop(SoundCommand& command);
+    bool empty() const;
+};
@@ -0,0 +1,282 @@
+#include "DecoderBenchmark.h"
+#include "OfflineRenderer.h"
+#include "Id3Reader.h"
+#include "SoundModule.hpp"
+#include "AllocationCounter.h"
+
+namespace {
+    // Allocation figures are null unless the build counts allocations.
+    std::string allocationFigure(uint64_t value) {
+        return AllocationCounter::enabled() ? std::to_string(value) : "null";
+    }
+
+    std::string jsonString(const std::filesystem::path& path) {
+        std::u8string utf8 = path.u8string();
+        std::string escaped = "\"";
+
+        for (char8_t c : utf8) {
+            if (c == '"' || c == '\\') {
+                escaped += '\\';
+                escaped += static_cast<char>(c);
+            }
+            else if (c < 0x20) {
+                char code[8];
+                std::snprintf(code, sizeof(code), "\\u%04x", static_cast<unsigned>(c));
+                escaped += code;
+            }
+            else escaped += static_cast<char>(c);
+        }
+
+        return escaped + "\"";
+    }
+
+    double percentile(std::vector<double>& values, double fraction) {
+        if (values.empty()) return 0.0;
+
+        size_t index = static_cast<size_t>(fraction * (values.size() - 1) + 0.5);
+        std::nth_element(values.begin(), values.begin() + index, values.end());
+        return values[index];
+    }
+}
+
+int DecoderBenchmark::runCommandLine(const std::vector<std::string>& arguments) {
+    int passes = 3;
+    std::vector<std::filesystem::path> tracks;
+
+    for (size_t i = 1; i < arguments.size(); i++) {
+        if (arguments[i] == "--passes" && i + 1 < arguments.size()) passes = std::max(1, std::atoi(arguments[++i].c_str()));
+        else OfflineRenderer::collectTracks(std::filesystem::path(arguments[i]), tracks);
+    }
+
+    if (tracks.empty()) {
+        std::cerr << "usage: CLP --bench-decode [--passes N] <file or directory>...\n";
+        return 2;
+    }
+
+    bool allDecoded = true;
+    for (const std::filesystem::path& track : tracks) {
+        Result result = measure(track, passes);
+        printResult(result, std::cout);
+        allDecoded = allDecoded && result.decoded;
+    }
+
+    return allDecoded ? 0 : 1;
+}
+
+int DecoderBenchmark::runTagCommandLine(const std::vector<std::string>& arguments) {
+    int passes = 1000;
+    std::vector<std::filesystem::path> tracks;
+
+    for (size_t i = 1; i < arguments.size(); i++) {
+        if (arguments[i] == "--passes" && i + 1 < arguments.size()) passes = std::max(1, std::atoi(arguments[++i].c_str()));
+        else OfflineRenderer::collectTracks(std::filesystem::path(arguments[i]), tracks);
+    }
+
+    if (tracks.empty()) {
+        std::cerr << "usage: CLP --bench-tags [--passes N] <file or directory>...\n";
+        return 2;
+    }
+
+    uint64_t totalReads = 0;
+    double totalSeconds = 0.0;
+    for (const std::filesystem::path& track : tracks) {
+        TagResult result = measureTags(track, passes);
+        printTagResult(result, std::cout);
+        totalReads += result.passes;
+        totalSeconds += result.readSeconds;
+    }
+
+    double tagsPerSecond = (totalSeconds > 0.0) ? totalReads / totalSeconds : 0.0;
+    std::cout << "{\"files\":" << tracks.size() << ",\"reads\":" << totalReads << ",\"tags_per_second\":" << tagsPerSecond << "}\n";
+    return 0;
+}
+
+int DecoderBenchmark::runDurationCommandLine(const std::vector<std::string>& arguments) {
+    int passes = 3;
+    std::vector<std::filesystem::path> tracks;
+
+    for (size_t i = 1; i < arguments.size(); i++) {
+        if (arguments[i] == "--passes" && i + 1 < arguments.size()) passes = std::max(1, std::atoi(arguments[++i].c_str()));
+        else OfflineRenderer::collectTracks(std::filesystem::path(arguments[i]), tracks);
+    }
+
+    if (tracks.empty()) {
+        std::cerr << "usage: CLP --bench-duration [--passes N] <file or directory>...\n";
+        return 2;
+    }
+
+    for (const std::filesystem::path& track : tracks) printDurationResult(measureDuration(track, passes), std::cout);
+    return 0;
+}
+
+DecoderBenchmark::Result DecoderBenchmark::measure(const std::filesystem::path& pathToSong, int passes) {
+    Result result;
+    result.path = pathToSong;
+    result.passes = passes;
+
+    std::error_code error;
+    result.bytes = std::filesystem::file_size(pathToSong, error);
+
+    AllocationCounter::Snapshot beforeOpen = AllocationCounter::snapshot();
+    std::unique_ptr<AudioDecoder> decoder = DecoderRegistry::open(pathToSong);
+    if (!decoder) return result;
+
+    result.format = decoder->getFormatName();
+    decoder->seek(0);
+    AllocationCounter::Snapshot afterOpen = AllocationCounter::snapshot();
+    result.openAllocations = afterOpen.count - beforeOpen.count;
+    result.openAllocatedBytes = afterOpen.bytes - beforeOpen.bytes;
+
+    AudioDecoder::Block block;
+    uint64_t warmupBlocks = 0;
+    while (decoder->decode(block)) warmupBlocks++;
+    if (warmupBlocks == 0) return result;
+
+    std::vector<double> latencies;
+    latencies.reserve(static_cast<size_t>(warmupBlocks) * passes);
+
+    AllocationCounter::Snapshot beforeDecode = AllocationCounter::snapshot();
+    for (int pass = 0; pass < passes; pass++) {
+        decoder->seek(0);
+
+        auto passStarted = std::chrono::steady_clock::now();
+        auto blockStarted = passStarted;
+        while (decoder->decode(block)) {
+            auto blockFinished = std::chrono::steady_clock::now();
+            if (latencies.size() < latencies.capacity())
+                latencies.push_back(std::chrono::duration<double, std::micro>(blockFinished - blockStarted).count());
+            blockStarted = blockFinished;
+
+            if (pass != 0) continue;
+            result.blocks++;
+            result.samples += block.frames;
+            if (block.frames > 0) {
+                result.sampleRate = block.sampleRate;
+                result.channels = block.channels;
+            }
+        }
+        result.decodeSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - passStarted).count();
+    }
+    AllocationCounter::Snapshot afterDecode = AllocationCounter::snapshot();
+
+    result.decodeAllocations = afterDecode.count - beforeDecode.count;
+    result.decodeAllocatedBytes = afterDecode.bytes - beforeDecode.bytes;
+    result.p50Microseconds = percentile(latencies, 0.50);
+    result.p99Microseconds = percentile(latencies, 0.99);
+    result.maxMicroseconds = latencies.empty() ? 0.0 : *std::max_element(latencies.begin(), latencies.end());
+    result.decoded = result.samples > 0;
+    return result;
+}
+
+void DecoderBenchmark::printResult(const Result& result, std::ostream& out) {
+    double decodeSecondsPerPass = result.decodeSeconds / std::max(result.passes, 1);
+    double audioSeconds = (result.sampleRate > 0) ? static_cast<double>(result.samples) / result.sampleRate : 0.0;
+    double blocksPerSecond = (decodeSecondsPerPass > 0.0) ? result.blocks / decodeSecondsPerPass : 0.0;
+    double realtimeFactor = (decodeSecondsPerPass > 0.0) ? audioSeconds / decodeSecondsPerPass : 0.0;
+    double bitrateKbps = (audioSeconds > 0.0) ? result.bytes * 8.0 / audioSeconds / 1000.0 : 0.0;
+
+    out << "{\"file\":" << jsonString(result.path)
+        << ",\"format\":\"" << result.format << "\""
+        << ",\"decoded\":" << (result.decoded ? "true" : "false")
+        << ",\"sample_rate\":" << result.sampleRate
+        << ",\"channels\":" << result.channels
+        << ",\"bitrate_kbps\":" << bitrateKbps
+        << ",\"blocks\":" << result.blocks
+        << ",\"audio_seconds\":" << audioSeconds
+        << ",\"passes\":" << result.passes
+        << ",\"decode_seconds_per_pass\":" << decodeSecondsPerPass
+        << ",\"blocks_per_second\":" << blocksPerSecond
+        << ",\"realtime_factor\":" << realtimeFactor
+        << ",\"block_p50_us\":" << result.p50Microseconds
+        << ",\"block_p99_us\":" << result.p99Microseconds
+        << ",\"block_max_us\":" << result.maxMicroseconds
+        << ",\"open_allocations\":" << allocationFigure(result.openAllocations)
+        << ",\"open_allocated_bytes\":" << allocationFigure(result.openAllocatedBytes)
+        << ",\"decode_allocations\":" << allocationFigure(result.decodeAllocations)
+        << ",\"decode_allocated_bytes\":" << allocationFigure(result.decodeAllocatedBytes)
+        << "}\n";
+}
+
+// Each pass opens the file afresh, as the player does when a track starts. The seek time
+// covers the seek to the middle and the first block decoded there.
+DecoderBenchmark::DurationResult DecoderBenchmark::measureDuration(const std::filesystem::path& pathToSong, int passes) {
+    DurationResult result;
+    result.path = pathToSong;
+    result.passes = passes;
+
+    for (int pass = 0; pass < passes; pass++) {
+        auto started = std::chrono::steady_clock::now();
+        result.probedSeconds = SoundModule::probeSongDuration(pathToSong);
+        auto probed = std::chrono::steady_clock::now();
+        result.decodedSeconds = SoundModule::decodeSongDuration(pathToSong);
+        auto decoded = std::chrono::steady_clock::now();
+
+        result.probeMicroseconds += std::chrono::duration<double, std::micro>(probed - started).count() / passes;
+        result.decodeMicroseconds += std::chrono::duration<double, std::micro>(decoded - probed).count() / passes;
+
+        std::unique_ptr<AudioDecoder> decoder = DecoderRegistry::open(pathToSong);
+        if (!decoder) return result;
+        result.format = decoder->getFormatName();
+
+        AudioDecoder::Block block;
+        uint64_t middle = decoder->estimateTotalFrames() / 2;
+        auto seekStarted = std::chrono::steady_clock::now();
+        if (decoder->seek(middle)) decoder->decode(block);
+        result.seekMicroseconds += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - seekStarted).count() / passes;
+    }
+
+    return result;
+}
+
+// The source stays open across passes and the Tags are reused, so the allocation count
+// covers the reader alone.
+DecoderBenchmark::TagResult DecoderBenchmark::measureTags(const std::filesystem::path& pathToSong, int passes) {
+    TagResult result;
+    result.path = pathToSong;
+
+    ChunkedInputSource source(BLOCK_SIZE);
+    if (!source.open(pathToSong)) return result;
+
+    Id3Reader::Tags tags;
+    result.tagged = Id3Reader(source).read(tags);
+    if (!result.tagged) return result;
+
+    AllocationCounter::Snapshot beforeRead = AllocationCounter::snapshot();
+    auto started = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < passes; pass++) Id3Reader(source).read(tags);
+    result.readSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    AllocationCounter::Snapshot afterRead = AllocationCounter::snapshot();
+
+    result.passes = passes;
+    result.readAllocations = afterRead.count - beforeRead.count;
+    return result;
+}
+
+void DecoderBenchmark::printTagResult(const TagResult& result, std::ostream& out) {
+    double tagsPerSecond = (result.readSeconds > 0.0) ? result.passes / result.readSeconds : 0.0;
+    double microsecondsPerRead = (result.passes > 0) ? result.readSeconds * 1e6 / result.passes : 0.0;
+
+    out << "{\"file\":" << jsonString(result.path)
+        << ",\"tagged\":" << (result.tagged ? "true" : "false")
+        << ",\"passes\":" << result.passes
+        << ",\"tags_per_second\":" << tagsPerSecond
+        << ",\"read_us\":" << microsecondsPerRead
+        << ",\"read_allocations\":" << allocationFigure(result.readAllocations)
+        << "}\n";
+}
+
+void DecoderBenchmark::printDurationResult(const DurationResult& result, std::ostream& out) {
+    double speedup = (result.probeMicroseconds > 0.0) ? result.decodeMicroseconds / result.probeMicroseconds : 0.0;
+
+    out << "{\"file\":" << jsonString(result.path)
+        << ",\"format\":\"" << result.format << "\""
+        << ",\"passes\":" << result.passes
+        << ",\"probed_seconds\":" << result.probedSeconds
+        << ",\"decoded_seconds\":" << result.decodedSeconds
+        << ",\"difference_ms\":" << (result.probedSeconds - result.decodedSeconds) * 1000.0
+        << ",\"probe_us\":" << result.probeMicroseconds
+        << ",\"decode_us\":" << result.decodeMicroseconds
+        << ",\"speedup\":" << speedup
+        << ",\"seek_us\":" << result.seekMicroseconds
+        << "}\n";
+}
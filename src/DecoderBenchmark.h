@@ -0,0 +1,49 @@
+#pragma once
+#include "headers.hpp"
+#include "DecoderRegistry.h"
+
+// `--bench-decode` mode: runs each file through the decoder backend the registry picks for
+// it, with nothing else in the loop, and prints one JSON object per line with throughput,
+// per-block latency percentiles and heap traffic, so results can be compared between builds
+// and between formats. `--bench-tags` does the same for the ID3v2 reader, and
+// `--bench-duration` compares the header duration probe with a full decode and times a seek
+// to the middle of each file.
+class DecoderBenchmark {
+private:
+    struct Result {
+        std::filesystem::path path;
+        std::string format;
+        bool decoded = false;
+        int sampleRate = 0, channels = 0, passes = 0;
+        uint64_t blocks = 0, samples = 0, bytes = 0;
+        double decodeSeconds = 0.0, p50Microseconds = 0.0, p99Microseconds = 0.0, maxMicroseconds = 0.0;
+        uint64_t openAllocations = 0, openAllocatedBytes = 0, decodeAllocations = 0, decodeAllocatedBytes = 0;
+    };
+
+    struct TagResult {
+        std::filesystem::path path;
+        bool tagged = false;
+        int passes = 0;
+        double readSeconds = 0.0;
+        uint64_t readAllocations = 0;
+    };
+
+    struct DurationResult {
+        std::filesystem::path path;
+        std::string format;
+        int passes = 0;
+        double probedSeconds = 0.0, decodedSeconds = 0.0;
+        double probeMicroseconds = 0.0, decodeMicroseconds = 0.0, seekMicroseconds = 0.0;
+    };
+
+    static Result measure(const std::filesystem::path& pathToSong, int passes);
+    static TagResult measureTags(const std::filesystem::path& pathToSong, int passes);
+    static DurationResult measureDuration(const std::filesystem::path& pathToSong, int passes);
+    static void printResult(const Result& result, std::ostream& out);
+    static void printTagResult(const TagResult& result, std::ostream& out);
+    static void printDurationResult(const DurationResult& result, std::ostream& out);
+public:
+    static int runCommandLine(const std::vector<std::string>& arguments);
+    static int runTagCommandLine(const std::vector<std::string>& arguments);
+    static int runDurationCommandLine(const std::vector<std::string>& arguments);
+};
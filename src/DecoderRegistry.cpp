@@ -0,0 +1,38 @@
+#include "DecoderRegistry.h"
+#include "WavDecoder.h"
+#include "Mp3Decoder.h"
+
+namespace {
+    template <typename Decoder>
+    std::unique_ptr<AudioDecoder> createDecoder() {
+        return std::make_unique<Decoder>();
+    }
+}
+
+const std::vector<DecoderRegistry::Backend>& DecoderRegistry::backends() {
+    static const std::vector<Backend> registered = {
+        { "wav", &WavDecoder::sniff, &createDecoder<WavDecoder> },
+        { "mp3", &Mp3Decoder::sniff, &createDecoder<Mp3Decoder> }
+    };
+    return registered;
+}
+
+const DecoderRegistry::Backend* DecoderRegistry::detect(InputSource& source) {
+    for (const Backend& backend : backends()) {
+        if (!source.seek(0)) return nullptr;
+        if (backend.sniff(source)) return &backend;
+    }
+    return nullptr;
+}
+
+std::unique_ptr<AudioDecoder> DecoderRegistry::open(const std::filesystem::path& path) {
+    std::unique_ptr<InputSource> source = InputSource::create(path);
+    if (!source) return nullptr;
+
+    const Backend* backend = detect(*source);
+    if (backend == nullptr || !source->seek(0)) return nullptr;
+
+    std::unique_ptr<AudioDecoder> decoder = backend->create();
+    if (!decoder->open(std::move(source))) return nullptr;
+    return decoder;
+}
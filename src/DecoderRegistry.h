@@ -0,0 +1,19 @@
+#pragma once
+#include "headers.hpp"
+#include "AudioDecoder.h"
+
+// Chooses a decoder backend for a file by sniffing its first bytes. Backends are tried in
+// order: formats with a fixed signature first, MP3 last because recognising it means
+// skipping tags and validating a frame header.
+class DecoderRegistry {
+public:
+    struct Backend {
+        const char* name;
+        bool (*sniff)(InputSource& source);
+        std::unique_ptr<AudioDecoder> (*create)();
+    };
+
+    static const std::vector<Backend>& backends();
+    static std::unique_ptr<AudioDecoder> open(const std::filesystem::path& path);
+    static const Backend* detect(InputSource& source);
+};
@@ -0,0 +1,256 @@
+#include "DirectoryWatcher.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+#if defined(__linux__)
+    // Files are picked up when the writer closes them; IN_CREATE alone would report a
+    // file that is still being copied in.
+    constexpr uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+#endif
+}
+
+DirectoryWatcher::DirectoryWatcher(std::chrono::milliseconds debounce, std::chrono::milliseconds maxDelay)
+    : debounce(debounce), maxDelay(maxDelay) {}
+
+DirectoryWatcher::~DirectoryWatcher() {
+    stop();
+}
+
+bool DirectoryWatcher::running() const {
+    return watchThread.joinable();
+}
+
+void DirectoryWatcher::recordChange(std::filesystem::path path) {
+    auto now = std::chrono::steady_clock::now();
+    if (pending.empty()) firstChange = now;
+    lastChange = now;
+    pending.push_back(std::move(path));
+}
+
+int DirectoryWatcher::millisecondsUntilFlush() const {
+    if (pending.empty()) return -1;
+
+    auto deadline = std::min(lastChange + debounce, firstChange + maxDelay);
+    auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+    return static_cast<int>(std::max<int64_t>(remaining.count(), 0));
+}
+
+void DirectoryWatcher::flushIfDue() {
+    if (pending.empty() || millisecondsUntilFlush() > 0) return;
+
+    std::vector<std::filesystem::path> batch;
+    batch.swap(pending);
+    std::sort(batch.begin(), batch.end());
+    batch.erase(std::unique(batch.begin(), batch.end()), batch.end());
+
+    if (onChange != nullptr) onChange(std::move(batch));
+}
+
+#ifdef _WIN32
+bool DirectoryWatcher::start(const std::filesystem::path& directory, ChangeCallback callback) {
+    stop();
+
+    root = directory;
+    onChange = std::move(callback);
+    pending.clear();
+
+    HANDLE handle = CreateFileW(root.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) return false;
+    directoryHandle = handle;
+
+    stopEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (stopEvent == nullptr) {
+        closeHandles();
+        return false;
+    }
+
+    stopping.store(false);
+    watchThread = std::thread([this] { watchLoop(); });
+    return true;
+}
+
+void DirectoryWatcher::stop() {
+    if (!watchThread.joinable()) return;
+
+    stopping.store(true);
+    SetEvent(static_cast<HANDLE>(stopEvent));
+    watchThread.join();
+    closeHandles();
+}
+
+void DirectoryWatcher::closeHandles() {
+    if (directoryHandle != nullptr) CloseHandle(static_cast<HANDLE>(directoryHandle));
+    if (stopEvent != nullptr) CloseHandle(static_cast<HANDLE>(stopEvent));
+    directoryHandle = nullptr;
+    stopEvent = nullptr;
+}
+
+void DirectoryWatcher::watchLoop() {
+    HANDLE directory = static_cast<HANDLE>(directoryHandle);
+    OVERLAPPED overlapped = {};
+    overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (overlapped.hEvent == nullptr) return;
+
+    std::vector<DWORD> buffer(16 * 1024);
+    DWORD filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE;
+    bool reading = false;
+
+    while (!stopping.load()) {
+        if (!reading) {
+            if (!ReadDirectoryChangesW(directory, buffer.data(), static_cast<DWORD>(buffer.size() * sizeof(DWORD)), TRUE, filter,
+                                       nullptr, &overlapped, nullptr)) break;
+            reading = true;
+        }
+
+        HANDLE handles[2] = { overlapped.hEvent, static_cast<HANDLE>(stopEvent) };
+        DWORD waited = WaitForMultipleObjects(2, handles, FALSE, static_cast<DWORD>(millisecondsUntilFlush()));
+        if (waited == WAIT_OBJECT_0 + 1 || waited == WAIT_FAILED) break;
+
+        if (waited == WAIT_OBJECT_0) {
+            reading = false;
+            DWORD bytes = 0;
+            if (!GetOverlappedResult(directory, &overlapped, &bytes, FALSE)) break;
+
+            // Zero bytes means the change list overflowed the buffer and events were lost.
+            if (bytes == 0) recordChange(root);
+
+            const uint8_t* cursor = reinterpret_cast<const uint8_t*>(buffer.data());
+            while (bytes > 0) {
+                const FILE_NOTIFY_INFORMATION* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(cursor);
+                recordChange(root / std::wstring(info->FileName, info->FileNameLength / sizeof(WCHAR)));
+                if (info->NextEntryOffset == 0) break;
+                cursor += info->NextEntryOffset;
+            }
+        }
+
+        flushIfDue();
+    }
+
+    if (reading) {
+        DWORD bytes = 0;
+        CancelIoEx(directory, &overlapped);
+        GetOverlappedResult(directory, &overlapped, &bytes, TRUE);
+    }
+    CloseHandle(overlapped.hEvent);
+}
+#elif defined(__linux__)
+bool DirectoryWatcher::start(const std::filesystem::path& directory, ChangeCallback callback) {
+    stop();
+
+    root = directory;
+    onChange = std::move(callback);
+    pending.clear();
+
+    inotifyDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    stopDescriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (inotifyDescriptor >= 0 && stopDescriptor >= 0) addWatches(root);
+
+    if (watchedDirectories.empty()) {
+        closeHandles();
+        return false;
+    }
+
+    stopping.store(false);
+    watchThread = std::thread([this] { watchLoop(); });
+    return true;
+}
+
+void DirectoryWatcher::stop() {
+    if (!watchThread.joinable()) return;
+
+    stopping.store(true);
+    uint64_t signal = 1;
+    [[maybe_unused]] ssize_t written = write(stopDescriptor, &signal, sizeof(signal));
+    watchThread.join();
+    closeHandles();
+}
+
+void DirectoryWatcher::closeHandles() {
+    if (inotifyDescriptor >= 0) ::close(inotifyDescriptor);
+    if (stopDescriptor >= 0) ::close(stopDescriptor);
+    inotifyDescriptor = -1;
+    stopDescriptor = -1;
+    watchedDirectories.clear();
+}
+
+// inotify is not recursive, so every directory gets its own watch. Adding a watch to a
+// directory that already has one returns the same descriptor, which keeps the map right
+// when a watched directory is moved within the tree.
+void DirectoryWatcher::addWatches(const std::filesystem::path& directory) {
+    int watch = inotify_add_watch(inotifyDescriptor, directory.c_str(), WATCH_MASK);
+    if (watch < 0) return;
+    watchedDirectories[watch] = directory;
+
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+        if (entry.is_directory(error) && !entry.is_symlink(error)) addWatches(entry.path());
+    }
+}
+
+void DirectoryWatcher::readEvents() {
+    alignas(inotify_event) char buffer[16 * 1024];
+
+    while (true) {
+        ssize_t length = read(inotifyDescriptor, buffer, sizeof(buffer));
+        if (length <= 0) return;
+
+        for (char* cursor = buffer; cursor < buffer + length;) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(cursor);
+            cursor += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                recordChange(root);
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                watchedDirectories.erase(event->wd);
+                continue;
+            }
+
+            auto directory = watchedDirectories.find(event->wd);
+            if (directory == watchedDirectories.end() || event->len == 0) continue;
+
+            std::filesystem::path path = directory->second / event->name;
+            bool isDirectory = (event->mask & IN_ISDIR) != 0;
+            if (isDirectory && (event->mask & (IN_CREATE | IN_MOVED_TO))) addWatches(path);
+            if (!isDirectory && (event->mask & IN_CREATE)) continue;
+
+            recordChange(std::move(path));
+        }
+    }
+}
+
+void DirectoryWatcher::watchLoop() {
+    pollfd descriptors[2] = { { inotifyDescriptor, POLLIN, 0 }, { stopDescriptor, POLLIN, 0 } };
+
+    while (!stopping.load()) {
+        int ready = poll(descriptors, 2, millisecondsUntilFlush());
+        if (ready < 0 && errno != EINTR) break;
+        if (descriptors[1].revents != 0) break;
+
+        if (descriptors[0].revents & POLLIN) readEvents();
+        flushIfDue();
+    }
+}
+#else
+bool DirectoryWatcher::start(const std::filesystem::path&, ChangeCallback) {
+    return false;
+}
+
+void DirectoryWatcher::stop() {}
+
+void DirectoryWatcher::closeHandles() {}
+
+void DirectoryWatcher::watchLoop() {}
+#endif
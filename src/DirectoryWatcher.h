@@ -0,0 +1,50 @@
+#pragma once
+#include "headers.hpp"
+
+// Watches a directory tree (inotify on Linux, ReadDirectoryChangesW on Windows) and reports
+// changed paths in batches. A batch is delivered once the tree has been quiet for the
+// debounce interval, or when its oldest change has waited for the maximum delay, so copying
+// an album in arrives as one batch. Only paths are reported: the receiver checks what is on
+// disk now, which covers adds, removals, renames (old path gone, new path present) and
+// rewrites alike. A lost-event overflow reports the root itself.
+class DirectoryWatcher {
+public:
+    using ChangeCallback = std::function<void(std::vector<std::filesystem::path>)>;
+private:
+    std::thread watchThread;
+    std::atomic<bool> stopping = false;
+    std::filesystem::path root;
+    ChangeCallback onChange;
+    std::chrono::milliseconds debounce, maxDelay;
+
+    std::vector<std::filesystem::path> pending;
+    std::chrono::steady_clock::time_point firstChange, lastChange;
+
+#ifdef _WIN32
+    void* directoryHandle = nullptr;
+    void* stopEvent = nullptr;
+#else
+    int inotifyDescriptor = -1, stopDescriptor = -1;
+    std::unordered_map<int, std::filesystem::path> watchedDirectories;
+
+    void addWatches(const std::filesystem::path& directory);
+    void readEvents();
+#endif
+
+    void watchLoop();
+    void recordChange(std::filesystem::path path);
+    int millisecondsUntilFlush() const;
+    void flushIfDue();
+    void closeHandles();
+public:
+    explicit DirectoryWatcher(std::chrono::milliseconds debounce = std::chrono::milliseconds(250),
+                              std::chrono::milliseconds maxDelay = std::chrono::milliseconds(2000));
+    ~DirectoryWatcher();
+
+    DirectoryWatcher(const DirectoryWatcher&) = delete;
+    DirectoryWatcher& operator=(const DirectoryWatcher&) = delete;
+
+    bool start(const std::filesystem::path& directory, ChangeCallback callback);
+    void stop();
+    bool running() const;
+};
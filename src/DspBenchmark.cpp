@@ -0,0 +1,178 @@
+#include "DspBenchmark.h"
+
+namespace {
+    constexpr size_t BLOCK_FRAMES = 1152;
+    constexpr int GAIN_RATE = 44100, GAIN_CHANNELS = 2;
+    constexpr size_t GAIN_BLOCK_SAMPLES = 4096;
+    constexpr int SDL_MAX_VOLUME = 128;
+    constexpr double PI = 3.14159265358979323846;
+
+    const char* qualityName(Resampler::Quality quality) {
+        return (quality == Resampler::Quality::Linear) ? "linear" : "sinc";
+    }
+
+    // What the audio callback did before GainStage: clear the stream, then SDL_MixAudioFormat
+    // the buffer into it with an integer volume from 0 to 128.
+    void mixSdl(const int16_t* input, int16_t* output, size_t count, int volume) {
+        std::memset(output, 0, count * sizeof(int16_t));
+        for (size_t i = 0; i < count; i++) {
+            int mixed = output[i] + input[i] * volume / SDL_MAX_VOLUME;
+            output[i] = static_cast<int16_t>(std::clamp(mixed, -32768, 32767));
+        }
+    }
+}
+
+int DspBenchmark::runResampleCommandLine(const std::vector<std::string>& arguments) {
+    int outputRate = 44100, outputChannels = 2;
+    double seconds = 60.0;
+
+    for (size_t i = 1; i < arguments.size(); i++) {
+        if (arguments[i] == "--rate" && i + 1 < arguments.size()) outputRate = std::atoi(arguments[++i].c_str());
+        else if (arguments[i] == "--channels" && i + 1 < arguments.size()) outputChannels = std::atoi(arguments[++i].c_str());
+        else if (arguments[i] == "--seconds" && i + 1 < arguments.size()) seconds = std::atof(arguments[++i].c_str());
+        else {
+            outputRate = 0;
+            break;
+        }
+    }
+
+    if (outputRate <= 0 || outputChannels < 1 || outputChannels > 2 || seconds <= 0.0) {
+        std::cerr << "usage: CLP --bench-resample [--rate HZ] [--channels 1|2] [--seconds N]\n";
+        return 2;
+    }
+
+    for (Resampler::Quality quality : { Resampler::Quality::Linear, Resampler::Quality::Sinc }) {
+        for (int inputRate : { 32000, 44100, 48000 }) {
+            for (int inputChannels : { 1, 2 })
+                printResampleResult(measureResample(quality, inputRate, inputChannels, outputRate, outputChannels, seconds), std::cout);
+        }
+    }
+    return 0;
+}
+
+int DspBenchmark::runGainCommandLine(const std::vector<std::string>& arguments) {
+    double seconds = 600.0;
+
+    for (size_t i = 1; i < arguments.size(); i++) {
+        if (arguments[i] == "--seconds" && i + 1 < arguments.size()) seconds = std::atof(arguments[++i].c_str());
+        else seconds = 0.0;
+    }
+
+    if (seconds <= 0.0) {
+        std::cerr << "usage: CLP --bench-gain [--seconds N]\n";
+        return 2;
+    }
+
+    GainResult baseline = measureGain("sdl-mix", "scalar", seconds, [](const int16_t* input, int16_t* output, size_t count, size_t) {
+        mixSdl(input, output, count, 70 * SDL_MAX_VOLUME / 100);
+    });
+    printGainResult(baseline, baseline.processSeconds, std::cout);
+
+    printGainResult(measureGain("constant", GainStage::kernelName(), seconds, [](const int16_t* input, int16_t* output, size_t count, size_t) {
+        GainStage::applyGain(input, output, count, 0.7f);
+    }), baseline.processSeconds, std::cout);
+
+    // The ramp spans the whole block and the target alternates, so every sample is ramped.
+    for (GainStage::Ramp ramp : { GainStage::Ramp::Linear, GainStage::Ramp::Exponential }) {
+        GainStage stage;
+        stage.configure(GAIN_CHANNELS, GAIN_BLOCK_SAMPLES / GAIN_CHANNELS, ramp);
+        std::string path = (ramp == GainStage::Ramp::Linear) ? "ramp-linear" : "ramp-exponential";
+
+        printGainResult(measureGain(path, GainStage::kernelName(), seconds, [&](const int16_t* input, int16_t* output, size_t count, size_t block) {
+            stage.setTarget((block % 2 == 0) ? 0.5f : 0.8f);
+            stage.process(input, output, count);
+        }), baseline.processSeconds, std::cout);
+    }
+    return 0;
+}
+
+// A swept tone with a little noise, so the filter sees a full band rather than silence.
+std::vector<int16_t> DspBenchmark::generateAudio(int sampleRate, int channels, size_t frames) {
+    std::vector<int16_t> samples(frames * channels);
+    std::mt19937 random(sampleRate + channels);
+    std::uniform_real_distribution<double> noise(-1000.0, 1000.0);
+    double phase = 0.0;
+
+    for (size_t frame = 0; frame < frames; frame++) {
+        double frequency = 100.0 + (sampleRate / 2.0 - 100.0) * frame / frames;
+        phase += 2.0 * PI * frequency / sampleRate;
+        for (int channel = 0; channel < channels; channel++)
+            samples[frame * channels + channel] = static_cast<int16_t>(20000.0 * std::sin(phase + channel) + noise(random));
+    }
+    return samples;
+}
+
+DspBenchmark::ResampleResult DspBenchmark::measureResample(Resampler::Quality quality, int inputRate, int inputChannels, int outputRate, int outputChannels, double seconds) {
+    ResampleResult result;
+    result.quality = quality;
+    result.inputRate = inputRate;
+    result.inputChannels = inputChannels;
+    result.outputRate = outputRate;
+    result.outputChannels = outputChannels;
+
+    size_t blocks = std::max<size_t>(1, static_cast<size_t>(seconds * inputRate / BLOCK_FRAMES));
+    std::vector<int16_t> input = generateAudio(inputRate, inputChannels, BLOCK_FRAMES * 64);
+    std::vector<int16_t> output;
+    output.reserve(BLOCK_FRAMES * 4 * outputChannels);
+
+    Resampler resampler;
+    resampler.configure(inputRate, inputChannels, outputRate, outputChannels, quality);
+    result.passthrough = resampler.isPassthrough();
+
+    auto started = std::chrono::steady_clock::now();
+    for (size_t block = 0; block < blocks; block++) {
+        output.clear();
+        resampler.process(&input[(block % 64) * BLOCK_FRAMES * inputChannels], BLOCK_FRAMES, output);
+        result.outputSamples += output.size();
+    }
+    output.clear();
+    resampler.flush(output);
+    result.outputSamples += output.size();
+    result.processSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    result.inputSeconds = static_cast<double>(blocks * BLOCK_FRAMES) / inputRate;
+    return result;
+}
+
+void DspBenchmark::printResampleResult(const ResampleResult& result, std::ostream& out) {
+    double samplesPerSecond = (result.processSeconds > 0.0) ? result.outputSamples / result.processSeconds : 0.0;
+    double realtimeFactor = (result.processSeconds > 0.0) ? result.inputSeconds / result.processSeconds : 0.0;
+
+    out << "{\"quality\":\"" << qualityName(result.quality) << "\""
+        << ",\"input_rate\":" << result.inputRate
+        << ",\"input_channels\":" << result.inputChannels
+        << ",\"output_rate\":" << result.outputRate
+        << ",\"output_channels\":" << result.outputChannels
+        << ",\"passthrough\":" << (result.passthrough ? "true" : "false")
+        << ",\"output_samples\":" << result.outputSamples
+        << ",\"samples_per_second\":" << samplesPerSecond
+        << ",\"realtime_factor\":" << realtimeFactor
+        << "}\n";
+}
+
+DspBenchmark::GainResult DspBenchmark::measureGain(const std::string& path, const char* kernel, double seconds, const GainFunction& apply) {
+    GainResult result;
+    result.path = path;
+    result.kernel = kernel;
+
+    size_t blocks = std::max<size_t>(1, static_cast<size_t>(seconds * GAIN_RATE * GAIN_CHANNELS / GAIN_BLOCK_SAMPLES));
+    std::vector<int16_t> input = generateAudio(GAIN_RATE, GAIN_CHANNELS, GAIN_BLOCK_SAMPLES / GAIN_CHANNELS * 64);
+    std::vector<int16_t> output(GAIN_BLOCK_SAMPLES);
+
+    auto started = std::chrono::steady_clock::now();
+    for (size_t block = 0; block < blocks; block++) apply(&input[(block % 64) * GAIN_BLOCK_SAMPLES], output.data(), GAIN_BLOCK_SAMPLES, block);
+    result.processSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    result.samples = blocks * GAIN_BLOCK_SAMPLES;
+    return result;
+}
+
+void DspBenchmark::printGainResult(const GainResult& result, double baselineSeconds, std::ostream& out) {
+    double samplesPerSecond = (result.processSeconds > 0.0) ? result.samples / result.processSeconds : 0.0;
+    double speedup = (result.processSeconds > 0.0) ? baselineSeconds / result.processSeconds : 0.0;
+
+    out << "{\"path\":\"" << result.path << "\""
+        << ",\"kernel\":\"" << result.kernel << "\""
+        << ",\"samples\":" << result.samples
+        << ",\"samples_per_second\":" << samplesPerSecond
+        << ",\"speedup\":" << speedup
+        << "}\n";
+}
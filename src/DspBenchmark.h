@@ -0,0 +1,39 @@
+#pragma once
+#include "headers.hpp"
+#include "Resampler.h"
+#include "GainStage.h"
+
+// `--bench-resample` mode: converts generated audio at 32, 44.1 and 48 kHz, mono and stereo,
+// to the output format at each resampler quality, in blocks the size of an MP3 frame. Prints
+// one JSON object per line with the output samples per second and the realtime factor.
+// `--bench-gain` mode: applies volume to generated stereo audio with the old 0-128 integer
+// mix, the GainStage kernel at a constant gain and GainStage ramping on every block, and
+// prints the samples per second of each.
+class DspBenchmark {
+private:
+    struct ResampleResult {
+        Resampler::Quality quality = Resampler::Quality::Sinc;
+        int inputRate = 0, inputChannels = 0, outputRate = 0, outputChannels = 0;
+        bool passthrough = false;
+        uint64_t outputSamples = 0;
+        double inputSeconds = 0.0, processSeconds = 0.0;
+    };
+
+    struct GainResult {
+        std::string path;
+        const char* kernel = "";
+        uint64_t samples = 0;
+        double processSeconds = 0.0;
+    };
+
+    using GainFunction = std::function<void(const int16_t* input, int16_t* output, size_t count, size_t block)>;
+
+    static std::vector<int16_t> generateAudio(int sampleRate, int channels, size_t frames);
+    static ResampleResult measureResample(Resampler::Quality quality, int inputRate, int inputChannels, int outputRate, int outputChannels, double seconds);
+    static void printResampleResult(const ResampleResult& result, std::ostream& out);
+    static GainResult measureGain(const std::string& path, const char* kernel, double seconds, const GainFunction& apply);
+    static void printGainResult(const GainResult& result, double baselineSeconds, std::ostream& out);
+public:
+    static int runResampleCommandLine(const std::vector<std::string>& arguments);
+    static int runGainCommandLine(const std::vector<std::string>& arguments);
+};
@@ -1,119 +1,381 @@
 #include "FilesystemModule.h"
+#include "DecoderRegistry.h"
+#include "LoudnessAnalyzer.h"
+#include "Id3Reader.h"
 
-void FilesystemModule::readMusicList() {
-    if (!fileList.empty()) fileList.clear();
+FilesystemModule::FilesystemModule(std::filesystem::path musicDirectory, std::filesystem::path cachePath, size_t scanThreads)
+    : currentPath(std::move(musicDirectory)), libraryCache(std::move(cachePath)), scanPool(std::max<size_t>(scanThreads, 1)) {}
 
-    for (const auto& entry : std::filesystem::directory_iterator(currentPath)) {
-        if (std::filesystem::is_regular_file(entry.status())) {
-            std::ifstream file(entry.path(), std::ios::binary);
+FilesystemModule::~FilesystemModule() {
+    stopWatching();
+    cancelScan();
+    cancelAnalysis();
 
-            std::array<uint8_t, 10> headerData;
-            if (!file.read(reinterpret_cast<char*>(headerData.data()), 10)) { 
-                file.close();
-                continue; 
-            }
+    std::lock_guard<std::mutex> listLock(fileListMutex);
+    saveCache();
+}
 
-            MP3_Header header = recieveHeader(headerData.data());
-            if (std::memcmp(header.fileID, "ID3", 3) != 0) {
-                file.close();
-                continue;
-            }
-            file.close();
+void FilesystemModule::readMusicList(TrackFoundCallback trackFound, std::function<void()> scanFinished) {
+    cancelScan();
+    cancelAnalysis();
 
-            std::optional<std::wstring> songName = recieveSongName(entry.path());
-            if (songName) fileList[*songName] = { FileType::MP3, entry.path() };
-        }
-        else if (std::filesystem::is_directory(entry.status())) {
-            fileList[entry.path().filename().wstring()] = { FileType::DIR, entry.path() };
+    {
+        std::lock_guard<std::mutex> listLock(fileListMutex);
+        namesByPath.clear();
+        trackGains.clear();
+        pendingAnalysis.clear();
+
+        if (!cacheLoaded) {
+            libraryCache.load();
+            cacheLoaded = true;
         }
+        libraryCache.beginScan();
     }
+
+    onTrackFound = std::move(trackFound);
+    onScanFinished = std::move(scanFinished);
+
+    scanTasks.store(1);
+    scanPool.submit([this, root = currentPath] { scanDirectory(root); });
 }
 
-std::optional<std::wstring> FilesystemModule::recieveSongName(std::filesystem::path pathToSong) {
-    std::ifstream file(pathToSong, std::ios::binary);
-    if (!file) return L"";
+bool FilesystemModule::watchLibrary(LibraryChangedCallback libraryChanged) {
+    libraryWatcher.stop();
+    onLibraryChanged = std::move(libraryChanged);
+    return libraryWatcher.start(currentPath, [this](std::vector<std::filesystem::path> paths) { applyChanges(paths); });
+}
 
-    file.seekg(0, std::ios::end);
-    std::streamsize size = file.tellg();
-    file.seekg(0, std::ios::beg);
+void FilesystemModule::stopWatching() {
+    libraryWatcher.stop();
+}
 
-    std::array<uint8_t, 10> headerData;
-    if (!file.read(reinterpret_cast<char*>(headerData.data()), 10)) return std::nullopt;
-    MP3_Header header = recieveHeader(headerData.data());
-    if (std::memcmp(header.fileID, "ID3", 3) != 0) return std::nullopt;
+void FilesystemModule::cancelScan() {
+    scanCancelled.store(true);
+    scanPool.waitIdle();
+    scanCancelled.store(false);
+}
 
-    std::vector<uint8_t> data(header.tagSize);
-    file.seekg(10, std::ios::beg);
-    if (!file.read(reinterpret_cast<char*>(data.data()), header.tagSize)) return std::nullopt;
+void FilesystemModule::cancelAnalysis() {
+    analysisCancelled.store(true);
+    analysisPool.waitIdle();
+    analysisCancelled.store(false);
+}
 
-    size_t pos = 0;
-    std::pair<std::wstring, std::wstring> songArtistAndName;
-    while (pos < data.size()) {
-        std::string tag(reinterpret_cast<char*>(&data[pos]), 4);
+bool FilesystemModule::scanning() const {
+    return scanTasks.load() > 0;
+}
 
-        uint32_t sectionSize = ((data[pos + 4] << 24) | (data[pos + 5] << 16) | (data[pos + 6] << 8) | (data[pos + 7]));
+void FilesystemModule::scanDirectory(const std::filesystem::path& directory) {
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+        if (scanCancelled.load()) break;
 
-        if (!std::isalnum(tag[0])) break;
-        if (tag != "TIT2" && tag != "TPE1") {
-            pos += sectionSize + 10;
+        if (entry.is_directory(error)) {
+            scanTasks.fetch_add(1);
+            scanPool.submit([this, subdirectory = entry.path()] { scanDirectory(subdirectory); });
             continue;
         }
+        if (!entry.is_regular_file(error)) continue;
 
-        uint32_t sectionStart = pos + 10;
-        uint8_t encoding = data[sectionStart];
-        std::wstring extractedText;
+        uint64_t fileSize = entry.file_size(error);
+        if (error) continue;
+        int64_t modifiedTime = entry.last_write_time(error).time_since_epoch().count();
+        if (error) continue;
 
-        switch (encoding) {
-        case 0: {
-            extractedText = std::wstring(data.begin() + sectionStart + 1, data.begin() + sectionStart + sectionSize);
-            break;
+        std::optional<TrackMetadata> cached;
+        {
+            std::lock_guard<std::mutex> listLock(fileListMutex);
+            const TrackMetadata* found = libraryCache.find(entry.path(), fileSize, modifiedTime);
+            if (found) cached = *found;
         }
 
-        case 1: {
-            const wchar_t* namePtr = reinterpret_cast<wchar_t*>(&data[sectionStart + 1]);
-            uint32_t textSize = sectionSize - 1;
+        if (cached) {
+            publishTrack(*cached, entry.path(), fileSize, modifiedTime);
+        }
+        else {
+            scanTasks.fetch_add(1);
+            scanPool.submit([this, pathToSong = entry.path(), fileSize, modifiedTime] {
+                scanFile(pathToSong, fileSize, modifiedTime);
+            });
+        }
+    }
 
-            uint16_t bom = ((data[sectionStart + 1] << 8) | data[sectionStart + 2]);
-            if (bom == 0xFEFF || bom == 0xFFFE) {
-                textSize -= 1;
-                namePtr += 1;
-            }
+    finishScanTask();
+}
 
-            uint32_t charCount = textSize / 2;
-            extractedText = std::wstring(namePtr, charCount);
-            break;
+void FilesystemModule::scanFile(const std::filesystem::path& pathToSong, uint64_t fileSize, int64_t modifiedTime) {
+    if (!scanCancelled.load()) {
+        TrackMetadata metadata = readTrackMetadata(pathToSong);
+        {
+            std::lock_guard<std::mutex> listLock(fileListMutex);
+            libraryCache.store(pathToSong, fileSize, modifiedTime, metadata);
         }
+        publishTrack(metadata, pathToSong, fileSize, modifiedTime);
+    }
 
-        case 2: {
-            const wchar_t* namePtr = reinterpret_cast<wchar_t*>(&data[sectionStart + 1]);
-            uint32_t charCount = (sectionSize - 1) / 2;
-            extractedText = std::wstring(namePtr, charCount);
-            break;
-        }
+    finishScanTask();
+}
 
-        case 3: {
-            std::string utf8str(reinterpret_cast<const char*>(&data[sectionStart + 1]), sectionSize - 1);
-            std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
-            extractedText = converter.from_bytes(utf8str);
-            break;
-        }
+void FilesystemModule::publishTrack(const TrackMetadata& metadata, const std::filesystem::path& pathToSong, uint64_t fileSize, int64_t modifiedTime) {
+    if (!metadata.playable) return;
+
+    std::wstring name;
+    {
+        std::lock_guard<std::mutex> listLock(fileListMutex);
+        name = indexTrack(metadata, pathToSong, fileSize, modifiedTime);
+    }
+
+    if (onTrackFound != nullptr) onTrackFound(libraryTrack(metadata, std::move(name), pathToSong));
+}
+
+// indexTrack and unindexTrack expect fileListMutex to be held.
+std::wstring FilesystemModule::indexTrack(const TrackMetadata& metadata, const std::filesystem::path& pathToSong, uint64_t fileSize, int64_t modifiedTime) {
+    std::wstring name = songDisplayName(metadata, pathToSong);
+    namesByPath[pathToSong.wstring()] = name;
+    trackGains[pathToSong.wstring()] = { pathToSong.parent_path().wstring(), metadata.replayGain, metadata.duration() };
+    if (!metadata.replayGain.known()) pendingAnalysis.push_back({ pathToSong, fileSize, modifiedTime });
+    return name;
+}
+
+std::optional<std::wstring> FilesystemModule::unindexTrack(const std::wstring& pathKey) {
+    auto indexed = namesByPath.find(pathKey);
+    if (indexed == namesByPath.end()) return std::nullopt;
+
+    std::wstring name = std::move(indexed->second);
+    namesByPath.erase(indexed);
+    trackGains.erase(pathKey);
+    return name;
+}
+
+// Callers hold fileListMutex.
+void FilesystemModule::saveCache() {
+    libraryCache.save();
+    cacheSaved = std::chrono::steady_clock::now();
+}
+
+void FilesystemModule::applyChanges(const std::vector<std::filesystem::path>& paths) {
+    LibraryChanges changes;
+
+    for (const std::filesystem::path& path : paths) {
+        std::error_code error;
+        std::filesystem::file_status status = std::filesystem::status(path, error);
+
+        if (std::filesystem::is_directory(status)) refreshDirectory(path, changes);
+        else if (std::filesystem::is_regular_file(status)) refreshFile(path, changes);
+        else removeTracksUnder(path, changes);
+    }
+
+    {
+        std::lock_guard<std::mutex> listLock(fileListMutex);
+        if (std::chrono::steady_clock::now() - cacheSaved >= CACHE_SAVE_INTERVAL) saveCache();
+    }
+    startAnalysis();
+
+    if (onLibraryChanged != nullptr && (!changes.added.empty() || !changes.removed.empty())) onLibraryChanged(changes);
+}
+
+void FilesystemModule::refreshFile(const std::filesystem::path& pathToSong, LibraryChanges& changes) {
+    std::error_code error;
+    uint64_t fileSize = std::filesystem::file_size(pathToSong, error);
+    if (error) return;
+    int64_t modifiedTime = std::filesystem::last_write_time(pathToSong, error).time_since_epoch().count();
+    if (error) return;
+
+    std::optional<TrackMetadata> metadata;
+    {
+        std::lock_guard<std::mutex> listLock(fileListMutex);
+        const TrackMetadata* found = libraryCache.find(pathToSong, fileSize, modifiedTime);
+        if (found) metadata = *found;
+    }
+    bool reread = !metadata;
+    if (reread) {
+        metadata = readTrackMetadata(pathToSong);
+        std::lock_guard<std::mutex> listLock(fileListMutex);
+        libraryCache.store(pathToSong, fileSize, modifiedTime, *metadata);
+    }
+
+    std::lock_guard<std::mutex> listLock(fileListMutex);
+    std::optional<std::wstring> previousName = unindexTrack(pathToSong.wstring());
+    std::optional<std::wstring> name;
+    if (metadata->playable) name = indexTrack(*metadata, pathToSong, fileSize, modifiedTime);
+
+    if (previousName == name && !reread) return;
+    if (previousName) changes.removed.push_back(pathToSong);
+    if (name) changes.added.push_back(libraryTrack(*metadata, std::move(*name), pathToSong));
+}
+
+// Reconciles a whole subtree: after an overflow, or when a directory is created or moved in.
+void FilesystemModule::refreshDirectory(const std::filesystem::path& directory, LibraryChanges& changes) {
+    std::unordered_set<std::wstring> present;
+    std::error_code error;
+
+    for (auto it = std::filesystem::recursive_directory_iterator(directory, error);
+        it != std::filesystem::recursive_directory_iterator(); it.increment(error))
+    {
+        if (error) break;
+        if (!it->is_regular_file(error)) continue;
+
+        present.insert(it->path().wstring());
+        refreshFile(it->path(), changes);
+    }
+
+    removeTracksUnder(directory, changes, &present);
+}
+
+void FilesystemModule::removeTracksUnder(const std::filesystem::path& path, LibraryChanges& changes, const std::unordered_set<std::wstring>* keep) {
+    std::wstring prefix = path.wstring();
+    std::vector<std::wstring> removedPaths;
+
+    std::lock_guard<std::mutex> listLock(fileListMutex);
+    for (auto it = namesByPath.lower_bound(prefix); it != namesByPath.end(); ++it) {
+        const std::wstring& indexedPath = it->first;
+        if (indexedPath.compare(0, prefix.size(), prefix) != 0) break;
+
+        bool inside = indexedPath.size() == prefix.size() || indexedPath[prefix.size()] == std::filesystem::path::preferred_separator;
+        if (inside && (keep == nullptr || keep->count(indexedPath) == 0)) removedPaths.push_back(indexedPath);
+    }
+
+    for (const std::wstring& removedPath : removedPaths) {
+        if (unindexTrack(removedPath)) changes.removed.push_back(removedPath);
+    }
+}
+
+void FilesystemModule::finishScanTask() {
+    if (scanTasks.fetch_sub(1) != 1) return;
+
+    {
+        std::lock_guard<std::mutex> listLock(fileListMutex);
+        if (!scanCancelled.load()) libraryCache.pruneUnseen();
+        saveCache();
+    }
+
+    if (scanCancelled.load()) return;
+    startAnalysis();
+    if (onScanFinished != nullptr) onScanFinished();
+}
+
+void FilesystemModule::startAnalysis() {
+    std::vector<PendingAnalysis> tracks;
+    {
+        std::lock_guard<std::mutex> listLock(fileListMutex);
+        if (pendingAnalysis.empty()) return;
+
+        tracks.swap(pendingAnalysis);
+        if (analysisTasks.load() == 0) {
+            analysisStarted = std::chrono::steady_clock::now();
+            tracksAnalysed.store(0);
         }
+    }
 
-        (tag == "TIT2") ? songArtistAndName.second = extractedText : songArtistAndName.first = extractedText;
-        pos += sectionSize + 10;
+    analysisTasks.fetch_add(tracks.size());
+    for (PendingAnalysis& track : tracks)
+        analysisPool.submit([this, track = std::move(track)] { analyzeTrack(track); });
+}
+
+void FilesystemModule::analyzeTrack(const PendingAnalysis& track) {
+    if (!analysisCancelled.load()) {
+        LoudnessAnalyzer::Result result = LoudnessAnalyzer::analyze(track.path, &analysisCancelled);
+
+        if (result.analysed && !analysisCancelled.load()) {
+            std::lock_guard<std::mutex> listLock(fileListMutex);
+            ReplayGain gain = result.replayGain();
+            libraryCache.storeReplayGain(track.path, track.fileSize, track.modifiedTime, gain);
+
+            auto entry = trackGains.find(track.path.wstring());
+            if (entry != trackGains.end()) entry->second.replayGain = gain;
+            tracksAnalysed.fetch_add(1);
+        }
     }
 
-    if (songArtistAndName.first.empty()) return pathToSong.filename().wstring();
-    if (songArtistAndName.second.empty()) return songArtistAndName.first;
-   
-    return songArtistAndName.first + L" - " + songArtistAndName.second;
+    finishAnalysisTask();
 }
 
-std::filesystem::path FilesystemModule::getPathByName(std::wstring const& songName) const {
-	return fileList.at(songName).path;
+void FilesystemModule::finishAnalysisTask() {
+    if (analysisTasks.fetch_sub(1) != 1) return;
+
+    std::lock_guard<std::mutex> listLock(fileListMutex);
+    saveCache();
+}
+
+TrackMetadata FilesystemModule::readTrackMetadata(const std::filesystem::path& pathToSong) {
+    TrackMetadata metadata;
+    std::unique_ptr<AudioDecoder> decoder = DecoderRegistry::open(pathToSong);
+    if (!decoder) return metadata;
+
+    metadata.playable = true;
+    metadata.totalSamples = decoder->getTotalFrames();
+    metadata.sampleRate = static_cast<uint32_t>(decoder->getSampleRate());
+
+    recieveSongTags(pathToSong, metadata);
+    return metadata;
+}
+
+bool FilesystemModule::recieveSongTags(const std::filesystem::path& pathToSong, TrackMetadata& metadata) {
+    // Tags sit at the head of the file and cover art is seeked past, so a small buffered
+    // read is cheaper here than mapping the whole file.
+    ChunkedInputSource source(BLOCK_SIZE);
+    if (!source.open(pathToSong)) return false;
+
+    Id3Reader::Tags tags;
+    if (!Id3Reader(source).read(tags)) return false;
+
+    metadata.title = std::move(tags.title);
+    metadata.artist = std::move(tags.artist);
+    metadata.album = std::move(tags.album);
+    metadata.genre = std::move(tags.genre);
+    metadata.trackNumber = tags.trackNumber;
+    metadata.year = tags.year;
+    metadata.replayGain = tags.replayGain;
+
+    // TLEN stands in for the length when the decoder cannot tell it without a full scan.
+    if (metadata.totalSamples == 0 && tags.lengthMilliseconds > 0)
+        metadata.totalSamples = tags.lengthMilliseconds * metadata.sampleRate / 1000;
+    return true;
 }
 
-const std::unordered_map<std::wstring, PlayerFile>& FilesystemModule::getMusicList() {
-    readMusicList();
-    return fileList;
+std::wstring FilesystemModule::songDisplayName(const TrackMetadata& metadata, const std::filesystem::path& pathToSong) {
+    if (metadata.artist.empty()) return pathToSong.filename().wstring();
+    if (metadata.title.empty()) return metadata.artist;
+
+    return metadata.artist + L" - " + metadata.title;
+}
+
+LibraryTrack FilesystemModule::libraryTrack(const TrackMetadata& metadata, std::wstring name, const std::filesystem::path& pathToSong) {
+    return { std::move(name), pathToSong, metadata.title, metadata.artist, metadata.album };
+}
+
+FilesystemModule::AnalysisProgress FilesystemModule::getAnalysisProgress() const {
+    AnalysisProgress progress;
+    progress.analysed = tracksAnalysed.load();
+    progress.remaining = analysisTasks.load();
+
+    std::lock_guard<std::mutex> listLock(fileListMutex);
+    double minutes = std::chrono::duration<double, std::ratio<60>>(std::chrono::steady_clock::now() - analysisStarted).count();
+    if (minutes > 0.0) progress.tracksPerMinute = progress.analysed / minutes;
+    return progress;
+}
+
+ReplayGain FilesystemModule::getReplayGain(const std::filesystem::path& pathToSong) const {
+    std::lock_guard<std::mutex> listLock(fileListMutex);
+    auto found = trackGains.find(pathToSong.wstring());
+    if (found == trackGains.end()) return {};
+
+    ReplayGain gain = found->second.replayGain;
+    if (!gain.known() || gain.hasAlbum) return gain;
+
+    // Without album tags, the tracks of one directory form the album once all of them have a gain.
+    // Only the directory's own range of paths is visited, subdirectories included and skipped.
+    const std::wstring& directory = found->second.directory;
+    std::wstring prefix = found->first.substr(0, directory.size() + 1);
+
+    std::vector<LoudnessAnalyzer::AlbumTrack> album;
+    for (auto entry = trackGains.lower_bound(prefix); entry != trackGains.end() && entry->first.starts_with(prefix); ++entry) {
+        const TrackGain& track = entry->second;
+        if (track.directory != directory) continue;
+        if (!track.replayGain.known()) return gain;
+        album.push_back({ track.replayGain.trackGain, track.replayGain.trackPeak, track.duration });
+    }
+
+    gain.hasAlbum = LoudnessAnalyzer::albumGain(album, gain.albumGain, gain.albumPeak);
+    return gain;
 }
@@ -1,29 +1,111 @@
 #pragma once
 #include "headers.hpp"
+#include "LibraryCache.h"
+#include "ThreadPool.h"
+#include "ReplayGain.h"
+#include "DirectoryWatcher.h"
 
-enum class FileType {
-	NONE,
-	DIR,
-	MP3
-};
-
-struct PlayerFile {
-	FileType type;
+// A playable track as the UI sees it: its display name, its file and the tags search covers.
+struct LibraryTrack {
+	std::wstring name;
 	std::filesystem::path path;
+	std::wstring title, artist, album;
+};
 
-	PlayerFile() : type(FileType::NONE), path(L"") {}
-	PlayerFile(FileType type, std::filesystem::path path) : type(type), path(path) {}
+// Tracks that appeared in or disappeared from the library in one watcher batch. A track
+// whose display name or tags changed is removed and added again.
+struct LibraryChanges {
+	std::vector<LibraryTrack> added;
+	std::vector<std::filesystem::path> removed;
 };
 
+using TrackFoundCallback = std::function<void(const LibraryTrack&)>;
+using LibraryChangedCallback = std::function<void(const LibraryChanges&)>;
 
 class FilesystemModule {
+	struct PendingAnalysis {
+		std::filesystem::path path;
+		uint64_t fileSize;
+		int64_t modifiedTime;
+	};
+
+	struct TrackGain {
+		std::wstring directory;
+		ReplayGain replayGain;
+		double duration;
+	};
+
 	std::filesystem::path currentPath = appPath / "music";
-	std::unordered_map<std::wstring, PlayerFile> fileList = { };
+	LibraryCache libraryCache{ appPath / "library.cache" };
+	bool cacheLoaded = false;
+	// Writing the cache costs time in proportion to the library, so watcher batches save it at
+	// most once per interval. Scans, finished analysis and shutdown always save it.
+	static constexpr std::chrono::seconds CACHE_SAVE_INTERVAL{ 60 };
+	std::chrono::steady_clock::time_point cacheSaved;
+	std::map<std::wstring, std::wstring> namesByPath;
+	// Ordered by path, so the tracks of one directory are a contiguous range.
+	std::map<std::wstring, TrackGain> trackGains;
+	std::vector<PendingAnalysis> pendingAnalysis;
+	std::chrono::steady_clock::time_point analysisStarted;
+
+	mutable std::mutex fileListMutex;
+	ThreadPool scanPool;
+	std::atomic<bool> scanCancelled = false;
+	std::atomic<size_t> scanTasks = 0;
+	TrackFoundCallback onTrackFound;
+	std::function<void()> onScanFinished;
+
+	// Tracks without ReplayGain tags are measured after each scan on idle-priority workers,
+	// leaving one core free for playback and the UI.
+	ThreadPool analysisPool{ std::max(std::thread::hardware_concurrency(), 2u) - 1, ThreadPool::Priority::Background };
+	std::atomic<bool> analysisCancelled = false;
+	std::atomic<size_t> analysisTasks = 0, tracksAnalysed = 0;
 
-	std::optional<std::wstring> recieveSongName(std::filesystem::path pathToSong);	
+	DirectoryWatcher libraryWatcher;
+	LibraryChangedCallback onLibraryChanged;
+
+	void scanDirectory(const std::filesystem::path& directory);
+	void scanFile(const std::filesystem::path& pathToSong, uint64_t fileSize, int64_t modifiedTime);
+	void publishTrack(const TrackMetadata& metadata, const std::filesystem::path& pathToSong, uint64_t fileSize, int64_t modifiedTime);
+	void finishScanTask();
+	std::wstring indexTrack(const TrackMetadata& metadata, const std::filesystem::path& pathToSong, uint64_t fileSize, int64_t modifiedTime);
+	std::optional<std::wstring> unindexTrack(const std::wstring& pathKey);
+
+	void saveCache();
+	void applyChanges(const std::vector<std::filesystem::path>& paths);
+	void refreshFile(const std::filesystem::path& pathToSong, LibraryChanges& changes);
+	void refreshDirectory(const std::filesystem::path& directory, LibraryChanges& changes);
+	void removeTracksUnder(const std::filesystem::path& path, LibraryChanges& changes, const std::unordered_set<std::wstring>* keep = nullptr);
+	void startAnalysis();
+	void analyzeTrack(const PendingAnalysis& track);
+	void finishAnalysisTask();
+
+	TrackMetadata readTrackMetadata(const std::filesystem::path& pathToSong);
+	bool recieveSongTags(const std::filesystem::path& pathToSong, TrackMetadata& metadata);
+	static std::wstring songDisplayName(const TrackMetadata& metadata, const std::filesystem::path& pathToSong);
+	static LibraryTrack libraryTrack(const TrackMetadata& metadata, std::wstring name, const std::filesystem::path& pathToSong);
+
+	friend class SelfTest;
 public:
-	void readMusicList();
-	std::filesystem::path getPathByName(std::wstring const& songName) const;
-	const std::unordered_map<std::wstring, PlayerFile>& getMusicList();
+	struct AnalysisProgress {
+		size_t analysed = 0;
+		size_t remaining = 0;
+		double tracksPerMinute = 0.0;
+	};
+
+	FilesystemModule() = default;
+	// A library somewhere other than the music folder, with its own cache file and scan pool size.
+	FilesystemModule(std::filesystem::path musicDirectory, std::filesystem::path cachePath, size_t scanThreads = std::thread::hardware_concurrency());
+	~FilesystemModule();
+
+	void readMusicList(TrackFoundCallback trackFound = nullptr, std::function<void()> scanFinished = nullptr);
+	bool watchLibrary(LibraryChangedCallback libraryChanged);
+	// Returns once no change callback is running or will run.
+	void stopWatching();
+	void cancelScan();
+	void cancelAnalysis();
+	bool scanning() const;
+	AnalysisProgress getAnalysisProgress() const;
+	ReplayGain getReplayGain(const std::filesystem::path& pathToSong) const;
 };
 
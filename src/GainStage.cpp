@@ -0,0 +1,187 @@
+#include "GainStage.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define GAIN_STAGE_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define TARGET_SSE2
+#define TARGET_AVX2
+#else
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+    int16_t saturate(float value) {
+        if (value >= 32767.0f) return 32767;
+        if (value <= -32768.0f) return -32768;
+        return static_cast<int16_t>(std::lrint(value));
+    }
+
+    void gainScalar(const int16_t* input, int16_t* output, size_t count, float gain) {
+        for (size_t i = 0; i < count; i++) output[i] = saturate(input[i] * gain);
+    }
+
+#ifdef GAIN_STAGE_X86
+    TARGET_SSE2 void gainSse2(const int16_t* input, int16_t* output, size_t count, float gain) {
+        __m128 gains = _mm_set1_ps(gain);
+        size_t i = 0;
+
+        for (; i + 8 <= count; i += 8) {
+            __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+            __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+            __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+
+            low = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(low), gains));
+            high = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(high), gains));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), _mm_packs_epi32(low, high));
+        }
+
+        gainScalar(input + i, output + i, count - i, gain);
+    }
+
+    TARGET_AVX2 void gainAvx2(const int16_t* input, int16_t* output, size_t count, float gain) {
+        __m256 gains = _mm256_set1_ps(gain);
+        size_t i = 0;
+
+        for (; i + 16 <= count; i += 16) {
+            __m256i samples = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i));
+            __m256i low = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(samples));
+            __m256i high = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(samples, 1));
+
+            low = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(low), gains));
+            high = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(high), gains));
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(low, high), 0xD8);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i), packed);
+        }
+
+        gainSse2(input + i, output + i, count - i, gain);
+    }
+
+    bool cpuSupportsAvx2() {
+#if defined(_MSC_VER)
+        int registers[4] = {};
+        __cpuid(registers, 0);
+        if (registers[0] < 7) return false;
+
+        __cpuid(registers, 1);
+        bool osSavesYmm = (registers[2] & (1 << 27)) && (registers[2] & (1 << 28))
+            && (_xgetbv(0) & 0x6) == 0x6;
+        if (!osSavesYmm) return false;
+
+        __cpuidex(registers, 7, 0);
+        return (registers[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+
+    bool cpuSupportsSse2() {
+#if defined(_M_X64) || defined(__x86_64__)
+        return true;
+#elif defined(_MSC_VER)
+        int registers[4] = {};
+        __cpuid(registers, 1);
+        return (registers[3] & (1 << 26)) != 0;
+#else
+        return __builtin_cpu_supports("sse2");
+#endif
+    }
+#endif
+
+    struct KernelChoice {
+        GainStage::Kernel kernel;
+        const char* name;
+    };
+
+    KernelChoice selectKernel() {
+#ifdef GAIN_STAGE_X86
+        if (cpuSupportsAvx2()) return { gainAvx2, "avx2" };
+        if (cpuSupportsSse2()) return { gainSse2, "sse2" };
+#endif
+        return { gainScalar, "scalar" };
+    }
+
+    const KernelChoice& kernelChoice() {
+        static const KernelChoice choice = selectKernel();
+        return choice;
+    }
+}
+
+GainStage::Kernel GainStage::kernel() {
+    return kernelChoice().kernel;
+}
+
+const char* GainStage::kernelName() {
+    return kernelChoice().name;
+}
+
+void GainStage::applyGain(const int16_t* input, int16_t* output, size_t count, float gain) {
+    if (gain == 1.0f) {
+        if (input != output) std::memmove(output, input, count * sizeof(int16_t));
+        return;
+    }
+    if (gain == 0.0f) {
+        std::memset(output, 0, count * sizeof(int16_t));
+        return;
+    }
+
+    kernel()(input, output, count, gain);
+}
+
+void GainStage::configure(int channels, size_t rampFrames, Ramp ramp) {
+    this->channels = std::max(channels, 1);
+    this->rampFrames = rampFrames;
+    this->ramp = ramp;
+    currentGain = targetGain;
+    rampRemaining = 0;
+}
+
+void GainStage::setTarget(float gain) {
+    gain = std::max(gain, 0.0f);
+    if (gain == targetGain) return;
+
+    targetGain = gain;
+    rampRemaining = rampFrames;
+    if (rampRemaining == 0) {
+        currentGain = targetGain;
+        return;
+    }
+
+    if (ramp == Ramp::Linear) {
+        gainStep = (targetGain - currentGain) / rampRemaining;
+        return;
+    }
+
+    currentGain = std::max(currentGain, MIN_RAMP_GAIN);
+    gainStep = std::pow(std::max(targetGain, MIN_RAMP_GAIN) / currentGain, 1.0f / rampRemaining);
+}
+
+size_t GainStage::applyRamp(const int16_t* input, int16_t* output, size_t count) {
+    size_t frames = std::min(count / channels, rampRemaining);
+
+    for (size_t frame = 0; frame < frames; frame++) {
+        for (int channel = 0; channel < channels; channel++) {
+            size_t i = frame * channels + channel;
+            output[i] = saturate(input[i] * currentGain);
+        }
+
+        if (ramp == Ramp::Linear) currentGain += gainStep;
+        else currentGain *= gainStep;
+    }
+
+    rampRemaining -= frames;
+    if (rampRemaining == 0) currentGain = targetGain;
+    return frames * channels;
+}
+
+void GainStage::process(const int16_t* input, int16_t* output, size_t count) {
+    size_t ramped = (rampRemaining > 0) ? applyRamp(input, output, count) : 0;
+    applyGain(input + ramped, output + ramped, count - ramped, currentGain);
+}
+
+float GainStage::getGain() const {
+    return currentGain;
+}
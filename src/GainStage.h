@@ -0,0 +1,34 @@
+#pragma once
+#include "headers.hpp"
+
+// Applies volume to interleaved int16 PCM with saturation. Gain changes are ramped per
+// frame instead of stepped, and the constant-gain path runs on the widest SIMD kernel
+// the CPU supports (AVX2, SSE2 or portable scalar), picked once at startup.
+class GainStage {
+public:
+    enum class Ramp {
+        Linear,
+        Exponential
+    };
+
+    using Kernel = void (*)(const int16_t* input, int16_t* output, size_t count, float gain);
+private:
+    static constexpr float MIN_RAMP_GAIN = 0.0001f;
+
+    Ramp ramp = Ramp::Exponential;
+    float currentGain = 1.0f, targetGain = 1.0f, gainStep = 0.0f;
+    size_t rampFrames = 441, rampRemaining = 0;
+    int channels = 2;
+
+    size_t applyRamp(const int16_t* input, int16_t* output, size_t count);
+public:
+    void configure(int channels, size_t rampFrames, Ramp ramp);
+    void setTarget(float gain);
+    void process(const int16_t* input, int16_t* output, size_t count);
+
+    float getGain() const;
+
+    static void applyGain(const int16_t* input, int16_t* output, size_t count, float gain);
+    static Kernel kernel();
+    static const char* kernelName();
+};
@@ -0,0 +1,468 @@
+#include "Id3Reader.h"
+
+namespace {
+    constexpr const char* GENRES[] = {
+        "Blues", "Classic Rock", "Country", "Dance", "Disco", "Funk", "Grunge", "Hip-Hop", "Jazz", "Metal",
+        "New Age", "Oldies", "Other", "Pop", "R&B", "Rap", "Reggae", "Rock", "Techno", "Industrial",
+        "Alternative", "Ska", "Death Metal", "Pranks", "Soundtrack", "Euro-Techno", "Ambient", "Trip-Hop", "Vocal", "Jazz+Funk",
+        "Fusion", "Trance", "Classical", "Instrumental", "Acid", "House", "Game", "Sound Clip", "Gospel", "Noise",
+        "AlternRock", "Bass", "Soul", "Punk", "Space", "Meditative", "Instrumental Pop", "Instrumental Rock", "Ethnic", "Gothic",
+        "Darkwave", "Techno-Industrial", "Electronic", "Pop-Folk", "Eurodance", "Dream", "Southern Rock", "Comedy", "Cult", "Gangsta",
+        "Top 40", "Christian Rap", "Pop/Funk", "Jungle", "Native American", "Cabaret", "New Wave", "Psychadelic", "Rave", "Showtunes",
+        "Trailer", "Lo-Fi", "Tribal", "Acid Punk", "Acid Jazz", "Polka", "Retro", "Musical", "Rock & Roll", "Hard Rock",
+        "Folk", "Folk-Rock", "National Folk", "Swing", "Fast Fusion", "Bebob", "Latin", "Revival", "Celtic", "Bluegrass",
+        "Avantgarde", "Gothic Rock", "Progressive Rock", "Psychedelic Rock", "Symphonic Rock", "Slow Rock", "Big Band", "Chorus", "Easy Listening", "Acoustic",
+        "Humour", "Speech", "Chanson", "Opera", "Chamber Music", "Sonata", "Symphony", "Booty Bass", "Primus", "Porn Groove",
+        "Satire", "Slow Jam", "Club", "Tango", "Samba", "Folklore", "Ballad", "Power Ballad", "Rhythmic Soul", "Freestyle",
+        "Duet", "Punk Rock", "Drum Solo", "A capella", "Euro-House", "Dance Hall"
+    };
+
+    // ID3v2.2 uses three-character frame ids; only the ones read here are mapped.
+    constexpr std::array<std::pair<const char*, const char*>, 8> V22_FRAME_IDS = { {
+        { "TT2", "TIT2" }, { "TP1", "TPE1" }, { "TAL", "TALB" }, { "TRK", "TRCK" },
+        { "TYE", "TYER" }, { "TCO", "TCON" }, { "TLE", "TLEN" }, { "TXX", "TXXX" }
+    } };
+
+    constexpr std::array<const char*, 10> WANTED_FRAMES = {
+        "TIT2", "TPE1", "TALB", "TRCK", "TYER", "TDRC", "TCON", "TLEN", "TXXX", "RVA2"
+    };
+
+    bool validIdCharacter(uint8_t c) {
+        return (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+    }
+
+    uint32_t syncsafe(const uint8_t* bytes) {
+        return (bytes[0] & 0x7F) << 21 | (bytes[1] & 0x7F) << 14 | (bytes[2] & 0x7F) << 7 | (bytes[3] & 0x7F);
+    }
+
+    uint32_t bigEndian(const uint8_t* bytes, size_t count) {
+        uint32_t result = 0;
+        for (size_t i = 0; i < count; i++) result = (result << 8) | bytes[i];
+        return result;
+    }
+
+    size_t removeUnsynchronisation(uint8_t* data, size_t size) {
+        size_t written = 0;
+        for (size_t i = 0; i < size; i++) {
+            data[written++] = data[i];
+            if (data[i] == 0xFF && i + 1 < size && data[i + 1] == 0x00) i++;
+        }
+        return written;
+    }
+
+    // Fields that are parsed rather than kept (numbers, TXXX descriptions and values) are
+    // decoded onto the stack; anything past the capacity is dropped.
+    class ShortText {
+    private:
+        std::array<wchar_t, 64> characters;
+        size_t length = 0;
+    public:
+        void clear() {
+            length = 0;
+            characters[0] = 0;
+        }
+
+        void push_back(wchar_t c) {
+            if (length + 1 >= characters.size()) return;
+            characters[length++] = c;
+            characters[length] = 0;
+        }
+
+        const wchar_t* c_str() const { return characters.data(); }
+        const wchar_t* begin() const { return characters.data(); }
+        const wchar_t* end() const { return characters.data() + length; }
+        size_t size() const { return length; }
+        wchar_t operator[](size_t index) const { return characters[index]; }
+    };
+
+    template <typename Text>
+    void appendCodePoint(Text& out, char32_t codePoint) {
+        if constexpr (sizeof(wchar_t) == 2) {
+            if (codePoint > 0xFFFF) {
+                codePoint -= 0x10000;
+                out.push_back(static_cast<wchar_t>(0xD800 + (codePoint >> 10)));
+                out.push_back(static_cast<wchar_t>(0xDC00 + (codePoint & 0x3FF)));
+                return;
+            }
+        }
+        out.push_back(static_cast<wchar_t>(codePoint));
+    }
+
+    bool equalsAscii(const ShortText& text, const char* ascii) {
+        size_t length = std::strlen(ascii);
+        if (text.size() != length) return false;
+
+        for (size_t i = 0; i < length; i++) {
+            wchar_t c = (text[i] >= L'a' && text[i] <= L'z') ? text[i] - (L'a' - L'A') : text[i];
+            if (c != static_cast<wchar_t>(ascii[i])) return false;
+        }
+        return true;
+    }
+
+    bool parseNumber(const ShortText& text, float& number) {
+        const wchar_t* start = text.c_str();
+        wchar_t* end = nullptr;
+        number = std::wcstof(start, &end);
+        return end != start && std::isfinite(number);
+    }
+
+    uint32_t leadingNumber(const ShortText& text) {
+        uint64_t number = 0;
+        for (wchar_t c : text) {
+            if (c < L'0' || c > L'9') break;
+            number = std::min<uint64_t>(number * 10 + (c - L'0'), UINT32_MAX);
+        }
+        return static_cast<uint32_t>(number);
+    }
+}
+
+void Id3Reader::Tags::clear() {
+    title.clear();
+    artist.clear();
+    album.clear();
+    genre.clear();
+    trackNumber = 0;
+    year = 0;
+    lengthMilliseconds = 0;
+    replayGain = {};
+}
+
+Id3Reader::Id3Reader(InputSource& source) : source(source) {}
+
+bool Id3Reader::read(Tags& tags) {
+    tags.clear();
+    trackGainFound = false;
+
+    uint8_t header[10];
+    if (!source.seek(0) || source.fill(10) < 10) return false;
+    std::memcpy(header, source.data(), 10);
+    source.consume(10);
+
+    if (std::memcmp(header, "ID3", 3) != 0 || header[3] < 2 || header[3] > 4 || header[4] == 0xFF) return false;
+    if ((header[6] | header[7] | header[8] | header[9]) & 0x80) return false;
+
+    version = header[3];
+    uint8_t flags = header[5];
+    tagEnd = std::min<uint64_t>(10 + syncsafe(header + 6), source.size());
+    tagUnsynchronised = (flags & 0x80) != 0 && version < 4;
+    previousByte = 0;
+
+    if (version == 2 && (flags & 0x40)) return false;
+    if (version >= 3 && (flags & 0x40)) {
+        uint8_t sizeBytes[4];
+        if (!readBytes(sizeBytes, 4)) return false;
+        uint64_t extendedSize = (version == 3) ? bigEndian(sizeBytes, 4) : syncsafe(sizeBytes) - std::min<uint32_t>(syncsafe(sizeBytes), 4);
+        if (!skipBytes(extendedSize)) return false;
+    }
+
+    size_t headerSize = (version == 2) ? 6 : 10;
+    while (source.position() + headerSize <= tagEnd) {
+        uint8_t frameHeader[10];
+        if (!readBytes(frameHeader, headerSize)) break;
+
+        size_t idLength = (version == 2) ? 3 : 4;
+        if (frameHeader[0] == 0) break;
+        if (!std::all_of(frameHeader, frameHeader + idLength, validIdCharacter)) break;
+
+        char id[5] = {};
+        std::memcpy(id, frameHeader, idLength);
+        uint32_t size = 0;
+        uint8_t formatFlags = 0;
+
+        if (version == 2) {
+            size = bigEndian(frameHeader + 3, 3);
+            auto mapped = std::find_if(V22_FRAME_IDS.begin(), V22_FRAME_IDS.end(), [&](const auto& ids) { return std::strcmp(ids.first, id) == 0; });
+            std::memcpy(id, (mapped != V22_FRAME_IDS.end()) ? mapped->second : "XXXX", 4);
+        }
+        else if (version == 3) {
+            size = bigEndian(frameHeader + 4, 4);
+            formatFlags = frameHeader[9];
+        }
+        else {
+            // Some encoders wrote v2.4 frame sizes as plain integers. Use that reading when
+            // the syncsafe one is impossible or does not land on the next frame.
+            size = syncsafe(frameHeader + 4);
+            uint32_t plainSize = bigEndian(frameHeader + 4, 4);
+            uint64_t payloadStart = source.position();
+            bool notSyncsafe = ((frameHeader[4] | frameHeader[5] | frameHeader[6] | frameHeader[7]) & 0x80) != 0;
+            if (notSyncsafe || (plainSize != size && !frameStartsAt(payloadStart + size) && frameStartsAt(payloadStart + plainSize)))
+                size = plainSize;
+            formatFlags = frameHeader[9];
+        }
+
+        if (size > tagEnd - source.position()) break;
+
+        bool wanted = std::any_of(WANTED_FRAMES.begin(), WANTED_FRAMES.end(), [&](const char* frame) { return std::strcmp(frame, id) == 0; });
+        bool compressed = (version == 3) ? (formatFlags & 0xC0) != 0 : (version == 4) && (formatFlags & 0x0C) != 0;
+        if (!wanted || compressed) {
+            if (!skipBytes(size)) break;
+            continue;
+        }
+
+        size_t extraBytes = 0;
+        if (version == 3 && (formatFlags & 0x20)) extraBytes = 1;
+        if (version == 4) extraBytes = ((formatFlags & 0x40) ? 1 : 0) + ((formatFlags & 0x01) ? 4 : 0);
+        if (extraBytes > size || !skipBytes(extraBytes)) break;
+        size -= static_cast<uint32_t>(extraBytes);
+
+        size_t fieldSize = std::min<size_t>(size, field.size());
+        if (!readBytes(field.data(), fieldSize) || !skipBytes(size - fieldSize)) break;
+        if (version == 4 && ((formatFlags & 0x02) || (flags & 0x80))) fieldSize = removeUnsynchronisation(field.data(), fieldSize);
+
+        handleFrame(id, field.data(), fieldSize, tags);
+    }
+
+    ReplayGain& gain = tags.replayGain;
+    if (trackGainFound || gain.hasAlbum) {
+        if (!trackGainFound) {
+            gain.trackGain = gain.albumGain;
+            gain.trackPeak = gain.albumPeak;
+        }
+        gain.source = ReplayGain::Source::Tags;
+    }
+
+    return true;
+}
+
+bool Id3Reader::readBytes(uint8_t* output, size_t count) {
+    if (!tagUnsynchronised) {
+        if (count > tagEnd - std::min(source.position(), tagEnd) || source.fill(count) < count) return false;
+        if (output != nullptr) std::memcpy(output, source.data(), count);
+        source.consume(count);
+        return true;
+    }
+
+    // Whole-tag unsynchronisation: every 0xFF 0x00 pair in the stream stands for 0xFF, so
+    // frame sizes only line up after the stuffed zeros are dropped.
+    size_t produced = 0;
+    while (produced < count) {
+        uint64_t remaining = tagEnd - std::min(source.position(), tagEnd);
+        size_t window = std::min<size_t>(source.fill(1), static_cast<size_t>(std::min<uint64_t>(remaining, BLOCK_SIZE)));
+        if (window == 0) return false;
+
+        const uint8_t* data = source.data();
+        size_t used = 0;
+        while (used < window && produced < count) {
+            if (previousByte == 0xFF && data[used] == 0x00) {
+                previousByte = 0;
+                used++;
+                continue;
+            }
+
+            size_t span = std::min(window - used, count - produced);
+            const uint8_t* marker = static_cast<const uint8_t*>(std::memchr(data + used, 0xFF, span));
+            size_t run = (marker != nullptr) ? marker - (data + used) + 1 : span;
+            if (output != nullptr) std::memcpy(output + produced, data + used, run);
+            used += run;
+            produced += run;
+            previousByte = data[used - 1];
+        }
+        source.consume(used);
+    }
+    return true;
+}
+
+bool Id3Reader::skipBytes(uint64_t count) {
+    if (count == 0) return true;
+    if (tagUnsynchronised) return readBytes(nullptr, static_cast<size_t>(count));
+
+    uint64_t target = source.position() + count;
+    return target <= tagEnd && source.seek(target);
+}
+
+bool Id3Reader::frameStartsAt(uint64_t offset) {
+    if (offset == tagEnd) return true;
+    if (offset + 4 > tagEnd) return false;
+
+    uint64_t position = source.position();
+    bool valid = source.seek(offset) && source.fill(4) >= 4 &&
+                 (source.data()[0] == 0 || std::all_of(source.data(), source.data() + 4, validIdCharacter));
+    source.seek(position);
+    return valid;
+}
+
+void Id3Reader::handleFrame(const char* id, const uint8_t* data, size_t size, Tags& tags) {
+    if (std::strcmp(id, "TXXX") == 0) {
+        handleUserText(data, size, tags);
+        return;
+    }
+    if (std::strcmp(id, "RVA2") == 0) {
+        handleRelativeVolume(data, size, tags);
+        return;
+    }
+    if (size == 0) return;
+
+    if (std::strcmp(id, "TIT2") == 0) decodeText(data + 1, size - 1, data[0], tags.title);
+    else if (std::strcmp(id, "TPE1") == 0) decodeText(data + 1, size - 1, data[0], tags.artist);
+    else if (std::strcmp(id, "TALB") == 0) decodeText(data + 1, size - 1, data[0], tags.album);
+    else if (std::strcmp(id, "TCON") == 0) {
+        decodeText(data + 1, size - 1, data[0], tags.genre);
+        decodeGenre(tags.genre);
+    }
+    else {
+        ShortText value;
+        decodeText(data + 1, size - 1, data[0], value);
+        if (std::strcmp(id, "TRCK") == 0) tags.trackNumber = leadingNumber(value);
+        else if (std::strcmp(id, "TLEN") == 0) tags.lengthMilliseconds = leadingNumber(value);
+        else if (tags.year == 0) tags.year = leadingNumber(value);
+    }
+}
+
+// TXXX:REPLAYGAIN_* frames as written by foobar2000, mp3gain, rsgain and most taggers.
+void Id3Reader::handleUserText(const uint8_t* data, size_t size, Tags& tags) {
+    if (size == 0) return;
+
+    ShortText description, value;
+    size_t used = decodeText(data + 1, size - 1, data[0], description);
+    decodeText(data + 1 + used, size - 1 - used, data[0], value);
+
+    float number = 0.0f;
+    if (!parseNumber(value, number)) return;
+
+    ReplayGain& gain = tags.replayGain;
+    if (equalsAscii(description, "REPLAYGAIN_TRACK_GAIN")) {
+        gain.trackGain = number;
+        trackGainFound = true;
+    }
+    else if (equalsAscii(description, "REPLAYGAIN_TRACK_PEAK")) {
+        gain.trackPeak = number;
+    }
+    else if (equalsAscii(description, "REPLAYGAIN_ALBUM_GAIN")) {
+        gain.albumGain = number;
+        gain.hasAlbum = true;
+    }
+    else if (equalsAscii(description, "REPLAYGAIN_ALBUM_PEAK")) {
+        gain.albumPeak = number;
+    }
+}
+
+// RVA2: a "track" or "album" identification, then per-channel records of a signed 1/512 dB
+// adjustment and an optional peak. Only the master volume channel is used.
+void Id3Reader::handleRelativeVolume(const uint8_t* data, size_t size, Tags& tags) {
+    ShortText description;
+    size_t used = decodeText(data, size, 0, description);
+    bool album = equalsAscii(description, "ALBUM");
+
+    size_t pos = used;
+    while (pos + 4 <= size) {
+        uint8_t channelType = data[pos];
+        int16_t adjustment = static_cast<int16_t>((data[pos + 1] << 8) | data[pos + 2]);
+        uint8_t peakBits = data[pos + 3];
+        size_t peakBytes = (peakBits + 7) / 8;
+        if (pos + 4 + peakBytes > size) return;
+
+        if (channelType == 1) {
+            double peakValue = 0.0;
+            for (size_t i = 0; i < peakBytes; i++) peakValue = peakValue * 256.0 + data[pos + 4 + i];
+            float peak = (peakBits > 0) ? static_cast<float>(peakValue / std::ldexp(1.0, peakBits - 1)) : 0.0f;
+
+            ReplayGain& gain = tags.replayGain;
+            if (album) {
+                gain.albumGain = adjustment / 512.0f;
+                gain.albumPeak = peak;
+                gain.hasAlbum = true;
+            }
+            else {
+                gain.trackGain = adjustment / 512.0f;
+                gain.trackPeak = peak;
+                trackGainFound = true;
+            }
+            return;
+        }
+
+        pos += 4 + peakBytes;
+    }
+}
+
+// Decodes the first string of a text field into out, reusing its capacity, and returns the
+// bytes consumed including the terminator. Encodings: 0 Latin-1, 1 UTF-16 with BOM,
+// 2 UTF-16BE, 3 UTF-8.
+template <typename Text>
+size_t Id3Reader::decodeText(const uint8_t* data, size_t size, uint8_t encoding, Text& out) {
+    out.clear();
+
+    if (encoding == 1 || encoding == 2) {
+        bool bigEndianText = encoding == 2;
+        size_t pos = 0;
+        auto unitAt = [&](size_t at) -> char32_t {
+            return bigEndianText ? (data[at] << 8) | data[at + 1] : data[at] | (data[at + 1] << 8);
+        };
+
+        while (pos + 2 <= size) {
+            if ((data[pos] == 0xFF && data[pos + 1] == 0xFE) || (data[pos] == 0xFE && data[pos + 1] == 0xFF)) {
+                bigEndianText = data[pos] == 0xFE;
+                pos += 2;
+                continue;
+            }
+
+            char32_t unit = unitAt(pos);
+            pos += 2;
+            if (unit == 0) return pos;
+
+            if (unit >= 0xD800 && unit < 0xDC00 && pos + 2 <= size) {
+                char32_t low = unitAt(pos);
+                if (low >= 0xDC00 && low < 0xE000) {
+                    unit = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+                    pos += 2;
+                }
+            }
+            appendCodePoint(out, unit);
+        }
+        return size;
+    }
+
+    if (encoding == 3) {
+        size_t pos = 0;
+        while (pos < size) {
+            uint8_t lead = data[pos++];
+            if (lead == 0) return pos;
+
+            int continuation = (lead >= 0xF0) ? 3 : (lead >= 0xE0) ? 2 : (lead >= 0xC0) ? 1 : 0;
+            char32_t codePoint = (continuation == 0) ? lead : lead & (0x3F >> continuation);
+            if (lead >= 0x80 && continuation == 0) codePoint = 0xFFFD;
+
+            for (int i = 0; i < continuation; i++) {
+                if (pos >= size || (data[pos] & 0xC0) != 0x80) {
+                    codePoint = 0xFFFD;
+                    break;
+                }
+                codePoint = (codePoint << 6) | (data[pos++] & 0x3F);
+            }
+            appendCodePoint(out, codePoint > 0x10FFFF ? 0xFFFD : codePoint);
+        }
+        return size;
+    }
+
+    for (size_t pos = 0; pos < size; pos++) {
+        if (data[pos] == 0) return pos + 1;
+        out.push_back(static_cast<wchar_t>(data[pos]));
+    }
+    return size;
+}
+
+// TCON holds free text, an ID3v1 genre number, or "(n)" references optionally followed by
+// a refinement.
+void Id3Reader::decodeGenre(std::wstring& genre) {
+    size_t numberStart = (!genre.empty() && genre[0] == L'(') ? 1 : 0;
+    size_t numberEnd = numberStart;
+    while (numberEnd < genre.size() && genre[numberEnd] >= L'0' && genre[numberEnd] <= L'9') numberEnd++;
+    if (numberEnd == numberStart) return;
+
+    if (numberStart == 1) {
+        if (numberEnd >= genre.size() || genre[numberEnd] != L')') return;
+        if (numberEnd + 1 < genre.size()) {
+            genre.erase(0, numberEnd + 1);
+            return;
+        }
+    }
+    else if (numberEnd != genre.size()) {
+        return;
+    }
+
+    size_t index = 0;
+    for (size_t i = numberStart; i < numberEnd && index < std::size(GENRES); i++) index = index * 10 + (genre[i] - L'0');
+    if (index >= std::size(GENRES)) return;
+
+    genre.clear();
+    for (const char* name = GENRES[index]; *name != 0; name++) genre.push_back(static_cast<wchar_t>(*name));
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include "headers.hpp"
+#include "InputSource.h"
+#include "ReplayGain.h"
+
+// Streaming ID3v2.2/2.3/2.4 tag reader. It walks the frame headers and reads only the
+// payloads of the frames it reports, into a fixed buffer; everything else, cover art
+// included, is seeked past. It handles extended headers, whole-tag (v2.2/2.3) and per-frame
+// (v2.4) unsynchronisation, and v2.4 tags written with plain instead of syncsafe frame
+// sizes. Text is decoded straight into the output strings, reusing their capacity, so
+// reading into the same Tags again allocates nothing.
+class Id3Reader {
+public:
+    struct Tags {
+        std::wstring title, artist, album, genre;
+        uint32_t trackNumber = 0, year = 0;
+        uint64_t lengthMilliseconds = 0;
+        ReplayGain replayGain;
+
+        void clear();
+    };
+private:
+    static constexpr size_t MAX_FIELD_BYTES = 4096;
+
+    InputSource& source;
+    int version = 0;
+    bool tagUnsynchronised = false;
+    uint8_t previousByte = 0;
+    uint64_t tagEnd = 0;
+    bool trackGainFound = false;
+    std::array<uint8_t, MAX_FIELD_BYTES> field;
+
+    bool readBytes(uint8_t* output, size_t count);
+    bool skipBytes(uint64_t count);
+    bool frameStartsAt(uint64_t offset);
+    void handleFrame(const char* id, const uint8_t* data, size_t size, Tags& tags);
+    void handleUserText(const uint8_t* data, size_t size, Tags& tags);
+    void handleRelativeVolume(const uint8_t* data, size_t size, Tags& tags);
+
+    template <typename Text>
+    static size_t decodeText(const uint8_t* data, size_t size, uint8_t encoding, Text& out);
+    static void decodeGenre(std::wstring& genre);
+public:
+    explicit Id3Reader(InputSource& source);
+
+    // Reads the tag at the start of the stream; false when there is none or it is unusable.
+    bool read(Tags& tags);
+};
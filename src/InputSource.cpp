@@ -0,0 +1,209 @@
+#include "InputSource.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+std::unique_ptr<InputSource> InputSource::create(const std::filesystem::path& path) {
+    std::unique_ptr<InputSource> source = std::make_unique<MappedInputSource>();
+    if (source->open(path)) return source;
+
+    source = std::make_unique<ChunkedInputSource>();
+    if (source->open(path)) return source;
+
+    return nullptr;
+}
+
+MappedInputSource::~MappedInputSource() {
+    close();
+}
+
+bool MappedInputSource::open(const std::filesystem::path& path) {
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER length;
+    if (!GetFileSizeEx(file, &length) || length.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mappingObject = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingObject == nullptr) {
+        CloseHandle(file);
+        return false;
+    }
+
+    void* view = MapViewOfFile(mappingObject, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) {
+        CloseHandle(mappingObject);
+        CloseHandle(file);
+        return false;
+    }
+
+    fileHandle = file;
+    mappingHandle = mappingObject;
+    fileSize = static_cast<uint64_t>(length.QuadPart);
+#else
+    int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) return false;
+
+    struct stat fileStat;
+    if (fstat(descriptor, &fileStat) != 0 || fileStat.st_size == 0) {
+        ::close(descriptor);
+        return false;
+    }
+
+    void* view = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    if (view == MAP_FAILED) {
+        ::close(descriptor);
+        return false;
+    }
+    madvise(view, fileStat.st_size, MADV_SEQUENTIAL);
+
+    fileDescriptor = descriptor;
+    fileSize = static_cast<uint64_t>(fileStat.st_size);
+#endif
+
+    mapping = static_cast<const uint8_t*>(view);
+    offset = 0;
+    return true;
+}
+
+void MappedInputSource::close() {
+    if (mapping == nullptr) return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(mapping);
+    CloseHandle(mappingHandle);
+    CloseHandle(fileHandle);
+    mappingHandle = fileHandle = nullptr;
+#else
+    munmap(const_cast<uint8_t*>(mapping), fileSize);
+    ::close(fileDescriptor);
+    fileDescriptor = -1;
+#endif
+
+    mapping = nullptr;
+    fileSize = offset = 0;
+}
+
+size_t MappedInputSource::fill(size_t) {
+    return available();
+}
+
+const uint8_t* MappedInputSource::data() const {
+    return mapping + offset;
+}
+
+size_t MappedInputSource::available() const {
+    return static_cast<size_t>(fileSize - offset);
+}
+
+void MappedInputSource::consume(size_t bytes) {
+    offset = std::min<uint64_t>(offset + bytes, fileSize);
+}
+
+bool MappedInputSource::seek(uint64_t newOffset) {
+    if (newOffset > fileSize) return false;
+    offset = newOffset;
+    return true;
+}
+
+uint64_t MappedInputSource::position() const {
+    return offset;
+}
+
+uint64_t MappedInputSource::size() const {
+    return fileSize;
+}
+
+ChunkedInputSource::ChunkedInputSource(size_t chunkSize) : chunk(chunkSize) {}
+
+bool ChunkedInputSource::open(const std::filesystem::path& path) {
+    close();
+
+    file.open(path, std::ios::binary);
+    if (!file) return false;
+
+    file.seekg(0, std::ios::end);
+    fileSize = static_cast<uint64_t>(file.tellg());
+    file.seekg(0, std::ios::beg);
+    return true;
+}
+
+void ChunkedInputSource::close() {
+    if (file.is_open()) file.close();
+    file.clear();
+    chunkBegin = chunkEnd = 0;
+    chunkOffset = fileSize = 0;
+}
+
+size_t ChunkedInputSource::fill(size_t minBytes) {
+    if (available() >= minBytes || !file.is_open()) return available();
+
+    if (minBytes > chunk.size()) chunk.resize(minBytes);
+
+    size_t keep = chunkEnd - chunkBegin;
+    if (chunkBegin > 0) {
+        std::memmove(chunk.data(), chunk.data() + chunkBegin, keep);
+        chunkOffset += chunkBegin;
+        chunkBegin = 0;
+        chunkEnd = keep;
+    }
+
+    file.read(reinterpret_cast<char*>(chunk.data() + chunkEnd), chunk.size() - chunkEnd);
+    chunkEnd += static_cast<size_t>(file.gcount());
+    if (file.eof()) file.clear();
+
+    return available();
+}
+
+const uint8_t* ChunkedInputSource::data() const {
+    return chunk.data() + chunkBegin;
+}
+
+size_t ChunkedInputSource::available() const {
+    return chunkEnd - chunkBegin;
+}
+
+void ChunkedInputSource::consume(size_t bytes) {
+    if (bytes <= available()) {
+        chunkBegin += bytes;
+        return;
+    }
+    seek(position() + bytes);
+}
+
+bool ChunkedInputSource::seek(uint64_t newOffset) {
+    if (newOffset > fileSize) return false;
+
+    if (newOffset >= chunkOffset && newOffset <= chunkOffset + chunkEnd) {
+        chunkBegin = static_cast<size_t>(newOffset - chunkOffset);
+        return true;
+    }
+
+    file.seekg(static_cast<std::streamoff>(newOffset), std::ios::beg);
+    chunkOffset = newOffset;
+    chunkBegin = chunkEnd = 0;
+    return static_cast<bool>(file);
+}
+
+uint64_t ChunkedInputSource::position() const {
+    return chunkOffset + chunkBegin;
+}
+
+uint64_t ChunkedInputSource::size() const {
+    return fileSize;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "headers.hpp"
+
+// Byte stream the decoder pulls MP3 data from. The readable window starts at data()
+// and holds available() bytes; fill() grows it, consume() advances past decoded bytes.
+class InputSource {
+public:
+    virtual ~InputSource() = default;
+
+    virtual bool open(const std::filesystem::path& path) = 0;
+    virtual void close() = 0;
+
+    virtual size_t fill(size_t minBytes) = 0;
+    virtual const uint8_t* data() const = 0;
+    virtual size_t available() const = 0;
+    virtual void consume(size_t bytes) = 0;
+
+    virtual bool seek(uint64_t offset) = 0;
+    virtual uint64_t position() const = 0;
+    virtual uint64_t size() const = 0;
+
+    static std::unique_ptr<InputSource> create(const std::filesystem::path& path);
+};
+
+class MappedInputSource : public InputSource {
+private:
+    const uint8_t* mapping = nullptr;
+    uint64_t fileSize = 0, offset = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#else
+    int fileDescriptor = -1;
+#endif
+public:
+    MappedInputSource() = default;
+    ~MappedInputSource() override;
+
+    MappedInputSource(const MappedInputSource&) = delete;
+    MappedInputSource& operator=(const MappedInputSource&) = delete;
+
+    bool open(const std::filesystem::path& path) override;
+    void close() override;
+
+    size_t fill(size_t minBytes) override;
+    const uint8_t* data() const override;
+    size_t available() const override;
+    void consume(size_t bytes) override;
+
+    bool seek(uint64_t newOffset) override;
+    uint64_t position() const override;
+    uint64_t size() const override;
+};
+
+class ChunkedInputSource : public InputSource {
+private:
+    std::ifstream file;
+    std::vector<uint8_t> chunk;
+    size_t chunkBegin = 0, chunkEnd = 0;
+    uint64_t chunkOffset = 0, fileSize = 0;
+public:
+    explicit ChunkedInputSource(size_t chunkSize = 8 * BLOCK_SIZE);
+
+    bool open(const std::filesystem::path& path) override;
+    void close() override;
+
+    size_t fill(size_t minBytes) override;
+    const uint8_t* data() const override;
+    size_t available() const override;
+    void consume(size_t bytes) override;
+
+    bool seek(uint64_t newOffset) override;
+    uint64_t position() const override;
+    uint64_t size() const override;
+};
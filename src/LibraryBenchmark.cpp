@@ -0,0 +1,159 @@
+#include "LibraryBenchmark.h"
+#include "FilesystemModule.h"
+
+namespace {
+    constexpr size_t TRACKS_PER_DIRECTORY = 100, AUDIO_FRAMES = 8;
+
+    // MPEG-1 Layer III, 128 kbps, 44.1 kHz, joint stereo: 417 bytes per frame.
+    constexpr uint8_t FRAME_HEADER[4] = { 0xFF, 0xFB, 0x90, 0x40 };
+    constexpr size_t FRAME_BYTES = 417, SAMPLES_PER_FRAME = 1152, INFO_OFFSET = 4 + 32;
+
+    double millisecondsSince(std::chrono::steady_clock::time_point started) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    }
+
+    void putBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+        for (int shift = 24; shift >= 0; shift -= 8) out.push_back(static_cast<uint8_t>(value >> shift));
+    }
+
+    void textFrame(std::vector<uint8_t>& tag, const char* id, const std::string& text) {
+        tag.insert(tag.end(), id, id + 4);
+        putBigEndian(tag, static_cast<uint32_t>(text.size() + 1));
+        tag.insert(tag.end(), { 0, 0, 0 });
+        tag.insert(tag.end(), text.begin(), text.end());
+    }
+
+    // An ID3v2.3 tag with the fields the scanner reads, a ReplayGain value so no track is
+    // queued for loudness analysis, and an Info frame giving the length without a scan.
+    std::vector<uint8_t> syntheticTrack(size_t index) {
+        std::vector<uint8_t> frames;
+        textFrame(frames, "TIT2", "Track " + std::to_string(index));
+        textFrame(frames, "TPE1", "Artist " + std::to_string(index / TRACKS_PER_DIRECTORY));
+        textFrame(frames, "TALB", "Album " + std::to_string(index / 12));
+        textFrame(frames, "TRCK", std::to_string(index % 12 + 1));
+
+        std::string gain = std::string("REPLAYGAIN_TRACK_GAIN") + '\0' + "-6.00 dB";
+        textFrame(frames, "TXXX", gain);
+
+        std::vector<uint8_t> file = { 'I', 'D', '3', 3, 0, 0 };
+        for (int shift = 21; shift >= 0; shift -= 7) file.push_back(static_cast<uint8_t>((frames.size() >> shift) & 0x7F));
+        file.insert(file.end(), frames.begin(), frames.end());
+
+        for (size_t frame = 0; frame <= AUDIO_FRAMES; frame++) {
+            size_t start = file.size();
+            file.resize(start + FRAME_BYTES, 0);
+            std::memcpy(file.data() + start, FRAME_HEADER, 4);
+            if (frame > 0) continue;
+
+            std::vector<uint8_t> info = { 'I', 'n', 'f', 'o' };
+            putBigEndian(info, 1);
+            putBigEndian(info, AUDIO_FRAMES);
+            std::memcpy(file.data() + start + INFO_OFFSET, info.data(), info.size());
+        }
+        return file;
+    }
+}
+
+int LibraryBenchmark::runStartupCommandLine(const std::vector<std::string>& arguments) {
+    Library library;
+    if (!prepareLibrary(arguments, "--bench-startup", library)) return 2;
+
+    size_t threads = std::thread::hardware_concurrency();
+    printResult(measureScan("cold", library, threads), std::cout);
+    printResult(measureScan("warm", library, threads), std::cout);
+    return 0;
+}
+
+int LibraryBenchmark::runScalingCommandLine(const std::vector<std::string>& arguments) {
+    Library library;
+    if (!prepareLibrary(arguments, "--bench-scan", library)) return 2;
+
+    std::vector<size_t> threadCounts = { 1, 2, 4 };
+    size_t hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    if (std::find(threadCounts.begin(), threadCounts.end(), hardwareThreads) == threadCounts.end()) threadCounts.push_back(hardwareThreads);
+
+    for (size_t threads : threadCounts) {
+        std::error_code error;
+        std::filesystem::remove(library.cachePath, error);
+        printResult(measureScan("cold", library, threads), std::cout);
+    }
+    return 0;
+}
+
+LibraryBenchmark::Library::Library()
+    : scratch(std::filesystem::temp_directory_path() / ("clp-bench-library-" + std::to_string(std::random_device{}()))),
+      cachePath(scratch / "library.cache") {
+    std::filesystem::create_directories(scratch);
+}
+
+LibraryBenchmark::Library::~Library() {
+    std::error_code error;
+    std::filesystem::remove_all(scratch, error);
+}
+
+bool LibraryBenchmark::prepareLibrary(const std::vector<std::string>& arguments, const char* mode, Library& library) {
+    size_t tracks = 10000;
+
+    for (size_t i = 1; i < arguments.size(); i++) {
+        if (arguments[i] == "--tracks" && i + 1 < arguments.size()) tracks = std::max<long>(1, std::atol(arguments[++i].c_str()));
+        else if (library.directory.empty() && std::filesystem::is_directory(arguments[i])) library.directory = arguments[i];
+        else {
+            std::cerr << "usage: CLP " << mode << " [--tracks N | directory]\n";
+            return false;
+        }
+    }
+
+    if (library.directory.empty()) {
+        library.directory = library.cachePath.parent_path() / "library";
+        writeCorpus(library.directory, tracks);
+    }
+    return true;
+}
+
+void LibraryBenchmark::writeCorpus(const std::filesystem::path& directory, size_t tracks) {
+    for (size_t index = 0; index < tracks; index++) {
+        std::filesystem::path folder = directory / ("artist" + std::to_string(index / TRACKS_PER_DIRECTORY));
+        if (index % TRACKS_PER_DIRECTORY == 0) std::filesystem::create_directories(folder);
+
+        std::vector<uint8_t> bytes = syntheticTrack(index);
+        std::ofstream file(folder / ("track" + std::to_string(index) + ".mp3"), std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    }
+}
+
+// Timed from construction, so loading the cache and starting the pools count as startup.
+LibraryBenchmark::Result LibraryBenchmark::measureScan(const std::string& scan, const Library& library, size_t threads) {
+    Result result;
+    result.scan = scan;
+    result.threads = threads;
+
+    std::mutex finishedMutex;
+    std::condition_variable finishedCv;
+    bool finished = false;
+    std::atomic<size_t> found = 0;
+
+    auto started = std::chrono::steady_clock::now();
+    FilesystemModule filesystem(library.directory, library.cachePath, threads);
+    filesystem.readMusicList([&](const LibraryTrack&) { found++; }, [&] {
+        std::lock_guard<std::mutex> lock(finishedMutex);
+        finished = true;
+        finishedCv.notify_one();
+    });
+
+    std::unique_lock<std::mutex> lock(finishedMutex);
+    finishedCv.wait(lock, [&] { return finished; });
+    result.scanMilliseconds = millisecondsSince(started);
+    result.tracks = found.load();
+    return result;
+}
+
+void LibraryBenchmark::printResult(const Result& result, std::ostream& out) {
+    double tracksPerSecond = (result.scanMilliseconds > 0.0) ? result.tracks * 1000.0 / result.scanMilliseconds : 0.0;
+
+    out << "{\"scan\":\"" << result.scan << "\""
+        << ",\"threads\":" << result.threads
+        << ",\"tracks\":" << result.tracks
+        << ",\"scan_ms\":" << result.scanMilliseconds
+        << ",\"tracks_per_second\":" << tracksPerSecond
+        << "}\n";
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "headers.hpp"
+
+// `--bench-startup` mode: scans a library through FilesystemModule the way the player does at
+// startup, first cold with no metadata cache and then warm from the cache the cold scan
+// wrote. `--bench-scan` mode: repeats the cold scan with 1, 2, 4 and all hardware threads in
+// the scan pool. The library is a synthetic corpus of small tagged MP3 files unless a
+// directory is given. Prints one JSON object per line with the scan time and tracks per second.
+class LibraryBenchmark {
+private:
+    struct Result {
+        std::string scan;
+        size_t threads = 0;
+        size_t tracks = 0;
+        double scanMilliseconds = 0.0;
+    };
+
+    class Library {
+    private:
+        std::filesystem::path scratch;
+    public:
+        std::filesystem::path directory;
+        std::filesystem::path cachePath;
+
+        Library();
+        ~Library();
+    };
+
+    static bool prepareLibrary(const std::vector<std::string>& arguments, const char* mode, Library& library);
+    static void writeCorpus(const std::filesystem::path& directory, size_t tracks);
+    static Result measureScan(const std::string& scan, const Library& library, size_t threads);
+    static void printResult(const Result& result, std::ostream& out);
+public:
+    static int runStartupCommandLine(const std::vector<std::string>& arguments);
+    static int runScalingCommandLine(const std::vector<std::string>& arguments);
+};
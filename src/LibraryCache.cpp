@@ -0,0 +1,191 @@
+#include "LibraryCache.h"
+#include "InputSource.h"
+
+namespace {
+    class CacheWriter {
+    private:
+        std::vector<uint8_t> bytes;
+    public:
+        template <typename T>
+        void put(T value) {
+            const uint8_t* raw = reinterpret_cast<const uint8_t*>(&value);
+            bytes.insert(bytes.end(), raw, raw + sizeof(T));
+        }
+
+        void putString(const std::string& value) {
+            put(static_cast<uint32_t>(value.size()));
+            bytes.insert(bytes.end(), value.begin(), value.end());
+        }
+
+        const std::vector<uint8_t>& data() const { return bytes; }
+    };
+
+    class CacheReader {
+    private:
+        const uint8_t* cursor;
+        const uint8_t* end;
+    public:
+        CacheReader(const uint8_t* data, size_t size) : cursor(data), end(data + size) {}
+
+        template <typename T>
+        bool get(T& value) {
+            if (static_cast<size_t>(end - cursor) < sizeof(T)) return false;
+            std::memcpy(&value, cursor, sizeof(T));
+            cursor += sizeof(T);
+            return true;
+        }
+
+        bool getString(std::string& value) {
+            uint32_t length = 0;
+            if (!get(length) || static_cast<size_t>(end - cursor) < length) return false;
+            value.assign(reinterpret_cast<const char*>(cursor), length);
+            cursor += length;
+            return true;
+        }
+    };
+
+    // Built once per load or save: constructing a converter per string dominated loading.
+    using Utf8Converter = std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>>;
+}
+
+double TrackMetadata::duration() const {
+    if (sampleRate == 0) return 0.0;
+    return static_cast<double>(totalSamples) / sampleRate;
+}
+
+LibraryCache::LibraryCache(std::filesystem::path cachePath) : cachePath(std::move(cachePath)) {}
+
+bool LibraryCache::load() {
+    entries.clear();
+    dirty = false;
+
+    MappedInputSource source;
+    if (!source.open(cachePath)) return false;
+
+    CacheReader reader(source.data(), source.available());
+    uint32_t magic = 0, version = 0, count = 0;
+    if (!reader.get(magic) || !reader.get(version) || !reader.get(count)) return false;
+    if (magic != CACHE_MAGIC || version != CACHE_VERSION) return false;
+
+    Utf8Converter converter;
+    entries.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        std::string path, title, artist, album, genre;
+        CacheEntry entry;
+        uint8_t playable = 0, hasAlbumGain = 0;
+        ReplayGain& gain = entry.metadata.replayGain;
+
+        bool valid = reader.getString(path) && reader.get(entry.fileSize) && reader.get(entry.modifiedTime) &&
+                     reader.get(playable) && reader.getString(title) && reader.getString(artist) &&
+                     reader.getString(album) && reader.getString(genre) && reader.get(entry.metadata.trackNumber) &&
+                     reader.get(entry.metadata.year) && reader.get(entry.metadata.totalSamples) && reader.get(entry.metadata.sampleRate) &&
+                     reader.get(gain.source) && reader.get(hasAlbumGain) && reader.get(gain.trackGain) &&
+                     reader.get(gain.trackPeak) && reader.get(gain.albumGain) && reader.get(gain.albumPeak);
+        if (!valid || gain.source > ReplayGain::Source::Analysis) {
+            entries.clear();
+            return false;
+        }
+
+        entry.metadata.playable = playable != 0;
+        gain.hasAlbum = hasAlbumGain != 0;
+        entry.metadata.title = converter.from_bytes(title);
+        entry.metadata.artist = converter.from_bytes(artist);
+        entry.metadata.album = converter.from_bytes(album);
+        entry.metadata.genre = converter.from_bytes(genre);
+        entries.emplace(converter.from_bytes(path), std::move(entry));
+    }
+
+    return true;
+}
+
+bool LibraryCache::save() {
+    if (!dirty) return true;
+
+    CacheWriter writer;
+    writer.put(CACHE_MAGIC);
+    writer.put(CACHE_VERSION);
+    writer.put(static_cast<uint32_t>(entries.size()));
+
+    Utf8Converter converter;
+    for (const auto& [path, entry] : entries) {
+        writer.putString(converter.to_bytes(path));
+        writer.put(entry.fileSize);
+        writer.put(entry.modifiedTime);
+        writer.put(static_cast<uint8_t>(entry.metadata.playable));
+        writer.putString(converter.to_bytes(entry.metadata.title));
+        writer.putString(converter.to_bytes(entry.metadata.artist));
+        writer.putString(converter.to_bytes(entry.metadata.album));
+        writer.putString(converter.to_bytes(entry.metadata.genre));
+        writer.put(entry.metadata.trackNumber);
+        writer.put(entry.metadata.year);
+        writer.put(entry.metadata.totalSamples);
+        writer.put(entry.metadata.sampleRate);
+
+        const ReplayGain& gain = entry.metadata.replayGain;
+        writer.put(gain.source);
+        writer.put(static_cast<uint8_t>(gain.hasAlbum));
+        writer.put(gain.trackGain);
+        writer.put(gain.trackPeak);
+        writer.put(gain.albumGain);
+        writer.put(gain.albumPeak);
+    }
+
+    std::filesystem::path temporaryPath = cachePath;
+    temporaryPath += L".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!file) return false;
+        file.write(reinterpret_cast<const char*>(writer.data().data()), writer.data().size());
+        if (!file) return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, cachePath, error);
+    if (error) return false;
+
+    dirty = false;
+    return true;
+}
+
+const TrackMetadata* LibraryCache::find(const std::filesystem::path& path, uint64_t fileSize, int64_t modifiedTime) {
+    auto it = entries.find(path.wstring());
+    if (it == entries.end()) return nullptr;
+
+    it->second.seen = true;
+    if (it->second.fileSize != fileSize || it->second.modifiedTime != modifiedTime) return nullptr;
+    return &it->second.metadata;
+}
+
+void LibraryCache::store(const std::filesystem::path& path, uint64_t fileSize, int64_t modifiedTime, TrackMetadata metadata) {
+    CacheEntry& entry = entries[path.wstring()];
+    entry.fileSize = fileSize;
+    entry.modifiedTime = modifiedTime;
+    entry.seen = true;
+    entry.metadata = std::move(metadata);
+    dirty = true;
+}
+
+bool LibraryCache::storeReplayGain(const std::filesystem::path& path, uint64_t fileSize, int64_t modifiedTime, const ReplayGain& gain) {
+    auto it = entries.find(path.wstring());
+    if (it == entries.end() || it->second.fileSize != fileSize || it->second.modifiedTime != modifiedTime) return false;
+
+    it->second.metadata.replayGain = gain;
+    dirty = true;
+    return true;
+}
+
+void LibraryCache::beginScan() {
+    for (auto& [path, entry] : entries) entry.seen = false;
+}
+
+void LibraryCache::pruneUnseen() {
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (!it->second.seen) {
+            it = entries.erase(it);
+            dirty = true;
+        }
+        else {
+            ++it;
+        }
+    }
+}
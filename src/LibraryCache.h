@@ -0,0 +1,44 @@
+#pragma once
+#include "headers.hpp"
+#include "ReplayGain.h"
+
+struct TrackMetadata {
+    bool playable = false;
+    std::wstring title, artist, album, genre;
+    uint32_t trackNumber = 0, year = 0;
+    uint64_t totalSamples = 0;
+    uint32_t sampleRate = 0;
+    ReplayGain replayGain;
+
+    double duration() const;
+};
+
+// On-disk cache of parsed track metadata, keyed by path and validated against the
+// file's size and modification time so a rescan only re-parses files that changed.
+class LibraryCache {
+private:
+    struct CacheEntry {
+        uint64_t fileSize = 0;
+        int64_t modifiedTime = 0;
+        bool seen = false;
+        TrackMetadata metadata;
+    };
+
+    static constexpr uint32_t CACHE_MAGIC = 0x434C5043;
+    static constexpr uint32_t CACHE_VERSION = 4;
+
+    std::filesystem::path cachePath;
+    std::unordered_map<std::wstring, CacheEntry> entries;
+    bool dirty = false;
+public:
+    explicit LibraryCache(std::filesystem::path cachePath);
+
+    bool load();
+    bool save();
+
+    const TrackMetadata* find(const std::filesystem::path& path, uint64_t fileSize, int64_t modifiedTime);
+    void store(const std::filesystem::path& path, uint64_t fileSize, int64_t modifiedTime, TrackMetadata metadata);
+    bool storeReplayGain(const std::filesystem::path& path, uint64_t fileSize, int64_t modifiedTime, const ReplayGain& gain);
+    void beginScan();
+    void pruneUnseen();
+};
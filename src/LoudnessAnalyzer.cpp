@@ -0,0 +1,132 @@
+#include "LoudnessAnalyzer.h"
+#include "LoudnessMeter.h"
+#include "DecoderRegistry.h"
+#include "OfflineRenderer.h"
+#include "ThreadPool.h"
+
+namespace {
+    constexpr float MAX_GAIN_DB = 24.0f;
+
+    std::string displayPath(const std::filesystem::path& path) {
+        std::u8string utf8 = path.u8string();
+        return std::string(utf8.begin(), utf8.end());
+    }
+}
+
+ReplayGain LoudnessAnalyzer::Result::replayGain() const {
+    ReplayGain gain;
+    if (!analysed) return gain;
+
+    gain.source = ReplayGain::Source::Analysis;
+    gain.trackGain = gainForLoudness(loudness);
+    gain.trackPeak = peak;
+    return gain;
+}
+
+LoudnessAnalyzer::Result LoudnessAnalyzer::analyze(const std::filesystem::path& pathToSong, const std::atomic<bool>* cancelled) {
+    Result result;
+    result.path = pathToSong;
+
+    auto started = std::chrono::steady_clock::now();
+    std::unique_ptr<AudioDecoder> decoder = DecoderRegistry::open(pathToSong);
+    if (!decoder) return result;
+
+    LoudnessMeter meter;
+    AudioDecoder::Block block;
+    while (decoder->decode(block)) {
+        if (cancelled != nullptr && cancelled->load()) return result;
+        if (block.frames == 0) continue;
+
+        // Streams that change format midway are measured in their first format only.
+        if (meter.seconds() == 0.0 && !meter.matches(block.sampleRate, block.channels))
+            meter.configure(block.sampleRate, block.channels);
+        if (meter.matches(block.sampleRate, block.channels)) meter.process(block.samples, block.frames);
+    }
+
+    result.analysed = meter.seconds() > 0.0;
+    result.loudness = meter.integratedLoudness();
+    result.peak = meter.samplePeak();
+    result.audioSeconds = meter.seconds();
+    result.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return result;
+}
+
+float LoudnessAnalyzer::gainForLoudness(double loudness) {
+    if (!std::isfinite(loudness)) return 0.0f;
+    return std::clamp(static_cast<float>(ReplayGain::REFERENCE_LUFS - loudness), -MAX_GAIN_DB, MAX_GAIN_DB);
+}
+
+bool LoudnessAnalyzer::albumGain(const std::vector<AlbumTrack>& tracks, float& gain, float& peak) {
+    double weightedEnergy = 0.0, totalSeconds = 0.0;
+    peak = 0.0f;
+
+    for (const AlbumTrack& track : tracks) {
+        double loudness = ReplayGain::REFERENCE_LUFS - track.trackGain;
+        weightedEnergy += track.seconds * std::pow(10.0, loudness / 10.0);
+        totalSeconds += track.seconds;
+        peak = std::max(peak, track.trackPeak);
+    }
+    if (totalSeconds <= 0.0 || weightedEnergy <= 0.0) return false;
+
+    gain = gainForLoudness(10.0 * std::log10(weightedEnergy / totalSeconds));
+    return true;
+}
+
+int LoudnessAnalyzer::runCommandLine(const std::vector<std::string>& arguments) {
+    size_t threads = std::thread::hardware_concurrency();
+    std::vector<std::filesystem::path> tracks;
+
+    for (size_t i = 1; i < arguments.size(); i++) {
+        if (arguments[i] == "--threads" && i + 1 < arguments.size()) threads = static_cast<size_t>(std::max(1, std::atoi(arguments[++i].c_str())));
+        else OfflineRenderer::collectTracks(std::filesystem::path(arguments[i]), tracks);
+    }
+
+    if (tracks.empty()) {
+        std::cerr << "usage: CLP --analyze-gain [--threads N] <file or directory>...\n";
+        return 2;
+    }
+
+    std::vector<Result> results(tracks.size());
+    auto started = std::chrono::steady_clock::now();
+    {
+        ThreadPool pool(threads, ThreadPool::Priority::Background);
+        for (size_t i = 0; i < tracks.size(); i++)
+            pool.submit([&results, &tracks, i] { results[i] = analyze(tracks[i]); });
+        pool.waitIdle();
+    }
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    size_t analysed = 0;
+    double audioSeconds = 0.0;
+    std::map<std::filesystem::path, std::vector<AlbumTrack>> albums;
+
+    std::cout << "track\tloudness_lufs\ttrack_gain_db\ttrack_peak\taudio_seconds\twall_seconds\n";
+    for (const Result& result : results) {
+        if (!result.analysed) {
+            std::cout << displayPath(result.path) << "\tfailed\n";
+            continue;
+        }
+
+        ReplayGain gain = result.replayGain();
+        std::cout << displayPath(result.path) << '\t' << result.loudness << '\t' << gain.trackGain << '\t' << gain.trackPeak
+                  << '\t' << result.audioSeconds << '\t' << result.wallSeconds << '\n';
+
+        albums[result.path.parent_path()].push_back({ gain.trackGain, gain.trackPeak, result.audioSeconds });
+        audioSeconds += result.audioSeconds;
+        analysed++;
+    }
+
+    std::cout << "\nalbum\talbum_gain_db\talbum_peak\ttracks\n";
+    for (const auto& [directory, albumTracks] : albums) {
+        float gain = 0.0f, peak = 0.0f;
+        if (albumGain(albumTracks, gain, peak))
+            std::cout << displayPath(directory) << '\t' << gain << '\t' << peak << '\t' << albumTracks.size() << '\n';
+    }
+
+    double tracksPerMinute = (wallSeconds > 0.0) ? analysed * 60.0 / wallSeconds : 0.0;
+    double realtimeFactor = (wallSeconds > 0.0) ? audioSeconds / wallSeconds : 0.0;
+    std::cout << "\nanalysed\tthreads\twall_seconds\ttracks_per_minute\trealtime_factor\n"
+              << analysed << '\t' << threads << '\t' << wallSeconds << '\t' << tracksPerMinute << '\t' << realtimeFactor << '\n';
+
+    return (analysed == tracks.size()) ? 0 : 1;
+}
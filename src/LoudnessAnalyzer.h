@@ -0,0 +1,35 @@
+#pragma once
+#include "headers.hpp"
+#include "ReplayGain.h"
+
+// Decodes whole tracks through the decoder registry into a LoudnessMeter and turns the
+// measurement into ReplayGain 2.0 values. Used by the library scanner's background pool
+// and by the `--analyze-gain` mode, which analyses files on all cores and reports the
+// throughput in tracks per minute.
+class LoudnessAnalyzer {
+public:
+    struct Result {
+        std::filesystem::path path;
+        bool analysed = false;
+        double loudness = 0.0;
+        float peak = 0.0f;
+        double audioSeconds = 0.0, wallSeconds = 0.0;
+
+        ReplayGain replayGain() const;
+    };
+
+    struct AlbumTrack {
+        float trackGain;
+        float trackPeak;
+        double seconds;
+    };
+
+    static Result analyze(const std::filesystem::path& pathToSong, const std::atomic<bool>* cancelled = nullptr);
+    static float gainForLoudness(double loudness);
+
+    // Album loudness is approximated as the duration-weighted power mean of the track
+    // loudness values, which avoids keeping every track's block energies around.
+    static bool albumGain(const std::vector<AlbumTrack>& tracks, float& gain, float& peak);
+
+    static int runCommandLine(const std::vector<std::string>& arguments);
+};
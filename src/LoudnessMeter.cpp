@@ -0,0 +1,133 @@
+#include "LoudnessMeter.h"
+
+namespace {
+    constexpr double PI = 3.14159265358979323846;
+    constexpr double LOUDNESS_OFFSET = -0.691;
+    constexpr double ABSOLUTE_GATE_LUFS = -70.0;
+    constexpr double RELATIVE_GATE_LU = -10.0;
+
+    double energyToLoudness(double energy) {
+        return LOUDNESS_OFFSET + 10.0 * std::log10(energy);
+    }
+
+    double loudnessToEnergy(double loudness) {
+        return std::pow(10.0, (loudness - LOUDNESS_OFFSET) / 10.0);
+    }
+}
+
+void LoudnessMeter::configure(int sampleRate, int channels) {
+    this->sampleRate = sampleRate;
+
+    // Filter coefficients from the BS.1770 reference design, re-derived for the stream's
+    // rate so 44.1 kHz and 96 kHz material is weighted the same as the 48 kHz tables.
+    double k = std::tan(PI * 1681.974450955533 / sampleRate);
+    double q = 0.7071752369554196;
+    double vh = std::pow(10.0, 3.999843853973347 / 20.0);
+    double vb = std::pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+    shelf = { (vh + vb * k / q + k * k) / a0, 2.0 * (k * k - vh) / a0, (vh - vb * k / q + k * k) / a0,
+              2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0 };
+
+    k = std::tan(PI * 38.13547087602444 / sampleRate);
+    q = 0.5003270373238773;
+    a0 = 1.0 + k / q + k * k;
+    highPass = { 1.0, -2.0, 1.0, 2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0 };
+
+    channelStates.assign(static_cast<size_t>(channels), {});
+    for (int channel = 0; channel < channels; channel++) channelStates[channel].weight = channelWeight(channel, channels);
+
+    subblockFrames = std::max<size_t>(static_cast<size_t>(std::lround(sampleRate * 0.1)), 1);
+    reset();
+}
+
+void LoudnessMeter::reset() {
+    for (ChannelState& state : channelStates) state = { state.weight };
+    subblockEnergy.fill(0.0);
+    blockEnergies.clear();
+    subblockPosition = 0;
+    subblocksDone = 0;
+    currentEnergy = 0.0;
+    peak = 0;
+    totalFrames = 0;
+}
+
+bool LoudnessMeter::matches(int sampleRate, int channels) const {
+    return this->sampleRate == sampleRate && channelStates.size() == static_cast<size_t>(channels);
+}
+
+double LoudnessMeter::channelWeight(int channel, int channels) {
+    // Surround channels count 1.41 and the LFE not at all, in the WAV 5.0 and 5.1 orders.
+    if (channels == 5) return (channel >= 3) ? 1.41 : 1.0;
+    if (channels == 6) return (channel == 3) ? 0.0 : (channel >= 4) ? 1.41 : 1.0;
+    return 1.0;
+}
+
+void LoudnessMeter::process(const int16_t* samples, size_t frames) {
+    size_t channels = channelStates.size();
+    if (channels == 0) return;
+
+    for (size_t frame = 0; frame < frames; frame++) {
+        for (size_t channel = 0; channel < channels; channel++) {
+            int32_t sample = samples[frame * channels + channel];
+            peak = std::max(peak, std::abs(sample));
+
+            ChannelState& state = channelStates[channel];
+            double x = sample / 32768.0;
+
+            double y = shelf.b0 * x + state.shelf1;
+            state.shelf1 = shelf.b1 * x - shelf.a1 * y + state.shelf2;
+            state.shelf2 = shelf.b2 * x - shelf.a2 * y;
+
+            double z = highPass.b0 * y + state.highPass1;
+            state.highPass1 = highPass.b1 * y - highPass.a1 * z + state.highPass2;
+            state.highPass2 = highPass.b2 * y - highPass.a2 * z;
+
+            currentEnergy += state.weight * z * z;
+        }
+
+        if (++subblockPosition < subblockFrames) continue;
+
+        subblockEnergy[subblocksDone % SUBBLOCKS_PER_BLOCK] = currentEnergy;
+        subblocksDone++;
+        subblockPosition = 0;
+        currentEnergy = 0.0;
+
+        if (subblocksDone >= SUBBLOCKS_PER_BLOCK) {
+            double blockSum = std::accumulate(subblockEnergy.begin(), subblockEnergy.end(), 0.0);
+            blockEnergies.push_back(blockSum / static_cast<double>(subblockFrames * SUBBLOCKS_PER_BLOCK));
+        }
+    }
+
+    totalFrames += frames;
+}
+
+double LoudnessMeter::integratedLoudness() const {
+    double absoluteGate = loudnessToEnergy(ABSOLUTE_GATE_LUFS);
+    double sum = 0.0;
+    size_t count = 0;
+    for (double energy : blockEnergies) {
+        if (energy <= absoluteGate) continue;
+        sum += energy;
+        count++;
+    }
+    if (count == 0) return -std::numeric_limits<double>::infinity();
+
+    double relativeGate = loudnessToEnergy(energyToLoudness(sum / count) + RELATIVE_GATE_LU);
+    sum = 0.0;
+    count = 0;
+    for (double energy : blockEnergies) {
+        if (energy <= absoluteGate || energy <= relativeGate) continue;
+        sum += energy;
+        count++;
+    }
+
+    return (count > 0) ? energyToLoudness(sum / count) : -std::numeric_limits<double>::infinity();
+}
+
+float LoudnessMeter::samplePeak() const {
+    return peak / 32768.0f;
+}
+
+double LoudnessMeter::seconds() const {
+    return (sampleRate > 0) ? static_cast<double>(totalFrames) / sampleRate : 0.0;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "headers.hpp"
+
+// ITU-R BS.1770-4 integrated loudness: K-weighting (high shelf plus high-pass), mean square
+// over 400 ms blocks with 75% overlap, then the -70 LUFS absolute and -10 LU relative
+// gates. Only the block energies are kept, so memory grows by one double per 100 ms.
+class LoudnessMeter {
+private:
+    struct Biquad {
+        double b0 = 1.0, b1 = 0.0, b2 = 0.0, a1 = 0.0, a2 = 0.0;
+    };
+
+    struct ChannelState {
+        double weight = 1.0;
+        double shelf1 = 0.0, shelf2 = 0.0, highPass1 = 0.0, highPass2 = 0.0;
+    };
+
+    static constexpr size_t SUBBLOCKS_PER_BLOCK = 4;
+
+    Biquad shelf, highPass;
+    std::vector<ChannelState> channelStates;
+    std::array<double, SUBBLOCKS_PER_BLOCK> subblockEnergy = {};
+    std::vector<double> blockEnergies;
+
+    int sampleRate = 0;
+    size_t subblockFrames = 0, subblockPosition = 0, subblocksDone = 0;
+    double currentEnergy = 0.0;
+    int32_t peak = 0;
+    uint64_t totalFrames = 0;
+
+    static double channelWeight(int channel, int channels);
+public:
+    void configure(int sampleRate, int channels);
+    void reset();
+    void process(const int16_t* samples, size_t frames);
+
+    bool matches(int sampleRate, int channels) const;
+
+    // LUFS, or -infinity when no block passes the absolute gate.
+    double integratedLoudness() const;
+    float samplePeak() const;
+    double seconds() const;
+};
@@ -0,0 +1,163 @@
+#include "Mp3Decoder.h"
+
+namespace {
+    constexpr uint64_t SYNC_SCAN_LIMIT = 1024 * 1024;
+    constexpr uint64_t ESTIMATE_PROBES = 16, ESTIMATE_SCAN_LIMIT = 64 * 1024;
+    constexpr int ESTIMATE_FRAMES_PER_PROBE = 16;
+
+    int samplesPerFrame(const mp3dec_frame_info_t& info) {
+        if (info.layer == 1) return 384;
+        return (info.layer == 3 && info.hz < 32000) ? 576 : 1152;
+    }
+
+    uint32_t readBigEndian(const uint8_t* data, int bytes) {
+        uint32_t value = 0;
+        for (int i = 0; i < bytes; i++) value = (value << 8) | data[i];
+        return value;
+    }
+}
+
+Mp3Decoder::~Mp3Decoder() {
+    mp3dec_ex_close(&decoder);
+}
+
+bool Mp3Decoder::open(std::unique_ptr<InputSource> source) {
+    mp3dec_ex_close(&decoder);
+    estimatedFrames = 0;
+    streamStart = 0;
+
+    this->source = std::move(source);
+    if (!this->source) return false;
+
+    std::optional<VbriTag> vbri = readVbriTag();
+    io = { &readSource, this, &seekSource, this };
+
+    // Without a Xing/Info tag the length is unknown until the first seek or getTotalFrames()
+    // walks the stream, so opening never reads more than the first frames.
+    if (mp3dec_ex_open_cb(&decoder, &io, MP3D_SEEK_TO_SAMPLE | MP3D_DO_NOT_SCAN) != 0) return false;
+    if (decoder.info.hz <= 0 || decoder.info.channels <= 0) return false;
+
+    // minimp3 only reads Xing/Info tags, so a VBRI tag's length and encoder delay are handed
+    // to it the way it records a Xing tag's.
+    if (vbri && vbri->frames > 0) {
+        uint64_t channels = static_cast<uint64_t>(decoder.info.channels);
+        uint64_t samples = vbri->frames * samplesPerFrame(decoder.info) * channels;
+        uint64_t delay = std::min<uint64_t>(vbri->delay * channels, samples);
+
+        decoder.start_delay = decoder.to_skip = static_cast<int>(delay);
+        decoder.samples = decoder.detected_samples = samples - delay;
+        decoder.vbr_tag_found = 1;
+    }
+    return true;
+}
+
+// Fraunhofer's VBRI tag sits 32 bytes past the first frame's header. That frame carries no
+// audio, so the stream handed to minimp3 starts after it.
+std::optional<Mp3Decoder::VbriTag> Mp3Decoder::readVbriTag() {
+    std::optional<uint64_t> firstFrame = Mp3FrameHeader::findFrameSync(*source, Mp3FrameHeader::audioDataOffset(*source), SYNC_SCAN_LIMIT);
+    if (!firstFrame || source->fill(4) < 4) return std::nullopt;
+
+    std::optional<Mp3FrameHeader> header = Mp3FrameHeader::parse(source->data());
+    if (!header || header->layer != 3 || header->frameBytes < VBRI_OFFSET + 26) return std::nullopt;
+    if (source->fill(header->frameBytes) < static_cast<size_t>(header->frameBytes)) return std::nullopt;
+
+    const uint8_t* tag = source->data() + VBRI_OFFSET;
+    if (std::memcmp(tag, "VBRI", 4) != 0) return std::nullopt;
+
+    streamStart = *firstFrame + header->frameBytes;
+    return VbriTag{ readBigEndian(tag + 14, 4), readBigEndian(tag + 6, 2) };
+}
+
+bool Mp3Decoder::decode(Block& block) {
+    mp3d_sample_t* samples = nullptr;
+    mp3dec_frame_info_t frameInfo = {};
+
+    size_t count = mp3dec_ex_read_frame(&decoder, &samples, &frameInfo, MINIMP3_MAX_SAMPLES_PER_FRAME);
+    if (count == 0) return false;
+
+    block.samples = samples;
+    block.frames = count / decoder.info.channels;
+    block.sampleRate = decoder.info.hz;
+    block.channels = decoder.info.channels;
+    return true;
+}
+
+bool Mp3Decoder::seek(uint64_t frame) {
+    uint64_t totalFrames = getTotalFrames();
+    if (totalFrames > 0 && frame >= totalFrames) frame = totalFrames - 1;
+
+    return mp3dec_ex_seek(&decoder, frame * decoder.info.channels) == 0;
+}
+
+uint64_t Mp3Decoder::getTotalFrames() {
+    if (decoder.info.channels == 0) return 0;
+    if (decoder.detected_samples > 0) return decoder.detected_samples / decoder.info.channels;
+
+    // Any seek except one to sample zero builds the frame index; seeking back to the current
+    // sample afterwards leaves playback where it was.
+    if (!decoder.indexes_built) {
+        uint64_t position = decoder.cur_sample;
+        if (mp3dec_ex_seek(&decoder, position + decoder.info.channels) != 0 || mp3dec_ex_seek(&decoder, position) != 0) return 0;
+    }
+    if (decoder.index.num_frames == 0) return 0;
+
+    const mp3dec_frame_t& lastFrame = decoder.index.frames[decoder.index.num_frames - 1];
+    uint64_t endSample = lastFrame.sample / decoder.info.channels + samplesPerFrame(decoder.info);
+    uint64_t delay = static_cast<uint64_t>(decoder.start_delay / decoder.info.channels);
+    return (endSample > delay) ? endSample - delay : 0;
+}
+
+// Without a tag or an index, the length is extrapolated from runs of frames sampled across
+// the file; VBR frame sizes vary too much for the first frame alone to say.
+uint64_t Mp3Decoder::estimateTotalFrames() {
+    if (decoder.detected_samples > 0 || decoder.indexes_built) return getTotalFrames();
+    if (estimatedFrames > 0) return estimatedFrames;
+
+    uint64_t audioStart = streamStart + decoder.start_offset, audioEnd = source->size();
+    if (audioEnd <= audioStart) return 0;
+
+    uint64_t resumeAt = source->position();
+    uint64_t sampledBytes = 0, sampledFrames = 0;
+    for (uint64_t probe = 0; probe < ESTIMATE_PROBES; probe++) {
+        std::optional<uint64_t> frameStart = Mp3FrameHeader::findFrameSync(*source, audioStart + (audioEnd - audioStart) * probe / ESTIMATE_PROBES, ESTIMATE_SCAN_LIMIT);
+        for (int frame = 0; frameStart && frame < ESTIMATE_FRAMES_PER_PROBE && source->fill(4) >= 4; frame++) {
+            std::optional<Mp3FrameHeader> header = Mp3FrameHeader::parse(source->data());
+            if (!header || source->fill(header->frameBytes) < static_cast<size_t>(header->frameBytes)) break;
+
+            sampledBytes += header->frameBytes;
+            sampledFrames += header->samples;
+            source->consume(header->frameBytes);
+        }
+    }
+    source->seek(resumeAt);
+
+    if (sampledBytes > 0) estimatedFrames = (audioEnd - audioStart) * sampledFrames / sampledBytes;
+    return estimatedFrames;
+}
+
+int Mp3Decoder::getSampleRate() const {
+    return decoder.info.hz;
+}
+
+const char* Mp3Decoder::getFormatName() const {
+    return "mp3";
+}
+
+size_t Mp3Decoder::readSource(void* buffer, size_t size, void* userData) {
+    InputSource* source = static_cast<Mp3Decoder*>(userData)->source.get();
+
+    size_t bytes = std::min(source->fill(size), size);
+    std::memcpy(buffer, source->data(), bytes);
+    source->consume(bytes);
+    return bytes;
+}
+
+int Mp3Decoder::seekSource(uint64_t position, void* userData) {
+    Mp3Decoder* decoder = static_cast<Mp3Decoder*>(userData);
+    return decoder->source->seek(decoder->streamStart + position) ? 0 : MP3D_E_IOERROR;
+}
+
+bool Mp3Decoder::sniff(InputSource& source) {
+    uint64_t audioStart = Mp3FrameHeader::audioDataOffset(source);
+    return Mp3FrameHeader::findFrameSync(source, audioStart, SYNC_SCAN_LIMIT).has_value();
+}
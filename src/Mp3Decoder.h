@@ -0,0 +1,46 @@
+#pragma once
+#include "headers.hpp"
+#include "AudioDecoder.h"
+#include "Mp3FrameHeader.h"
+
+// MPEG audio backend on minimp3's streaming mp3dec_ex API, fed from the InputSource through
+// read/seek callbacks. mp3dec_ex trims the LAME encoder delay and padding, seeks to an exact
+// sample through a frame index it builds on the first seek, and reads through a fixed-size
+// buffer, so memory stays bounded regardless of file length. Until that index exists, an
+// untagged file's length is estimated from frames sampled across it. Xing/Info tags are read
+// by minimp3 and VBRI tags here.
+class Mp3Decoder : public AudioDecoder {
+private:
+    struct VbriTag {
+        uint64_t frames;
+        uint32_t delay;
+    };
+
+    static constexpr int VBRI_OFFSET = 4 + 32;
+
+    std::unique_ptr<InputSource> source;
+    mp3dec_io_t io = {};
+    mp3dec_ex_t decoder = {};
+    uint64_t streamStart = 0, estimatedFrames = 0;
+
+    std::optional<VbriTag> readVbriTag();
+    static size_t readSource(void* buffer, size_t size, void* userData);
+    static int seekSource(uint64_t position, void* userData);
+public:
+    Mp3Decoder() = default;
+    ~Mp3Decoder() override;
+
+    Mp3Decoder(const Mp3Decoder&) = delete;
+    Mp3Decoder& operator=(const Mp3Decoder&) = delete;
+
+    bool open(std::unique_ptr<InputSource> source) override;
+    bool decode(Block& block) override;
+    bool seek(uint64_t frame) override;
+
+    uint64_t getTotalFrames() override;
+    uint64_t estimateTotalFrames() override;
+    int getSampleRate() const override;
+    const char* getFormatName() const override;
+
+    static bool sniff(InputSource& source);
+};
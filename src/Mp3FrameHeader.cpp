@@ -0,0 +1,106 @@
+#include "Mp3FrameHeader.h"
+
+namespace {
+    constexpr uint16_t BITRATES[5][15] = {
+        { 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448 },
+        { 0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384 },
+        { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 },
+        { 0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256 },
+        { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 }
+    };
+    constexpr int SAMPLE_RATES[3] = { 44100, 48000, 32000 };
+}
+
+std::optional<Mp3FrameHeader> Mp3FrameHeader::parse(const uint8_t* data) {
+    if (data[0] != 0xFF || (data[1] & 0xE0) != 0xE0) return std::nullopt;
+
+    int versionBits = (data[1] >> 3) & 0x03;
+    int layerBits = (data[1] >> 1) & 0x03;
+    int bitrateIndex = data[2] >> 4;
+    int sampleRateIndex = (data[2] >> 2) & 0x03;
+    if (versionBits == 1 || layerBits == 0 || bitrateIndex == 0 || bitrateIndex == 15 || sampleRateIndex == 3)
+        return std::nullopt;
+
+    Mp3FrameHeader header;
+    header.mpeg1 = versionBits == 3;
+    header.crc = (data[1] & 0x01) == 0;
+    header.layer = 4 - layerBits;
+    header.channels = ((data[3] >> 6) == 3) ? 1 : 2;
+
+    int table = header.mpeg1 ? header.layer - 1 : (header.layer == 1 ? 3 : 4);
+    header.bitrateKbps = BITRATES[table][bitrateIndex];
+
+    header.sampleRate = SAMPLE_RATES[sampleRateIndex];
+    if (versionBits == 2) header.sampleRate /= 2;
+    else if (versionBits == 0) header.sampleRate /= 4;
+
+    int padding = (data[2] >> 1) & 0x01;
+    int bitrate = header.bitrateKbps * 1000;
+    if (header.layer == 1) {
+        header.samples = 384;
+        header.frameBytes = (12 * bitrate / header.sampleRate + padding) * 4;
+    }
+    else if (header.layer == 2 || header.mpeg1) {
+        header.samples = 1152;
+        header.frameBytes = 144 * bitrate / header.sampleRate + padding;
+    }
+    else {
+        header.samples = 576;
+        header.frameBytes = 72 * bitrate / header.sampleRate + padding;
+    }
+
+    return header;
+}
+
+bool Mp3FrameHeader::compatibleWith(const Mp3FrameHeader& other) const {
+    return mpeg1 == other.mpeg1 && layer == other.layer && sampleRate == other.sampleRate;
+}
+
+uint64_t Mp3FrameHeader::audioDataOffset(InputSource& source) {
+    if (!source.seek(0) || source.fill(10) < 10) return 0;
+
+    uint8_t headerData[10];
+    std::memcpy(headerData, source.data(), 10);
+    MP3_Header header = recieveHeader(headerData);
+    if (std::memcmp(header.fileID, "ID3", 3) != 0) return 0;
+
+    uint64_t offset = 10 + static_cast<uint64_t>(header.tagSize);
+    return (offset < source.size()) ? offset : 0;
+}
+
+std::optional<uint64_t> Mp3FrameHeader::findFrameSync(InputSource& source, uint64_t from, uint64_t limit) {
+    if (!source.seek(from)) return std::nullopt;
+
+    while (source.position() - from < limit) {
+        if (source.fill(MINIMP3_BUF_SIZE) < 4) return std::nullopt;
+
+        const uint8_t* window = source.data();
+        size_t windowSize = source.available();
+
+        size_t pos = 0;
+        for (; pos + 4 <= windowSize; pos++) {
+            if (window[pos] != 0xFF) continue;
+
+            std::optional<Mp3FrameHeader> header = Mp3FrameHeader::parse(window + pos);
+            if (!header) continue;
+
+            size_t next = pos + header->frameBytes;
+            if (next + 4 > windowSize) {
+                if (source.position() + windowSize < source.size()) break;
+                source.consume(pos);
+                return source.position();
+            }
+
+            std::optional<Mp3FrameHeader> nextHeader = Mp3FrameHeader::parse(window + next);
+            if (nextHeader && nextHeader->compatibleWith(*header)) {
+                source.consume(pos);
+                return source.position();
+            }
+        }
+
+        if (pos == 0) return std::nullopt;
+        source.consume(pos);
+    }
+
+    return std::nullopt;
+}
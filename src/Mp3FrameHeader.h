@@ -0,0 +1,16 @@
+#pragma once
+#include "headers.hpp"
+#include "InputSource.h"
+
+// One parsed MPEG audio frame header, plus the helpers that find where the audio starts:
+// past a leading ID3v2 tag, then at the first sync word followed by a compatible frame.
+struct Mp3FrameHeader {
+    bool mpeg1 = false, crc = false;
+    int layer = 0, bitrateKbps = 0, sampleRate = 0, channels = 0, samples = 0, frameBytes = 0;
+
+    static std::optional<Mp3FrameHeader> parse(const uint8_t* data);
+    bool compatibleWith(const Mp3FrameHeader& other) const;
+
+    static uint64_t audioDataOffset(InputSource& source);
+    static std::optional<uint64_t> findFrameSync(InputSource& source, uint64_t from, uint64_t limit);
+};
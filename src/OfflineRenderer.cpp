@@ -0,0 +1,126 @@
+#include "OfflineRenderer.h"
+
+namespace {
+    std::string displayPath(const std::filesystem::path& path) {
+        std::u8string utf8 = path.u8string();
+        return std::string(utf8.begin(), utf8.end());
+    }
+}
+
+OfflineRenderer::OfflineRenderer(std::vector<std::filesystem::path> tracks) : tracks(std::move(tracks)) {}
+
+int OfflineRenderer::runCommandLine(const std::vector<std::string>& arguments) {
+    if (arguments.size() < 3 || arguments[0] != "--render") {
+        std::cerr << "usage: CLP --render <output.wav|null> [--realtime] <file or directory>...\n";
+        return 2;
+    }
+
+    bool realtime = false;
+    std::vector<std::filesystem::path> tracks;
+    for (size_t i = 2; i < arguments.size(); i++) {
+        if (arguments[i] == "--realtime") realtime = true;
+        else collectTracks(std::filesystem::path(arguments[i]), tracks);
+    }
+
+    if (tracks.empty()) {
+        std::cerr << "no playable audio files found\n";
+        return 1;
+    }
+
+    NullAudioSink::Pacing pacing = realtime ? NullAudioSink::Pacing::Realtime : NullAudioSink::Pacing::Unthrottled;
+    std::unique_ptr<AudioSink> sink;
+    if (arguments[1] == "null") sink = std::make_unique<NullAudioSink>(pacing);
+    else sink = std::make_unique<WavFileSink>(std::filesystem::path(arguments[1]), pacing);
+
+    OfflineRenderer renderer(std::move(tracks));
+    return renderer.run(std::move(sink), std::cout);
+}
+
+void OfflineRenderer::collectTracks(const std::filesystem::path& input, std::vector<std::filesystem::path>& tracks) {
+    std::error_code error;
+    if (!std::filesystem::is_directory(input, error)) {
+        if (isPlayable(input)) tracks.push_back(input);
+        else std::cerr << "skipping " << displayPath(input) << "\n";
+        return;
+    }
+
+    std::vector<std::filesystem::path> found;
+    for (auto it = std::filesystem::recursive_directory_iterator(input, error);
+        it != std::filesystem::recursive_directory_iterator(); it.increment(error))
+    {
+        if (error) break;
+        if (it->is_regular_file(error) && isPlayable(it->path())) found.push_back(it->path());
+    }
+
+    std::sort(found.begin(), found.end());
+    tracks.insert(tracks.end(), found.begin(), found.end());
+}
+
+bool OfflineRenderer::isPlayable(const std::filesystem::path& pathToSong) {
+    std::unique_ptr<InputSource> source = InputSource::create(pathToSong);
+    return source && DecoderRegistry::detect(*source) != nullptr;
+}
+
+int OfflineRenderer::run(std::unique_ptr<AudioSink> sink, std::ostream& out) {
+    if (tracks.empty()) return 1;
+
+    sm = std::make_unique<SoundModule>(std::move(sink));
+    sm->setOnSongChangedCallback([this](const std::filesystem::path&) { handleSongChanged(); });
+    sm->setOnSongFinishedCallback([this] { handleSongFinished(); });
+
+    auto renderStarted = std::chrono::steady_clock::now();
+    {
+        std::unique_lock<std::mutex> progressLock(progressMutex);
+        trackStarted = renderStarted;
+        sm->play(tracks[0]);
+        currentDuration = sm->getSongDuration(tracks[0]);
+        if (tracks.size() > 1) sm->queueNext(tracks[1]);
+
+        progressCv.wait(progressLock, [this] { return finished; });
+    }
+
+    sm.reset();
+    printReport(out);
+    return (reports.size() == tracks.size()) ? 0 : 1;
+}
+
+void OfflineRenderer::finishTrack() {
+    auto now = std::chrono::steady_clock::now();
+    reports.push_back({ tracks[currentTrack], currentDuration, std::chrono::duration<double>(now - trackStarted).count() });
+    trackStarted = now;
+}
+
+void OfflineRenderer::handleSongChanged() {
+    std::lock_guard<std::mutex> progressLock(progressMutex);
+    if (currentTrack + 1 >= tracks.size()) return;
+
+    finishTrack();
+    currentTrack++;
+    currentDuration = sm->getSongDuration(tracks[currentTrack]);
+    if (currentTrack + 1 < tracks.size()) sm->queueNext(tracks[currentTrack + 1]);
+}
+
+void OfflineRenderer::handleSongFinished() {
+    {
+        std::lock_guard<std::mutex> progressLock(progressMutex);
+        finishTrack();
+        finished = true;
+    }
+    progressCv.notify_one();
+}
+
+void OfflineRenderer::printReport(std::ostream& out) const {
+    double totalAudio = 0.0, totalWall = 0.0;
+
+    out << "track\taudio_seconds\twall_seconds\trealtime_factor\n";
+    for (const TrackReport& report : reports) {
+        double factor = (report.wallSeconds > 0.0) ? report.audioSeconds / report.wallSeconds : 0.0;
+        out << displayPath(report.path) << '\t' << report.audioSeconds << '\t' << report.wallSeconds << '\t' << factor << '\n';
+
+        totalAudio += report.audioSeconds;
+        totalWall += report.wallSeconds;
+    }
+
+    double totalFactor = (totalWall > 0.0) ? totalAudio / totalWall : 0.0;
+    out << "total\t" << totalAudio << '\t' << totalWall << '\t' << totalFactor << '\n';
+}
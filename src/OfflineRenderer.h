@@ -0,0 +1,39 @@
+#pragma once
+#include "headers.hpp"
+#include "SoundModule.hpp"
+
+// Non-interactive mode: plays a list of tracks gaplessly through the regular SoundModule
+// pipeline into a WAV file or the null sink, then reports the realtime factor per track.
+class OfflineRenderer {
+private:
+    struct TrackReport {
+        std::filesystem::path path;
+        double audioSeconds;
+        double wallSeconds;
+    };
+
+    std::vector<std::filesystem::path> tracks;
+    std::unique_ptr<SoundModule> sm;
+
+    std::mutex progressMutex;
+    std::condition_variable progressCv;
+    size_t currentTrack = 0;
+    bool finished = false;
+    double currentDuration = 0.0;
+    std::chrono::steady_clock::time_point trackStarted;
+    std::vector<TrackReport> reports;
+
+    void handleSongChanged();
+    void handleSongFinished();
+    void finishTrack();
+    void printReport(std::ostream& out) const;
+
+    static bool isPlayable(const std::filesystem::path& pathToSong);
+public:
+    explicit OfflineRenderer(std::vector<std::filesystem::path> tracks);
+
+    int run(std::unique_ptr<AudioSink> sink, std::ostream& out);
+
+    static int runCommandLine(const std::vector<std::string>& arguments);
+    static void collectTracks(const std::filesystem::path& input, std::vector<std::filesystem::path>& tracks);
+};
@@ -0,0 +1,59 @@
+#include "PeakLimiter.h"
+#include "GainStage.h"
+
+void PeakLimiter::configure(int channels, int sampleRate) {
+    this->channels = std::max(channels, 1);
+    rampFrames = std::max<size_t>(static_cast<size_t>(sampleRate / 50), 1);
+    releaseFactor = std::exp(-1.0f / (0.1f * std::max(sampleRate, 1)));
+    reset();
+}
+
+void PeakLimiter::setGain(float gain, bool immediate) {
+    targetGain = std::max(gain, 0.0f);
+    if (immediate) {
+        currentGain = targetGain;
+        rampRemaining = 0;
+        return;
+    }
+
+    rampRemaining = rampFrames;
+    gainStep = (targetGain - currentGain) / rampFrames;
+}
+
+void PeakLimiter::reset() {
+    currentGain = targetGain;
+    rampRemaining = 0;
+    envelope = 1.0f;
+}
+
+void PeakLimiter::process(int16_t* samples, size_t count) {
+    size_t frames = count / channels;
+
+    for (size_t frame = 0; frame < frames; frame++) {
+        if (rampRemaining == 0 && envelope == 1.0f && currentGain <= 1.0f) {
+            GainStage::applyGain(samples + frame * channels, samples + frame * channels, (frames - frame) * channels, currentGain);
+            return;
+        }
+
+        if (rampRemaining > 0) {
+            currentGain = (--rampRemaining == 0) ? targetGain : currentGain + gainStep;
+        }
+
+        int16_t* current = samples + frame * channels;
+        int32_t framePeak = 0;
+        for (int channel = 0; channel < channels; channel++) framePeak = std::max(framePeak, std::abs(static_cast<int32_t>(current[channel])));
+
+        envelope = 1.0f - (1.0f - envelope) * releaseFactor;
+        float boostedPeak = framePeak * currentGain * envelope;
+        if (boostedPeak > CEILING) envelope = CEILING / (framePeak * currentGain);
+        if (envelope > 0.99999f) envelope = 1.0f;
+
+        float gain = currentGain * envelope;
+        for (int channel = 0; channel < channels; channel++)
+            current[channel] = static_cast<int16_t>(std::lrint(std::clamp(current[channel] * gain, -32768.0f, CEILING)));
+    }
+}
+
+float PeakLimiter::getGain() const {
+    return currentGain;
+}
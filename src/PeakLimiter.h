@@ -0,0 +1,24 @@
+#pragma once
+#include "headers.hpp"
+
+// Applies the per-track ReplayGain factor to interleaved int16 PCM on the decode side and
+// keeps boosted peaks below full scale. The limiter has no lookahead, so it adds no
+// latency: the gain drops instantly to the level the loudest channel of a frame allows
+// and recovers with a 100 ms release, linked across channels. Gain changes between tracks
+// are ramped over 20 ms. Gains at or below unity never limit and run on the GainStage kernel.
+class PeakLimiter {
+private:
+    static constexpr float CEILING = 32767.0f;
+
+    float currentGain = 1.0f, targetGain = 1.0f, gainStep = 0.0f;
+    float envelope = 1.0f, releaseFactor = 0.0f;
+    size_t rampFrames = 882, rampRemaining = 0;
+    int channels = 2;
+public:
+    void configure(int channels, int sampleRate);
+    void setGain(float gain, bool immediate);
+    void reset();
+    void process(int16_t* samples, size_t count);
+
+    float getGain() const;
+};
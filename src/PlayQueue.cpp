@@ -0,0 +1,168 @@
+#include "PlayQueue.h"
+
+bool PlayQueue::contains(TrackId track) const {
+    return track < positionOf.size() && positionOf[track] != NOT_QUEUED;
+}
+
+void PlayQueue::swapPositions(uint32_t left, uint32_t right) {
+    std::swap(order[left], order[right]);
+    positionOf[order[left]] = left;
+    positionOf[order[right]] = right;
+}
+
+void PlayQueue::markDrawn(TrackId track) {
+    if (!contains(track) || positionOf[track] < drawn) return;
+    swapPositions(positionOf[track], drawn++);
+}
+
+void PlayQueue::markUndrawn(TrackId track) {
+    if (!contains(track) || positionOf[track] >= drawn) return;
+    swapPositions(positionOf[track], --drawn);
+}
+
+// One Fisher-Yates step. The current track is left out of the first draw of a new cycle, so
+// it never plays twice in a row across the boundary.
+PlayQueue::TrackId PlayQueue::drawFromPool() {
+    if (drawn == order.size()) drawn = 0;
+
+    uint32_t last = static_cast<uint32_t>(order.size()) - 1;
+    TrackId currentTrack = current();
+    uint32_t skipped = NOT_QUEUED;
+    if (currentTrack != NO_TRACK && contains(currentTrack) && positionOf[currentTrack] >= drawn && last > drawn) {
+        skipped = positionOf[currentTrack];
+        last--;
+    }
+
+    uint32_t pick = std::uniform_int_distribution<uint32_t>(drawn, last)(generator);
+    if (pick >= skipped) pick++;
+    swapPositions(pick, drawn++);
+    return order[drawn - 1];
+}
+
+// A drawn track that never got to play goes back into the pool.
+void PlayQueue::releasePending() {
+    if (pending != NO_TRACK && pendingSource == Source::Pool) markUndrawn(pending);
+    pending = NO_TRACK;
+}
+
+// Playing something new drops the entries that were stepped back over.
+void PlayQueue::record(TrackId track) {
+    history.erase(history.begin() + played, history.end());
+    history.push_back(track);
+    while (history.size() > std::max<size_t>(order.size(), 1)) history.pop_front();
+    played = history.size();
+}
+
+void PlayQueue::add(TrackId track) {
+    if (track >= positionOf.size()) positionOf.resize(static_cast<size_t>(track) + 1, NOT_QUEUED);
+    if (positionOf[track] != NOT_QUEUED) return;
+
+    positionOf[track] = static_cast<uint32_t>(order.size());
+    order.push_back(track);
+}
+
+// Track ids are reused after removal, so the track also leaves the history and the play-next
+// list rather than being skipped later.
+void PlayQueue::remove(TrackId track) {
+    if (!contains(track)) return;
+    if (pending == track) pending = NO_TRACK;
+
+    uint32_t position = positionOf[track];
+    if (position < drawn) {
+        swapPositions(position, --drawn);
+        position = drawn;
+    }
+    swapPositions(position, static_cast<uint32_t>(order.size()) - 1);
+    order.pop_back();
+    positionOf[track] = NOT_QUEUED;
+
+    size_t kept = 0, keptPlayed = 0;
+    for (size_t i = 0; i < history.size(); i++) {
+        if (history[i] == track) continue;
+        history[kept++] = history[i];
+        if (i < played) keptPlayed++;
+    }
+    history.resize(kept);
+    played = keptPlayed;
+
+    playNextTracks.erase(std::remove(playNextTracks.begin(), playNextTracks.end(), track), playNextTracks.end());
+}
+
+void PlayQueue::clear() {
+    order.clear();
+    positionOf.clear();
+    drawn = 0;
+    history.clear();
+    played = 0;
+    playNextTracks.clear();
+    pending = NO_TRACK;
+}
+
+void PlayQueue::playNext(TrackId track) {
+    if (!contains(track) || std::find(playNextTracks.begin(), playNextTracks.end(), track) != playNextTracks.end()) return;
+
+    releasePending();
+    playNextTracks.push_back(track);
+}
+
+PlayQueue::TrackId PlayQueue::peekNext(bool shuffle) {
+    if (pending != NO_TRACK && (shuffle || pendingSource == Source::PlayNext)) return pending;
+    releasePending();
+
+    if (!playNextTracks.empty()) {
+        pending = playNextTracks.front();
+        pendingSource = Source::PlayNext;
+    }
+    else if (!shuffle || order.empty()) {
+        return NO_TRACK;
+    }
+    else if (played < history.size()) {
+        pending = history[played];
+        pendingSource = Source::History;
+    }
+    else {
+        pending = drawFromPool();
+        pendingSource = Source::Pool;
+    }
+    return pending;
+}
+
+void PlayQueue::started(TrackId track) {
+    if (track == pending) {
+        Source source = pendingSource;
+        pending = NO_TRACK;
+        if (source == Source::History && played < history.size() && history[played] == track) {
+            played++;
+            return;
+        }
+        if (source == Source::PlayNext) playNextTracks.pop_front();
+    }
+    else {
+        if (track == current()) return;
+        releasePending();
+        playNextTracks.erase(std::remove(playNextTracks.begin(), playNextTracks.end(), track), playNextTracks.end());
+    }
+
+    markDrawn(track);
+    record(track);
+}
+
+PlayQueue::TrackId PlayQueue::previous() {
+    releasePending();
+    if (played <= 1) return NO_TRACK;
+
+    played--;
+    return history[played - 1];
+}
+
+PlayQueue::TrackId PlayQueue::current() const {
+    return played > 0 ? history[played - 1] : NO_TRACK;
+}
+
+size_t PlayQueue::size() const {
+    return order.size();
+}
+
+size_t PlayQueue::queuedCount() const {
+    return playNextTracks.size();
+}
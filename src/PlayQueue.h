@@ -0,0 +1,62 @@
+#pragma once
+#include "headers.hpp"
+
+// Decides which track follows the current one. Tracks queued with "play next" come first, in
+// the order they were queued; after them, when shuffling, comes a random order in which every
+// track plays once per cycle.
+//
+// The order is a Fisher-Yates shuffle drawn lazily. The track array is split into the tracks
+// already drawn this cycle and the pool still to draw. Each draw swaps one random pool entry
+// across the split, and a new cycle starts by moving the split back to zero, so stepping is
+// O(1) and nothing is reshuffled up front. Tracks added mid-cycle join the pool, and removed
+// ones leave without disturbing the rest. The play history supports going back and then
+// forward again through the same tracks, and it is capped at the library size.
+//
+// The next track is chosen when it is first asked for and kept until it starts playing, so
+// the caller can queue it ahead of time and ask again without changing the answer.
+class PlayQueue {
+public:
+    using TrackId = uint32_t;
+    static constexpr TrackId NO_TRACK = std::numeric_limits<TrackId>::max();
+private:
+    enum class Source { History, PlayNext, Pool };
+
+    static constexpr uint32_t NOT_QUEUED = std::numeric_limits<uint32_t>::max();
+
+    std::vector<TrackId> order;
+    std::vector<uint32_t> positionOf;
+    uint32_t drawn = 0;
+
+    // history[played - 1] is the current track; the entries after it were stepped back over.
+    std::deque<TrackId> history;
+    size_t played = 0;
+    std::deque<TrackId> playNextTracks;
+
+    TrackId pending = NO_TRACK;
+    Source pendingSource = Source::Pool;
+    std::mt19937 generator{ std::random_device{}() };
+
+    bool contains(TrackId track) const;
+    void swapPositions(uint32_t left, uint32_t right);
+    void markDrawn(TrackId track);
+    void markUndrawn(TrackId track);
+    TrackId drawFromPool();
+    void releasePending();
+    void record(TrackId track);
+public:
+    void add(TrackId track);
+    void remove(TrackId track);
+    void clear();
+
+    void playNext(TrackId track);
+    // NO_TRACK when nothing is queued and the caller is not shuffling, or the library is empty.
+    TrackId peekNext(bool shuffle);
+    // Call whenever a track starts playing, whether or not it was the one peekNext returned.
+    void started(TrackId track);
+    // Steps back through the history; NO_TRACK at its start.
+    TrackId previous();
+    TrackId current() const;
+
+    size_t size() const;
+    size_t queuedCount() const;
+};
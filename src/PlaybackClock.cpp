@@ -0,0 +1,32 @@
+#include "PlaybackClock.h"
+
+int64_t PlaybackClock::nowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+double PlaybackClock::extrapolate(const Point& point, int64_t timeNanos) {
+    double advanced = point.audiblePosition + static_cast<double>(std::max<int64_t>(timeNanos - point.timeNanos, 0)) * point.samplesPerNano;
+    return std::min(advanced, point.deliveredPosition);
+}
+
+void PlaybackClock::update(size_t deliveredPosition, size_t latencySamples, double samplesPerSecond) {
+    int64_t now = nowNanos();
+    double delivered = static_cast<double>(deliveredPosition);
+    double audible = delivered - static_cast<double>(std::min(latencySamples, deliveredPosition));
+    if (latest.samplesPerNano > 0.0) audible = std::max(audible, extrapolate(latest, now));
+
+    latest = { now, std::min(audible, delivered), delivered, samplesPerSecond / 1e9 };
+    published.store(latest);
+}
+
+void PlaybackClock::freeze() {
+    int64_t now = nowNanos();
+    double audible = extrapolate(latest, now);
+
+    latest = { now, audible, audible, latest.samplesPerNano };
+    published.store(latest);
+}
+
+double PlaybackClock::position() const {
+    return extrapolate(published.load(), nowNanos());
+}
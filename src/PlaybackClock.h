@@ -0,0 +1,30 @@
+#pragma once
+#include "headers.hpp"
+#include "SeqLock.h"
+
+// Turns the callback's consumed-sample counter into the position that is audible right now.
+// Every callback publishes a point: when it ran, what was audible at that moment (delivered
+// minus the device latency) and how far delivery had got. Readers extrapolate from the latest
+// point at the output rate but never past what was delivered, and a new point never starts
+// behind where the previous one had reached, so the clock only moves forward.
+// update() and freeze() must not run concurrently (callback thread, or under the sink lock);
+// position() may be called from any thread.
+class PlaybackClock {
+private:
+    struct Point {
+        int64_t timeNanos = 0;
+        double audiblePosition = 0.0;
+        double deliveredPosition = 0.0;
+        double samplesPerNano = 0.0;
+    };
+
+    SeqLock<Point> published;
+    Point latest;
+
+    static int64_t nowNanos();
+    static double extrapolate(const Point& point, int64_t timeNanos);
+public:
+    void update(size_t deliveredPosition, size_t latencySamples, double samplesPerSecond);
+    void freeze();
+    double position() const;
+};
@@ -1,90 +1,372 @@
 ﻿#include "Player.hpp"
 
-void Player::handleSongEnding() {
-    if (musicNames.empty()) {
-        currentlyPlaying.clear();
-        return;
-    }
+int Player::nextSongIndex() {
+    if (playlist.empty()) return -1;
+
+    PlayQueue::TrackId queued = playlist.playQueue().peekNext(groupStates->currentMode == PlaybackMode::Shuffle);
+    if (queued != PlayQueue::NO_TRACK) return playlist.rowOf(queued);
 
     switch (groupStates->currentMode) {
     case PlaybackMode::Normal:
-        if (selectedSongIndex + 1 < musicNames.size()) {
-            selectedSongIndex++;
-            currentlyPlaying = musicNames[selectedSongIndex];
-            sm.play(fm.getPathByName(musicNames[selectedSongIndex]));
-        }
-        else {
-            currentlyPlaying.clear();
-        }
-        break;
+        if (selectedSongIndex + 1 < static_cast<int>(playlist.size())) return selectedSongIndex + 1;
+        return -1;
     case PlaybackMode::Repeat:
-        selectedSongIndex++;
-        if (selectedSongIndex >= musicNames.size()) {
-            selectedSongIndex = 0;
-        }
-        currentlyPlaying = musicNames[selectedSongIndex];
-        sm.play(fm.getPathByName(musicNames[selectedSongIndex]));
-        break;
+        if (selectedSongIndex + 1 < static_cast<int>(playlist.size())) return selectedSongIndex + 1;
+        return 0;
     case PlaybackMode::RepeatOne:
-        sm.play(fm.getPathByName(musicNames[selectedSongIndex]));
-        break;
+        return selectedSongIndex;
     case PlaybackMode::Shuffle:
-        std::mt19937 gen(rd());
-        std::uniform_int_distribution<int> dist(0, musicNames.size() - 1);
-        int newIndex = 0;
-        do {
-            newIndex = dist(gen);
-        } while (newIndex == selectedSongIndex && musicNames.size() > 1);
-
-        selectedSongIndex = newIndex;
-        currentlyPlaying = musicNames[selectedSongIndex];
-        sm.play(fm.getPathByName(musicNames[selectedSongIndex]));
-
-        break;
+        return -1;
+    }
+    return -1;
+}
+
+void Player::playSong(int index) {
+    selectedSongIndex = index;
+    playlist.playQueue().started(playlist.track(selectedSongIndex));
+    currentlyPlaying = playlist.name(selectedSongIndex);
+    sm.play(playlist.path(selectedSongIndex));
+    queueNextSong();
+}
+
+void Player::queueNextSong() {
+    int nextIndex = currentlyPlaying.empty() ? -1 : nextSongIndex();
+    if (nextIndex < 0) {
+        clearQueuedSong();
+        sm.clearQueue();
+        return;
+    }
+
+    queuedSong = playlist.name(nextIndex);
+    queuedPath = playlist.path(nextIndex);
+    sm.queueNext(queuedPath);
+}
+
+void Player::clearQueuedSong() {
+    queuedSong.clear();
+    queuedPath.clear();
+}
+
+// The engine reports the track it entered. It is not always the one queued last: the queue
+// can be replaced after that track has started decoding but before it became audible.
+void Player::handleSongChanged(const std::filesystem::path& pathToSong) {
+    int row = playlist.find(pathToSong);
+    if (row >= 0) {
+        selectedSongIndex = row;
+        playlist.playQueue().started(playlist.track(row));
+        currentlyPlaying = playlist.name(row);
+    }
+    else {
+        currentlyPlaying = (pathToSong == queuedPath) ? queuedSong : pathToSong.stem().wstring();
+    }
+
+    queueNextSong();
+    redraws.requestRedraw();
+}
+
+const std::wstring& Player::timeLabel() {
+    int elapsedSeconds = static_cast<int>(sm.getTimeElapsed());
+    int durationSeconds = static_cast<int>(sm.getSongDuration());
+    if (elapsedSeconds == labelElapsedSeconds && durationSeconds == labelDurationSeconds) return timeLabelText;
+
+    labelElapsedSeconds = elapsedSeconds;
+    labelDurationSeconds = durationSeconds;
+
+    SoundModule::TimeText elapsedText, durationText;
+    SoundModule::formatTime(elapsedSeconds, elapsedText);
+    SoundModule::formatTime(durationSeconds, durationText);
+
+    timeLabelText.assign(elapsedText.data());
+    timeLabelText += L'/';
+    timeLabelText += durationText.data();
+    return timeLabelText;
+}
+
+void Player::handleSongEnding() {
+    int nextIndex = nextSongIndex();
+    if (nextIndex < 0) {
+        currentlyPlaying.clear();
+        clearQueuedSong();
+    }
+    else {
+        playSong(nextIndex);
+    }
+    redraws.requestRedraw();
+}
+
+// The playlist is reconciled with the scan rather than rebuilt, so tracks that are still
+// there keep their ids and the play queue keeps its history and play-next list for them.
+void Player::rescanLibrary() {
+    int generation = ++libraryGeneration;
+    auto foundPaths = std::make_shared<std::unordered_set<std::wstring>>();
+
+    fm.readMusicList([this, generation, foundPaths](const LibraryTrack& track) {
+        screen.Post([this, generation, foundPaths, track]() {
+            if (generation != libraryGeneration) return;
+            foundPaths->insert(track.path.wstring());
+            refreshSong(track);
+            redraws.requestRedraw();
+        });
+    }, [this, generation, foundPaths]() {
+        screen.Post([this, generation, foundPaths]() {
+            if (generation != libraryGeneration) return;
+
+            LibraryChanges changes;
+            for (int row = 0; row < static_cast<int>(playlist.size()); row++) {
+                std::filesystem::path pathToSong = playlist.path(row);
+                if (foundPaths->count(pathToSong.wstring()) == 0) changes.removed.push_back(std::move(pathToSong));
+            }
+            applyLibraryChanges(changes);
+        });
+    });
+}
+
+// A track whose display name changed is removed and added again, as the watcher reports it.
+void Player::refreshSong(const LibraryTrack& track) {
+    int row = playlist.find(track.path);
+    if (row >= 0 && playlist.name(row) == track.name) return;
+
+    if (row >= 0) removeSong(track.path);
+    insertSong(track);
+}
+
+void Player::insertSong(const LibraryTrack& track) {
+    int insertedIndex = playlist.insert(track);
+    if (insertedIndex < 0) return;
+
+    searchStale = true;
+    if (playlist.size() > 1 && insertedIndex <= selectedSongIndex) selectedSongIndex++;
+}
+
+void Player::removeSong(const std::filesystem::path& pathToSong) {
+    int removedIndex = playlist.remove(pathToSong);
+    if (removedIndex < 0) return;
+
+    // Results hold track ids, and a removed track's id is reused by the next insertion.
+    searchStale = true;
+
+    if (removedIndex < selectedSongIndex) selectedSongIndex--;
+    selectedSongIndex = std::clamp(selectedSongIndex, 0, std::max(static_cast<int>(playlist.size()) - 1, 0));
+}
+
+void Player::applyLibraryChanges(const LibraryChanges& changes) {
+    for (const std::filesystem::path& pathToSong : changes.removed) removeSong(pathToSong);
+    for (const LibraryTrack& track : changes.added) insertSong(track);
+
+    // The neighbours of the playing song may have changed; the play queue keeps its pick
+    // unless that file is gone.
+    if (!currentlyPlaying.empty()) queueNextSong();
+    redraws.requestRedraw();
+}
+
+// In shuffle mode this walks back through the play history; otherwise it is the row above.
+void Player::playPreviousSong() {
+    if (currentlyPlaying.empty() || playlist.empty()) return;
+
+    int previousIndex = -1;
+    if (groupStates->currentMode == PlaybackMode::Shuffle) {
+        PlayQueue::TrackId previousTrack = playlist.playQueue().previous();
+        if (previousTrack != PlayQueue::NO_TRACK) previousIndex = playlist.rowOf(previousTrack);
+    }
+    else if (selectedSongIndex > 0) {
+        previousIndex = selectedSongIndex - 1;
+    }
+    else if (groupStates->currentMode == PlaybackMode::Repeat) {
+        previousIndex = static_cast<int>(playlist.size()) - 1;
+    }
+    if (previousIndex >= 0) playSong(previousIndex);
+}
+
+// Skipping moves on even in repeat-one mode.
+void Player::playNextSong() {
+    if (currentlyPlaying.empty() || playlist.empty()) return;
+
+    int nextIndex = nextSongIndex();
+    if (groupStates->currentMode == PlaybackMode::RepeatOne && nextIndex == selectedSongIndex) {
+        nextIndex = (selectedSongIndex + 1) % static_cast<int>(playlist.size());
     }
-    screen.Post(Event::Custom);
+    if (nextIndex >= 0) playSong(nextIndex);
+}
+
+void Player::queueAsNext(Playlist::TrackId track) {
+    playlist.playQueue().playNext(track);
+    if (!currentlyPlaying.empty()) queueNextSong();
+}
+
+void Player::stepVolume(int delta) {
+    int volume = std::clamp(volumeSliderValue + delta, 0, 100);
+    if (volume == volumeSliderValue) return;
+
+    volumeSliderValue = volume;
+    sm.changeVolume(volumeSliderValue);
+    redraws.requestRedraw();
+}
+
+// Runs on the redraw scheduler's thread. It reads only the engine's published status and the
+// hold flags, and hands every change to the UI thread. While a song plays it sleeps until the
+// elapsed second or the progress percent next changes; otherwise until the engine wakes it.
+RedrawScheduler::Clock::time_point Player::pollDisplay(RedrawScheduler::Clock::time_point now) {
+    using Seconds = std::chrono::duration<double>;
+    RedrawScheduler::Clock::time_point next = pollVolumeHold(now);
+
+    SoundModule::PlaybackPosition position = sm.getPlaybackPosition();
+    double elapsed = Seconds(position.elapsed).count();
+    double length = Seconds(position.duration).count();
+    int second = static_cast<int>(elapsed);
+    int percent = length > 0.0 ? static_cast<int>(elapsed / length * 100) : 0;
+
+    if (position.playing != shownPlaying || position.paused != shownPaused || second != shownSecond || percent != shownPercent) {
+        shownPlaying = position.playing;
+        shownPaused = position.paused;
+        shownSecond = second;
+        shownPercent = percent;
+        screen.Post([this, percent]() {
+            if (!userSongProgressDragging) songProgressSliderValue = percent;
+            redraws.requestRedraw();
+        });
+    }
+
+    if (position.playing && !position.paused) {
+        double untilChange = second + 1 - elapsed;
+        if (length > 0.0) untilChange = std::min(untilChange, (percent + 1) * length / 100.0 - elapsed);
+        // Lands just past the boundary, so the next poll sees the new value.
+        untilChange = std::max(untilChange, 0.0) + 0.002;
+        next = std::min(next, now + std::chrono::duration_cast<RedrawScheduler::Clock::duration>(Seconds(untilChange)));
+    }
+    return next;
+}
+
+// Holding + or - repeats the step after half a second, every 200 ms at first and twice as
+// often after every five steps, down to 25 ms.
+RedrawScheduler::Clock::time_point Player::pollVolumeHold(RedrawScheduler::Clock::time_point now) {
+    int direction = soundButtonHoldingUp.load() ? 1 : soundButtonHoldingDown.load() ? -1 : 0;
+    if (direction != holdDirection) {
+        holdDirection = direction;
+        holdStepsAtInterval = 0;
+        holdInterval = std::chrono::milliseconds(200);
+        nextHoldStep = now + std::chrono::milliseconds(500);
+    }
+    if (direction == 0) return RedrawScheduler::Clock::time_point::max();
+
+    if (now >= nextHoldStep) {
+        screen.Post([this, direction]() {
+            stepVolume(direction);
+        });
+        if (++holdStepsAtInterval == 5 && holdInterval >= std::chrono::milliseconds(50)) {
+            holdStepsAtInterval = 0;
+            holdInterval /= 2;
+        }
+        nextHoldStep = now + holdInterval;
+    }
+    return nextHoldStep;
+}
+
+// Typing re-runs the query on every keystroke; an empty query goes back to the full list.
+void Player::runSearch() {
+    searchStale = false;
+    if (searchQuery.empty()) {
+        searchResults.clear();
+        musicListTab = 0;
+        return;
+    }
+
+    playlist.search(searchConverter.from_bytes(searchQuery), SEARCH_RESULT_LIMIT, searchResults);
+    musicListTab = 1;
+}
+
+void Player::playSearchResult() {
+    if (searchStale) runSearch();
+    if (selectedResult < 0 || selectedResult >= static_cast<int>(searchResults.size())) return;
+
+    int row = playlist.rowOf(searchResults[selectedResult]);
+    if (row >= 0) playSong(row);
 }
 
 Player::Player() {
     if (!std::filesystem::exists(appPath / "music")) {
         std::filesystem::create_directory(appPath / "music");
     }
-    fm.readMusicList();
+    rescanLibrary();
+    fm.watchLibrary([this](const LibraryChanges& changes) {
+        screen.Post([this, changes]() {
+            applyLibraryChanges(changes);
+        });
+    });
 
     sm.setOnSongFinishedCallback([this]() {
         screen.Post([this]() {
             handleSongEnding();
         });
     });
+    sm.setOnSongChangedCallback([this](const std::filesystem::path& pathToSong) {
+        screen.Post([this, pathToSong]() {
+            handleSongChanged(pathToSong);
+        });
+    });
+    sm.setOnStatusChangedCallback([this]() {
+        redraws.wake();
+    });
+    sm.setGainLookup([this](const std::filesystem::path& pathToSong) {
+        return fm.getReplayGain(pathToSong);
+    });
 
     auto name = Renderer([&] {
-        return hbox(text(L"MP3 Player") | center | flex | bold) | border | xflex;
+        return hbox(
+            text(L"MP3 Player") | center | flex | bold,
+            text(std::to_wstring(redraws.framesLastMinute()) + L" frames/min") | dim
+        ) | border | xflex;
     });
 
     auto terminalSize = Terminal::Size();
 
-    for (const auto& [name, file] : fm.getMusicList())
-        musicNames.push_back(name);
-    std::sort(musicNames.begin(), musicNames.end());
-
-    auto menu = Menu(&musicNames, &selectedSongIndex, MenuOption::Vertical());
+    auto menu = Make<PlaylistView>(playlist, selectedSongIndex) | CatchEvent([&](Event event) {
+        if (event != Event::Character('n') || playlist.empty()) return false;
+        queueAsNext(playlist.track(selectedSongIndex));
+        return true;
+    });
     auto refreshButton = Button(L"Refresh playlist!", [&]() {
-        selectedSongIndex = 0;
-        musicNames.clear();
-        fm.getMusicList();
-        for (const auto& [name, file] : fm.getMusicList())
-            musicNames.push_back(name);
-        std::sort(musicNames.begin(), musicNames.end());
+        rescanLibrary();
+    });
+
+    InputOption searchOption = InputOption::Default();
+    searchOption.multiline = false;
+    searchOption.on_change = [&] {
+        selectedResult = 0;
+        runSearch();
+    };
+    searchOption.on_enter = [&] {
+        playSearchResult();
+    };
+    auto searchInput = Input(&searchQuery, "Search", searchOption) | CatchEvent([&](Event event) {
+        if (event != Event::Escape || searchQuery.empty()) return false;
+        searchQuery.clear();
+        runSearch();
+        return true;
+    });
+
+    auto searchResultsView = Make<PlaylistView>(playlist, selectedResult, &searchResults) | CatchEvent([&](Event event) {
+        if (event == Event::Return) {
+            playSearchResult();
+            return true;
+        }
+        if (event == Event::Character('n') && selectedResult >= 0 && selectedResult < static_cast<int>(searchResults.size())) {
+            queueAsNext(searchResults[selectedResult]);
+            return true;
+        }
+        return false;
     });
+    auto musicList = Container::Tab({ menu, searchResultsView }, &musicListTab);
 
-    auto musicPaneControls = Container::Vertical({ menu, refreshButton });
+    auto musicPaneControls = Container::Vertical({ searchInput, musicList, refreshButton });
 
     auto musicPane = Renderer(musicPaneControls, [&] {
+        if (searchStale) runSearch();
         return vbox(
             text("Music List") | center | bold,
             separator(),
-            menu->Render(),
-            filler(),
+            searchInput->Render(),
+            separator(),
+            musicList->Render(),
             refreshButton->Render()
         ) | border | size(WIDTH, EQUAL, terminalSize.dimx / 3);
     });
@@ -94,9 +376,11 @@ Player::Player() {
             sm.pause();
             return;
         }
-        if (!musicNames.empty()) {
-            currentlyPlaying = musicNames[selectedSongIndex];
-            sm.play(fm.getPathByName(musicNames[selectedSongIndex]));
+        if (musicListTab == 1) {
+            playSearchResult();
+        }
+        else if (!playlist.empty()) {
+            playSong(selectedSongIndex);
         }
     }, ButtonTextCentred());
 
@@ -104,8 +388,17 @@ Player::Player() {
         if (!currentlyPlaying.empty()) sm.pause();
     }, ButtonTextCentred());
 
+    auto previousButton = Button(L"⏮", [&] {
+        playPreviousSong();
+    }, ButtonTextCentred());
+
+    auto nextButton = Button(L"⏭", [&] {
+        playNextSong();
+    }, ButtonTextCentred());
+
     auto stopButton = Button(L"■", [&] {
         currentlyPlaying.clear();
+        clearQueuedSong();
         sm.stop();
     }, ButtonTextCentred());
 
@@ -118,8 +411,8 @@ Player::Player() {
         .direction = Direction::Up
     }) | CatchEvent([&](Event event) {
         auto mouse = event.mouse();
-        if (mouse.x >= volumeSliderBox.x_min && mouse.x <= volumeSliderBox.x_max &&
-            mouse.y >= volumeSliderBox.y_min && mouse.y <= volumeSliderBox.y_max || userVolumeDragging) {
+        if ((mouse.x >= volumeSliderBox.x_min && mouse.x <= volumeSliderBox.x_max &&
+            mouse.y >= volumeSliderBox.y_min && mouse.y <= volumeSliderBox.y_max) || userVolumeDragging) {
             if (event.is_mouse()) {
                 if (event.mouse().button == Mouse::Left) {
                     if (event.mouse().motion == Mouse::Pressed) {
@@ -140,10 +433,7 @@ Player::Player() {
 
     Box volumeUpButtonBox;
     auto volumeUpButton = Button(L"+", [&] {
-        if (volumeSliderValue < 100) {
-            volumeSliderValue++;
-            sm.changeVolume(volumeSliderValue);
-        }
+        stepVolume(1);
     }, ButtonTextCentred()) | CatchEvent([&](Event event) {
         auto mouse = event.mouse();
         if (mouse.x >= volumeUpButtonBox.x_min && mouse.x <= volumeUpButtonBox.x_max &&
@@ -151,16 +441,9 @@ Player::Player() {
             if (event.is_mouse()) {
                 if (event.mouse().button == Mouse::Left) {
                     if (event.mouse().motion == Mouse::Pressed) {
-                        if (!soundButtonHoldingUp.load()) {
-                            holdingStart = std::chrono::steady_clock::now();
-                            soundButtonHoldingUp.store(true);
-                        }
+                        if (!soundButtonHoldingUp.exchange(true)) redraws.wake();
                     } else if (event.mouse().motion == Mouse::Released) {
-                        if (soundButtonHoldingUp.load()) {
-                            soundButtonHoldingUp.store(false);
-                            volumeChangedTimes = 0;
-                            volumeChangeStep = 200;
-                        }
+                        if (soundButtonHoldingUp.exchange(false)) redraws.wake();
                     }
                 }
             }
@@ -172,10 +455,7 @@ Player::Player() {
 
     Box volumeDownButtonBox;
     auto volumeDownButton = Button(L"-", [&] {
-        if (volumeSliderValue > 0) {
-            volumeSliderValue--;
-            sm.changeVolume(volumeSliderValue);
-        }
+        stepVolume(-1);
     }, ButtonTextCentred()) | CatchEvent([&](Event event) {
         auto mouse = event.mouse();
         if (mouse.x >= volumeDownButtonBox.x_min && mouse.x <= volumeDownButtonBox.x_max &&
@@ -183,16 +463,9 @@ Player::Player() {
             if (event.is_mouse()) {
                 if (event.mouse().button == Mouse::Left) {
                     if (event.mouse().motion == Mouse::Pressed) {
-                        if (!soundButtonHoldingDown.load()) {
-                            holdingStart = std::chrono::steady_clock::now();
-                            soundButtonHoldingDown.store(true);
-                        }
+                        if (!soundButtonHoldingDown.exchange(true)) redraws.wake();
                     } else if (event.mouse().motion == Mouse::Released) {
-                        if (soundButtonHoldingDown.load()) {
-                            soundButtonHoldingDown.store(false);
-                            volumeChangedTimes = 0;
-                            volumeChangeStep = 200;
-                        }
+                        if (soundButtonHoldingDown.exchange(false)) redraws.wake();
                     }
                 }
             }
@@ -206,8 +479,8 @@ Player::Player() {
     auto songProgressSlider = Slider("", &songProgressSliderValue, 0, 100, 1)
     | CatchEvent([&](Event event) {
         auto mouse = event.mouse();
-        if (mouse.x >= songProgressSliderBox.x_min && mouse.x <= songProgressSliderBox.x_max &&
-            mouse.y >= songProgressSliderBox.y_min && mouse.y <= songProgressSliderBox.y_max || userSongProgressDragging) {
+        if ((mouse.x >= songProgressSliderBox.x_min && mouse.x <= songProgressSliderBox.x_max &&
+            mouse.y >= songProgressSliderBox.y_min && mouse.y <= songProgressSliderBox.y_max) || userSongProgressDragging) {
             if (event.is_mouse()) {
                 if (event.mouse().button == Mouse::Left) {
                     if (event.mouse().motion == Mouse::Pressed) {
@@ -267,18 +540,21 @@ Player::Player() {
     auto repeatOneButton = Button(L"↻", [&] { 
             if (!groupStates->isActive(PlaybackMode::RepeatOne)) groupStates->setMode(PlaybackMode::RepeatOne);
             else groupStates->setMode(PlaybackMode::Normal);
+            queueNextSong();
         }, 
         ButtonCentredTextMutualSwitch(groupStates, PlaybackMode::RepeatOne));
 
     auto repeatAllButton = Button(L"⟳", [&] { 
             if (!groupStates->isActive(PlaybackMode::Repeat)) groupStates->setMode(PlaybackMode::Repeat);
             else groupStates->setMode(PlaybackMode::Normal);
+            queueNextSong();
         },
         ButtonCentredTextMutualSwitch(groupStates, PlaybackMode::Repeat));
 
     auto shuffleButton = Button(L"⤨", [&] { 
             if (!groupStates->isActive(PlaybackMode::Shuffle)) groupStates->setMode(PlaybackMode::Shuffle);
-            else groupStates->setMode(PlaybackMode::Normal); 
+            else groupStates->setMode(PlaybackMode::Normal);
+            queueNextSong();
         },
         ButtonCentredTextMutualSwitch(groupStates, PlaybackMode::Shuffle));
 
@@ -292,6 +568,8 @@ Player::Player() {
         volumeSlider,
         seekForwardButton,
         seekBackwardButton,
+        previousButton,
+        nextButton,
         repeatOneButton,
         repeatAllButton,
         shuffleButton
@@ -306,11 +584,13 @@ Player::Player() {
                 text(
                     (currentlyPlaying.empty()) ? L"Nothing playing yet" : currentlyPlaying
                 ) | center,
-                text(sm.fromDoubleToTime(sm.getTimeElapsed()) + L"/" + sm.fromDoubleToTime(sm.getSongDuration())) | center,
+                text(timeLabel()) | center,
                 hbox( 
+                    previousButton->Render() | flex,
                     seekBackwardButton->Render() | flex,
-                    seekForwardButton->Render() | flex
-                ) | size(WIDTH, EQUAL, 30)| center 
+                    seekForwardButton->Render() | flex,
+                    nextButton->Render() | flex
+                ) | size(WIDTH, EQUAL, 40)| center 
             ),
             filler(),
             hbox(
@@ -338,48 +618,19 @@ Player::Player() {
         Container::Horizontal({ musicPane, playerPane }) | flex 
     });
 
-    timerThread = std::thread([&] {
-        std::chrono::steady_clock::time_point lastVolumeChange;
-
-        while (!stopUpdateTimer.load()) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(volumeChangeStep));
-            if (soundButtonHoldingUp.load()) {
-                auto now = std::chrono::steady_clock::now();
-                if (std::chrono::duration_cast<std::chrono::milliseconds>(now - holdingStart).count() >= 500 &&
-                    std::chrono::duration_cast<std::chrono::milliseconds>(now - lastVolumeChange).count() >= volumeChangeStep &&
-                    volumeSliderValue < 100) {
-                    volumeSliderValue++;
-                    sm.changeVolume(volumeSliderValue);
-                    lastVolumeChange = std::chrono::steady_clock::now();
-                    if (++volumeChangedTimes == 5 && volumeChangeStep >= 50) {
-                        volumeChangedTimes = 0;
-                        volumeChangeStep /= 2;
-                    }
-                }
-            } 
-            else if (soundButtonHoldingDown.load()) {
-                auto now = std::chrono::steady_clock::now();
-                if (std::chrono::duration_cast<std::chrono::milliseconds>(now - holdingStart).count() >= 500 &&
-                    std::chrono::duration_cast<std::chrono::milliseconds>(now - lastVolumeChange).count() >= volumeChangeStep &&
-                    volumeSliderValue > 0) {
-                    volumeSliderValue--;
-                    sm.changeVolume(volumeSliderValue);
-                    lastVolumeChange = std::chrono::steady_clock::now();
-                    if (++volumeChangedTimes == 5 && volumeChangeStep >= 50) {
-                        volumeChangedTimes = 0;
-                        volumeChangeStep /= 2;
-                    }
-                }
-            }
-            if (!userSongProgressDragging) songProgressSliderValue = sm.getProgress() * 100;
-            screen.Post(Event::Custom);
-        }
+    auto root = Renderer(layout, [&] {
+        redraws.frameRendered();
+        return layout->Render();
     });
 
-    screen.Loop(layout);
+    redraws.start([this](RedrawScheduler::Clock::time_point now) {
+        return pollDisplay(now);
+    });
+    screen.Loop(root);
 }
 
 Player::~Player() {
-    stopUpdateTimer.store(true);
-    if (timerThread.joinable()) timerThread.join();
+    fm.stopWatching();
+    fm.cancelScan();
+    redraws.stop();
 }
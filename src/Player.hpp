@@ -3,30 +3,71 @@
 #include "ButtonStyles.h"
 #include "SoundModule.hpp"
 #include "FilesystemModule.h"
+#include "Playlist.h"
+#include "PlaylistView.h"
+#include "RedrawScheduler.h"
 
 using namespace ftxui;
 class Player {
 private:
+	static constexpr size_t SEARCH_RESULT_LIMIT = 500;
+
+	// Declared first so it outlives every thread that posts to it: the redraw scheduler, the
+	// sound module's engine thread and the library scanner and watcher.
+	ScreenInteractive screen = ScreenInteractive::Fullscreen();
+	// Declared before the sound module, whose engine thread wakes it.
+	RedrawScheduler redraws{ [this] { screen.Post(Event::Custom); } };
 	SoundModule sm;
 	FilesystemModule fm;
 
-	int selectedSongIndex = 0;
-	std::vector<std::wstring> musicNames;
-	std::wstring currentSongDuration = L"", currentlyPlaying = L"";
+	int selectedSongIndex = 0, libraryGeneration = 0;
+	Playlist playlist;
+	std::string searchQuery;
+	// Kept for the life of the player so a keystroke does not build a converter.
+	std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> searchConverter;
+	std::vector<Playlist::TrackId> searchResults;
+	int selectedResult = 0, musicListTab = 0;
+	bool searchStale = false;
+	std::wstring currentSongDuration = L"", currentlyPlaying = L"", queuedSong = L"";
+	std::filesystem::path queuedPath;
+	std::wstring timeLabelText;
+	int labelElapsedSeconds = -1, labelDurationSeconds = -1;
 	int songProgressSliderValue = 0, volumeSliderValue = 50;
 	bool userSongProgressDragging = false, userVolumeDragging = false;
 	std::shared_ptr<ButtonGroupState> groupStates = std::make_shared<ButtonGroupState>();
 
-	ScreenInteractive screen = ScreenInteractive::Fullscreen();
 	Component layout;
 
-	std::thread timerThread;
-	std::atomic<bool> stopUpdateTimer = false, soundButtonHoldingUp = false, soundButtonHoldingDown = false;
-	std::chrono::steady_clock::time_point holdingStart;
-	short volumeChangeStep = 200, volumeChangedTimes = 0;
-	std::random_device rd;
+	std::atomic<bool> soundButtonHoldingUp = false, soundButtonHoldingDown = false;
+
+	// Owned by the redraw scheduler's thread: what the display last showed and the state of a
+	// held volume button.
+	bool shownPlaying = false, shownPaused = false;
+	int shownSecond = -1, shownPercent = -1;
+	int holdDirection = 0, holdStepsAtInterval = 0;
+	std::chrono::milliseconds holdInterval{ 200 };
+	RedrawScheduler::Clock::time_point nextHoldStep;
 
 	void handleSongEnding();
+	void handleSongChanged(const std::filesystem::path& pathToSong);
+	int nextSongIndex();
+	void playSong(int index);
+	void playPreviousSong();
+	void playNextSong();
+	void queueAsNext(Playlist::TrackId track);
+	void queueNextSong();
+	void rescanLibrary();
+	void insertSong(const LibraryTrack& track);
+	void refreshSong(const LibraryTrack& track);
+	void removeSong(const std::filesystem::path& pathToSong);
+	void clearQueuedSong();
+	void applyLibraryChanges(const LibraryChanges& changes);
+	void runSearch();
+	void playSearchResult();
+	const std::wstring& timeLabel();
+	void stepVolume(int delta);
+	RedrawScheduler::Clock::time_point pollDisplay(RedrawScheduler::Clock::time_point now);
+	RedrawScheduler::Clock::time_point pollVolumeHold(RedrawScheduler::Clock::time_point now);
 public:
 	Player();
 	~Player();
@@ -0,0 +1,123 @@
+#include "Playlist.h"
+
+bool Playlist::rowBefore(TrackId left, TrackId right) const {
+    std::wstring_view leftName = strings.view(tracks[left].name), rightName = strings.view(tracks[right].name);
+    if (leftName != rightName) return leftName < rightName;
+    return strings.view(tracks[left].path) < strings.view(tracks[right].path);
+}
+
+int Playlist::rowOf(TrackId track) const {
+    auto position = std::lower_bound(rows.begin(), rows.end(), track, [this](TrackId left, TrackId right) { return rowBefore(left, right); });
+    return (position != rows.end() && *position == track) ? static_cast<int>(position - rows.begin()) : -1;
+}
+
+int Playlist::insert(const LibraryTrack& track) {
+    std::wstring pathText = track.path.wstring();
+    if (tracksByPath.count(pathText) != 0) return -1;
+
+    Track record = { strings.intern(track.name), strings.intern(pathText) };
+    TrackId index = 0;
+    if (!freeTracks.empty()) {
+        index = freeTracks.back();
+        freeTracks.pop_back();
+        tracks[index] = record;
+    }
+    else {
+        index = static_cast<TrackId>(tracks.size());
+        tracks.push_back(record);
+    }
+    tracksByPath.emplace(strings.view(record.path), index);
+    searchIndex.add(index, track.title, track.artist, track.album, track.path);
+    queue.add(index);
+
+    auto position = std::upper_bound(rows.begin(), rows.end(), index, [this](TrackId left, TrackId right) { return rowBefore(left, right); });
+    int row = static_cast<int>(position - rows.begin());
+    rows.insert(position, index);
+    return row;
+}
+
+// The record slot is reused by the next insert. Its strings stay in the pool, possibly shared
+// with another track's name, until enough have been released to make compacting worth it.
+int Playlist::remove(const std::filesystem::path& pathToSong) {
+    auto found = tracksByPath.find(pathToSong.wstring());
+    if (found == tracksByPath.end()) return -1;
+
+    TrackId index = found->second;
+    int row = rowOf(index);
+    tracksByPath.erase(found);
+    searchIndex.remove(index);
+    queue.remove(index);
+    freeTracks.push_back(index);
+    if (row >= 0) rows.erase(rows.begin() + row);
+
+    releasedCharacters += strings.view(tracks[index].name).size() + strings.view(tracks[index].path).size();
+    if (releasedCharacters > MIN_RELEASED_CHARACTERS && releasedCharacters * 2 > strings.characters()) compactStrings();
+    return row;
+}
+
+// Copies the listed tracks' strings into a fresh pool. Free record slots keep ids into the
+// old pool, but they are overwritten before they are read again.
+void Playlist::compactStrings() {
+    StringPool live;
+    tracksByPath.clear();
+    for (TrackId index : rows) {
+        Track& record = tracks[index];
+        record = { live.intern(strings.view(record.name)), live.intern(strings.view(record.path)) };
+        tracksByPath.emplace(live.view(record.path), index);
+    }
+
+    strings = std::move(live);
+    releasedCharacters = 0;
+}
+
+int Playlist::find(const std::filesystem::path& pathToSong) const {
+    auto found = tracksByPath.find(pathToSong.wstring());
+    return (found != tracksByPath.end()) ? rowOf(found->second) : -1;
+}
+
+std::wstring_view Playlist::name(int row) const {
+    return strings.view(tracks[rows[row]].name);
+}
+
+std::filesystem::path Playlist::path(int row) const {
+    return std::filesystem::path(strings.view(tracks[rows[row]].path));
+}
+
+size_t Playlist::search(std::wstring_view query, size_t limit, std::vector<TrackId>& results) {
+    return searchIndex.search(query, limit, results);
+}
+
+std::wstring_view Playlist::trackName(TrackId track) const {
+    return strings.view(tracks[track].name);
+}
+
+Playlist::TrackId Playlist::track(int row) const {
+    return rows[row];
+}
+
+PlayQueue& Playlist::playQueue() {
+    return queue;
+}
+
+size_t Playlist::size() const {
+    return rows.size();
+}
+
+size_t Playlist::stringCharacters() const {
+    return strings.characters();
+}
+
+bool Playlist::empty() const {
+    return rows.empty();
+}
+
+void Playlist::clear() {
+    rows.clear();
+    tracks.clear();
+    freeTracks.clear();
+    tracksByPath.clear();
+    searchIndex.clear();
+    queue.clear();
+    strings.clear();
+    releasedCharacters = 0;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "headers.hpp"
+#include "StringPool.h"
+#include "SearchIndex.h"
+#include "PlayQueue.h"
+#include "FilesystemModule.h"
+
+// The library as the UI sees it. Track records sit in one contiguous array and refer to
+// their display name and path through a StringPool; the row order is an array of record
+// indices sorted by name. Rows are what the list view and playback navigation use, and a
+// track is identified by its path, so two files with the same display name both appear.
+// A SearchIndex over the same records answers type-to-filter queries with track ids, which
+// stay valid until the track is removed, and a PlayQueue over them decides what plays next.
+// Names and paths handed out as views stay valid until the next remove, which may rebuild
+// the pool once removed tracks' strings make up half of it.
+class Playlist {
+public:
+    using TrackId = SearchIndex::TrackId;
+private:
+    struct Track {
+        StringPool::Id name, path;
+    };
+
+    StringPool strings;
+    std::vector<Track> tracks;
+    std::vector<TrackId> freeTracks;
+    std::vector<TrackId> rows;
+    std::unordered_map<std::wstring_view, TrackId> tracksByPath;
+    size_t releasedCharacters = 0;
+    SearchIndex searchIndex;
+    PlayQueue queue;
+
+    static constexpr size_t MIN_RELEASED_CHARACTERS = 64 * 1024;
+
+    bool rowBefore(TrackId left, TrackId right) const;
+    void compactStrings();
+public:
+    // Both return the affected row, or -1 when the path was already listed or is not listed.
+    int insert(const LibraryTrack& track);
+    int remove(const std::filesystem::path& pathToSong);
+
+    int find(const std::filesystem::path& pathToSong) const;
+    std::wstring_view name(int row) const;
+    std::filesystem::path path(int row) const;
+
+    size_t search(std::wstring_view query, size_t limit, std::vector<TrackId>& results);
+    std::wstring_view trackName(TrackId track) const;
+    TrackId track(int row) const;
+    int rowOf(TrackId track) const;
+    PlayQueue& playQueue();
+
+    size_t size() const;
+    size_t stringCharacters() const;
+    bool empty() const;
+    void clear();
+};
@@ -0,0 +1,86 @@
+#include "PlaylistView.h"
+
+PlaylistView::PlaylistView(const Playlist& playlist, int& selected, const std::vector<Playlist::TrackId>* results)
+    : playlist(playlist), selected(selected), results(results) {
+    // Until the first layout reports the real height, assume the whole terminal.
+    box.y_max = std::max(Terminal::Size().dimy - 1, 0);
+}
+
+int PlaylistView::rowCount() const {
+    return static_cast<int>(results != nullptr ? results->size() : playlist.size());
+}
+
+std::wstring_view PlaylistView::rowName(int row) const {
+    return results != nullptr ? playlist.trackName((*results)[row]) : playlist.name(row);
+}
+
+int PlaylistView::visibleRows() const {
+    return std::max(box.y_max - box.y_min + 1, 1);
+}
+
+Element PlaylistView::Render() {
+    int trackCount = rowCount();
+    int rowsShown = visibleRows();
+    selected = std::clamp(selected, 0, std::max(trackCount - 1, 0));
+
+    if (selected < firstRow) firstRow = selected;
+    if (selected >= firstRow + rowsShown) firstRow = selected - rowsShown + 1;
+    firstRow = std::clamp(firstRow, 0, std::max(trackCount - rowsShown, 0));
+
+    bool focused = Focused();
+    Elements rows;
+    rows.reserve(std::min(rowsShown, trackCount));
+
+    for (int row = firstRow; row < std::min(firstRow + rowsShown, trackCount); row++) {
+        std::wstring label = (row == selected) ? L"> " : L"  ";
+        label += rowName(row);
+
+        Element line = text(std::move(label));
+        if (row == selected) line |= focused ? inverted : bold;
+        rows.push_back(std::move(line));
+    }
+
+    return vbox(std::move(rows)) | frame | yflex | reflect(box);
+}
+
+bool PlaylistView::moveSelection(int row) {
+    int previous = selected;
+    selected = std::clamp(row, 0, std::max(rowCount() - 1, 0));
+    return selected != previous;
+}
+
+bool PlaylistView::OnEvent(Event event) {
+    if (event.is_mouse()) return onMouseEvent(event);
+    if (!Focused() || rowCount() == 0) return false;
+
+    int page = std::max(visibleRows() - 1, 1);
+    if (event == Event::ArrowUp || event == Event::Character('k')) return moveSelection(selected - 1);
+    if (event == Event::ArrowDown || event == Event::Character('j')) return moveSelection(selected + 1);
+    if (event == Event::PageUp) return moveSelection(selected - page);
+    if (event == Event::PageDown) return moveSelection(selected + page);
+    if (event == Event::Home) return moveSelection(0);
+    if (event == Event::End) return moveSelection(rowCount() - 1);
+    return false;
+}
+
+bool PlaylistView::onMouseEvent(Event event) {
+    Mouse mouse = event.mouse();
+    if (!box.Contain(mouse.x, mouse.y) || !CaptureMouse(event)) return false;
+
+    if (mouse.button == Mouse::WheelUp || mouse.button == Mouse::WheelDown) {
+        moveSelection(selected + (mouse.button == Mouse::WheelUp ? -1 : 1));
+        return true;
+    }
+
+    if (mouse.button == Mouse::Left && mouse.motion == Mouse::Pressed) {
+        int row = firstRow + mouse.y - box.y_min;
+        if (row < rowCount()) moveSelection(row);
+        TakeFocus();
+        return true;
+    }
+    return false;
+}
+
+bool PlaylistView::Focusable() const {
+    return rowCount() > 0;
+}
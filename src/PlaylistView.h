@@ -0,0 +1,30 @@
+#pragma once
+#include "headers.hpp"
+#include "Playlist.h"
+
+using namespace ftxui;
+
+// Stand-in for a Menu over the playlist that only builds elements for the rows that fit in
+// the space it was given on the previous frame, so a render costs the same for a hundred
+// tracks as for a hundred thousand. Keys, wheel and clicks move the selection like Menu.
+// Given a list of search results it shows those tracks, in that order, instead.
+class PlaylistView : public ComponentBase {
+private:
+    const Playlist& playlist;
+    int& selected;
+    const std::vector<Playlist::TrackId>* results;
+    int firstRow = 0;
+    Box box;
+
+    int rowCount() const;
+    std::wstring_view rowName(int row) const;
+    int visibleRows() const;
+    bool moveSelection(int row);
+    bool onMouseEvent(Event event);
+public:
+    PlaylistView(const Playlist& playlist, int& selected, const std::vector<Playlist::TrackId>* results = nullptr);
+
+    Element Render() override;
+    bool OnEvent(Event event) override;
+    bool Focusable() const override;
+};
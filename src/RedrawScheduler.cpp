@@ -0,0 +1,78 @@
+#include "RedrawScheduler.h"
+
+namespace {
+    int64_t currentSecond() {
+        return std::chrono::duration_cast<std::chrono::seconds>(RedrawScheduler::Clock::now().time_since_epoch()).count();
+    }
+}
+
+RedrawScheduler::RedrawScheduler(std::function<void()> postRedraw) : postRedraw(std::move(postRedraw)) {}
+
+RedrawScheduler::~RedrawScheduler() {
+    stop();
+}
+
+void RedrawScheduler::start(Poll pollFunction) {
+    stop();
+    poll = std::move(pollFunction);
+    stopping = false;
+    woken = true;
+    schedulerThread = std::thread(&RedrawScheduler::schedulerLoop, this);
+}
+
+void RedrawScheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        stopping = true;
+    }
+    wakeCondition.notify_one();
+    if (schedulerThread.joinable()) schedulerThread.join();
+}
+
+void RedrawScheduler::wake() {
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        woken = true;
+    }
+    wakeCondition.notify_one();
+}
+
+void RedrawScheduler::requestRedraw() {
+    if (!redrawPending.exchange(true)) postRedraw();
+}
+
+void RedrawScheduler::schedulerLoop() {
+    Clock::time_point deadline = Clock::time_point::max();
+    std::unique_lock<std::mutex> lock(wakeMutex);
+
+    while (!stopping) {
+        if (deadline == Clock::time_point::max()) wakeCondition.wait(lock, [this] { return woken || stopping; });
+        else wakeCondition.wait_until(lock, deadline, [this] { return woken || stopping; });
+        if (stopping) break;
+
+        woken = false;
+        lock.unlock();
+        deadline = poll(Clock::now());
+        lock.lock();
+    }
+}
+
+// Clears the buckets of the seconds that passed without a frame.
+void RedrawScheduler::advanceFrameWindow(int64_t second) {
+    int64_t skipped = std::min<int64_t>(second - lastFrameSecond, static_cast<int64_t>(framesPerSecond.size()));
+    for (int64_t i = 1; i <= skipped; i++) framesPerSecond[(lastFrameSecond + i) % framesPerSecond.size()] = 0;
+    lastFrameSecond = std::max(lastFrameSecond, second);
+}
+
+void RedrawScheduler::frameRendered() {
+    redrawPending.store(false);
+
+    int64_t second = currentSecond();
+    advanceFrameWindow(second);
+    framesPerSecond[second % framesPerSecond.size()]++;
+}
+
+uint32_t RedrawScheduler::framesLastMinute() {
+    advanceFrameWindow(currentSecond());
+    return std::accumulate(framesPerSecond.begin(), framesPerSecond.end(), 0u);
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "headers.hpp"
+
+// Decides when the UI needs a new frame, so the screen is redrawn only when something on it
+// changed. Its thread runs a poll function and then sleeps until the deadline the poll asks
+// for, or until woken; a poll that has nothing to wait for sleeps until the next wake, so an
+// idle player makes no wakeups at all. The poll runs on the scheduler thread and must hand
+// any UI change to the UI thread itself. Redraw requests from any thread are coalesced: at
+// most one is waiting in the UI loop at a time. Rendered frames are counted per second over
+// the last minute.
+class RedrawScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+    // Returns when it wants to run next, or Clock::time_point::max() to wait for a wake.
+    using Poll = std::function<Clock::time_point(Clock::time_point now)>;
+private:
+    std::function<void()> postRedraw;
+    Poll poll;
+    std::thread schedulerThread;
+    std::mutex wakeMutex;
+    std::condition_variable wakeCondition;
+    bool woken = false, stopping = false;
+    std::atomic<bool> redrawPending = false;
+
+    std::array<uint32_t, 60> framesPerSecond = {};
+    int64_t lastFrameSecond = 0;
+
+    void schedulerLoop();
+    void advanceFrameWindow(int64_t second);
+public:
+    explicit RedrawScheduler(std::function<void()> postRedraw);
+    ~RedrawScheduler();
+
+    RedrawScheduler(const RedrawScheduler&) = delete;
+    RedrawScheduler& operator=(const RedrawScheduler&) = delete;
+
+    void start(Poll pollFunction);
+    void stop();
+    void wake();
+    void requestRedraw();
+
+    // UI thread only: called from the top-level renderer, and read back for display.
+    void frameRendered();
+    uint32_t framesLastMinute();
+};
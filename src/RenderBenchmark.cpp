@@ -0,0 +1,129 @@
+#include "RenderBenchmark.h"
+#include "Playlist.h"
+#include "PlaylistView.h"
+
+namespace {
+    constexpr int SCREEN_WIDTH = 80, SCREEN_HEIGHT = 40;
+
+    double millisecondsSince(std::chrono::steady_clock::time_point started) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    }
+
+    double percentile(std::vector<double>& values, double fraction) {
+        if (values.empty()) return 0.0;
+
+        size_t index = static_cast<size_t>(fraction * (values.size() - 1) + 0.5);
+        std::nth_element(values.begin(), values.begin() + index, values.end());
+        return values[index];
+    }
+}
+
+int RenderBenchmark::runCommandLine(const std::vector<std::string>& arguments) {
+    int frames = 20;
+    std::vector<size_t> sizes;
+
+    for (size_t i = 1; i < arguments.size(); i++) {
+        if (arguments[i] == "--frames" && i + 1 < arguments.size()) frames = std::max(1, std::atoi(arguments[++i].c_str()));
+        else if (std::atol(arguments[i].c_str()) > 0) sizes.push_back(static_cast<size_t>(std::atol(arguments[i].c_str())));
+        else {
+            std::cerr << "usage: CLP --bench-render [--frames N] [entries]...\n";
+            return 2;
+        }
+    }
+    if (sizes.empty()) sizes = { 1000, 10000, 100000 };
+
+    for (size_t entries : sizes) {
+        std::vector<std::wstring> names = syntheticNames(entries);
+        printResult(measureMenu(names, frames), std::cout);
+        printResult(measurePlaylistView(names, frames), std::cout);
+    }
+    return 0;
+}
+
+// "Artist - Title" names in a fixed shuffled order, standing in for the order a scan finds files in.
+std::vector<std::wstring> RenderBenchmark::syntheticNames(size_t count) {
+    std::vector<std::wstring> names;
+    names.reserve(count);
+    for (size_t i = 0; i < count; i++) names.push_back(L"Artist " + std::to_wstring(i % 997) + L" - Track " + std::to_wstring(i));
+
+    std::mt19937 generator(1);
+    std::shuffle(names.begin(), names.end(), generator);
+    return names;
+}
+
+// Draws the list the way the music pane does, with the selection in the middle of the list.
+void RenderBenchmark::renderFrames(Component list, int frames, Result& result) {
+    Screen screen = Screen::Create(Dimension::Fixed(SCREEN_WIDTH), Dimension::Fixed(SCREEN_HEIGHT));
+    auto pane = [&] {
+        return vbox(text("Music List") | center | bold, separator(), list->Render()) | border;
+    };
+
+    // The first frame lets PlaylistView learn its height.
+    Render(screen, pane());
+
+    std::vector<double> latencies;
+    latencies.reserve(frames);
+    for (int frame = 0; frame < frames; frame++) {
+        auto started = std::chrono::steady_clock::now();
+        Render(screen, pane());
+        latencies.push_back(millisecondsSince(started) * 1000.0);
+    }
+
+    result.frames = frames;
+    result.maxMicroseconds = *std::max_element(latencies.begin(), latencies.end());
+    result.p50Microseconds = percentile(latencies, 0.50);
+    result.p99Microseconds = percentile(latencies, 0.99);
+}
+
+// Inserting one name at a time into the sorted vector is what the player did as scan results arrived.
+RenderBenchmark::Result RenderBenchmark::measureMenu(const std::vector<std::wstring>& names, int frames) {
+    Result result;
+    result.view = "menu";
+    result.entries = names.size();
+
+    auto started = std::chrono::steady_clock::now();
+    std::vector<std::wstring> sortedNames;
+    for (const std::wstring& name : names) {
+        auto position = std::lower_bound(sortedNames.begin(), sortedNames.end(), name);
+        sortedNames.insert(position, name);
+    }
+    result.buildMilliseconds = millisecondsSince(started);
+
+    int selected = static_cast<int>(sortedNames.size() / 2);
+    renderFrames(Menu(&sortedNames, &selected, MenuOption::Vertical()), frames, result);
+    return result;
+}
+
+RenderBenchmark::Result RenderBenchmark::measurePlaylistView(const std::vector<std::wstring>& names, int frames) {
+    Result result;
+    result.view = "playlist_view";
+    result.entries = names.size();
+
+    auto started = std::chrono::steady_clock::now();
+    Playlist playlist;
+    for (size_t i = 0; i < names.size(); i++) {
+        LibraryTrack track;
+        track.name = names[i];
+        track.path = L"music/" + std::to_wstring(i) + L".mp3";
+        playlist.insert(track);
+    }
+    result.buildMilliseconds = millisecondsSince(started);
+
+    int selected = static_cast<int>(playlist.size() / 2);
+    renderFrames(Make<PlaylistView>(playlist, selected), frames, result);
+    return result;
+}
+
+void RenderBenchmark::printResult(const Result& result, std::ostream& out) {
+    double framesPerSecond = (result.p50Microseconds > 0.0) ? 1e6 / result.p50Microseconds : 0.0;
+
+    out << "{\"view\":\"" << result.view << "\""
+        << ",\"entries\":" << result.entries
+        << ",\"build_ms\":" << result.buildMilliseconds
+        << ",\"frames\":" << result.frames
+        << ",\"frame_p50_us\":" << result.p50Microseconds
+        << ",\"frame_p99_us\":" << result.p99Microseconds
+        << ",\"frame_max_us\":" << result.maxMicroseconds
+        << ",\"frames_per_second\":" << framesPerSecond
+        << "}\n";
+}
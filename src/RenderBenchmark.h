@@ -0,0 +1,27 @@
+#pragma once
+#include "headers.hpp"
+
+using namespace ftxui;
+
+// `--bench-render` mode: fills the playlist with synthetic tracks at several sizes and draws
+// the music pane into an off-screen Screen, once with the stock FTXUI Menu over a vector of
+// names and once with PlaylistView over a Playlist. Prints one JSON object per line with the
+// time to build the list in scan order and the per-frame render latency.
+class RenderBenchmark {
+private:
+    struct Result {
+        std::string view;
+        size_t entries = 0;
+        int frames = 0;
+        double buildMilliseconds = 0.0;
+        double p50Microseconds = 0.0, p99Microseconds = 0.0, maxMicroseconds = 0.0;
+    };
+
+    static std::vector<std::wstring> syntheticNames(size_t count);
+    static void renderFrames(Component list, int frames, Result& result);
+    static Result measureMenu(const std::vector<std::wstring>& names, int frames);
+    static Result measurePlaylistView(const std::vector<std::wstring>& names, int frames);
+    static void printResult(const Result& result, std::ostream& out);
+public:
+    static int runCommandLine(const std::vector<std::string>& arguments);
+};
@@ -0,0 +1,34 @@
+#pragma once
+#include "headers.hpp"
+
+// Track and album gain in dB towards the ReplayGain 2.0 reference loudness, with sample
+// peaks as linear fractions of full scale. Values come from RVA2/TXXX tags when the file
+// carries them and from the background loudness analysis otherwise.
+struct ReplayGain {
+    enum class Source : uint8_t {
+        None,
+        Tags,
+        Analysis
+    };
+
+    enum class Mode {
+        Off,
+        Track,
+        Album
+    };
+
+    static constexpr double REFERENCE_LUFS = -18.0;
+
+    Source source = Source::None;
+    bool hasAlbum = false;
+    float trackGain = 0.0f, trackPeak = 0.0f;
+    float albumGain = 0.0f, albumPeak = 0.0f;
+
+    bool known() const { return source != Source::None; }
+
+    // Album mode falls back to the track gain for tracks without album information.
+    float gainFor(Mode mode) const {
+        if (mode == Mode::Off || !known()) return 0.0f;
+        return (mode == Mode::Album && hasAlbum) ? albumGain : trackGain;
+    }
+};
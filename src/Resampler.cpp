@@ -0,0 +1,174 @@
+#include "Resampler.h"
+
+namespace {
+    constexpr double PI = 3.14159265358979323846;
+}
+
+bool Resampler::matches(int inputRate, int inputChannels, int outputRate, int outputChannels, Quality quality) const {
+    return this->inputRate == inputRate && this->inputChannels == inputChannels
+        && this->outputRate == outputRate && this->outputChannels == outputChannels
+        && (passthrough || this->quality == quality);
+}
+
+bool Resampler::configure(int inputRate, int inputChannels, int outputRate, int outputChannels, Quality quality) {
+    if (inputRate <= 0 || inputChannels <= 0 || outputRate <= 0 || outputChannels <= 0) return false;
+    if (outputChannels > MAX_OUTPUT_CHANNELS) return false;
+    if (matches(inputRate, inputChannels, outputRate, outputChannels, quality)) return true;
+
+    bool rebuildTable = quality == Quality::Sinc
+        && (this->quality != quality || this->inputRate != inputRate || this->outputRate != outputRate || sincTable.empty());
+
+    this->inputRate = inputRate;
+    this->inputChannels = inputChannels;
+    this->outputRate = outputRate;
+    this->outputChannels = outputChannels;
+    this->quality = quality;
+
+    uint32_t divisor = static_cast<uint32_t>(std::gcd(inputRate, outputRate));
+    inputStep = static_cast<uint32_t>(inputRate) / divisor;
+    outputStep = static_cast<uint32_t>(outputRate) / divisor;
+    passthrough = inputRate == outputRate;
+    halfTaps = (quality == Quality::Sinc) ? SINC_HALF_TAPS : 1;
+
+    if (!passthrough && rebuildTable) buildSincTable();
+    reset();
+    return true;
+}
+
+void Resampler::buildSincTable() {
+    int taps = SINC_HALF_TAPS * 2;
+    double cutoff = std::min(1.0, static_cast<double>(outputRate) / inputRate) * 0.97;
+    sincTable.assign(static_cast<size_t>(SINC_PHASES + 1) * taps, 0.0f);
+
+    for (int phase = 0; phase <= SINC_PHASES; phase++) {
+        double offset = static_cast<double>(phase) / SINC_PHASES;
+        float* row = &sincTable[static_cast<size_t>(phase) * taps];
+        double sum = 0.0;
+
+        for (int tap = 0; tap < taps; tap++) {
+            double t = (tap - SINC_HALF_TAPS + 1) - offset;
+            double x = t / SINC_HALF_TAPS;
+            if (x <= -1.0 || x >= 1.0) continue;
+
+            double window = 0.42 + 0.5 * std::cos(PI * x) + 0.08 * std::cos(2.0 * PI * x);
+            double sinc = (t == 0.0) ? 1.0 : std::sin(PI * cutoff * t) / (PI * cutoff * t);
+            row[tap] = static_cast<float>(cutoff * sinc * window);
+            sum += row[tap];
+        }
+
+        if (sum != 0.0) {
+            for (int tap = 0; tap < taps; tap++) row[tap] = static_cast<float>(row[tap] / sum);
+        }
+    }
+}
+
+void Resampler::reset() {
+    history.assign(static_cast<size_t>(halfTaps - 1) * outputChannels, 0.0f);
+    position = static_cast<size_t>(halfTaps - 1);
+    fraction = 0;
+}
+
+void Resampler::appendFrames(const int16_t* input, size_t frames) {
+    size_t start = history.size();
+    history.resize(start + frames * outputChannels);
+    float* out = history.data() + start;
+
+    for (size_t frame = 0; frame < frames; frame++, input += inputChannels, out += outputChannels) {
+        if (outputChannels == 1 && inputChannels > 1) {
+            float sum = 0.0f;
+            for (int channel = 0; channel < inputChannels; channel++) sum += input[channel];
+            out[0] = sum / inputChannels;
+            continue;
+        }
+        for (int channel = 0; channel < outputChannels; channel++) out[channel] = input[channel % inputChannels];
+    }
+}
+
+int16_t Resampler::toSample(float value) {
+    if (value >= 32767.0f) return 32767;
+    if (value <= -32768.0f) return -32768;
+    return static_cast<int16_t>(std::lrint(value));
+}
+
+void Resampler::process(const int16_t* input, size_t frames, std::vector<int16_t>& output) {
+    output.clear();
+    if (frames == 0 || outputChannels == 0) return;
+
+    if (passthrough) {
+        output.resize(frames * outputChannels);
+        if (inputChannels == outputChannels) {
+            std::memcpy(output.data(), input, output.size() * sizeof(int16_t));
+            return;
+        }
+
+        history.clear();
+        appendFrames(input, frames);
+        for (size_t i = 0; i < output.size(); i++) output[i] = toSample(history[i]);
+        history.clear();
+        return;
+    }
+
+    appendFrames(input, frames);
+    size_t available = history.size() / outputChannels;
+    output.reserve((frames * outputStep) / inputStep + 2);
+
+    while (position + halfTaps < available) {
+        const float* frame = &history[position * outputChannels];
+
+        if (quality == Quality::Linear) {
+            float weight = static_cast<float>(fraction) / outputStep;
+            for (int channel = 0; channel < outputChannels; channel++) {
+                float current = frame[channel];
+                float next = frame[outputChannels + channel];
+                output.push_back(toSample(current + (next - current) * weight));
+            }
+        }
+        else {
+            int taps = halfTaps * 2;
+            float phasePosition = static_cast<float>(fraction) * SINC_PHASES / outputStep;
+            int phase = static_cast<int>(phasePosition);
+            float blend = phasePosition - phase;
+            const float* lower = &sincTable[static_cast<size_t>(phase) * taps];
+            const float* upper = lower + taps;
+            const float* window = frame - static_cast<ptrdiff_t>(halfTaps - 1) * outputChannels;
+
+            float sums[MAX_OUTPUT_CHANNELS] = {};
+            for (int tap = 0; tap < taps; tap++) {
+                float coefficient = lower[tap] + (upper[tap] - lower[tap]) * blend;
+                for (int channel = 0; channel < outputChannels; channel++)
+                    sums[channel] += window[tap * outputChannels + channel] * coefficient;
+            }
+            for (int channel = 0; channel < outputChannels; channel++) output.push_back(toSample(sums[channel]));
+        }
+
+        fraction += inputStep;
+        while (fraction >= outputStep) {
+            fraction -= outputStep;
+            position++;
+        }
+    }
+
+    size_t keep = static_cast<size_t>(halfTaps - 1);
+    if (position > keep) {
+        size_t dropped = std::min(position - keep, available);
+        history.erase(history.begin(), history.begin() + dropped * outputChannels);
+        position -= dropped;
+    }
+}
+
+void Resampler::flush(std::vector<int16_t>& output) {
+    output.clear();
+    if (passthrough || outputChannels == 0) return;
+
+    std::vector<int16_t> silence(static_cast<size_t>(halfTaps) * inputChannels, 0);
+    process(silence.data(), halfTaps, output);
+    reset();
+}
+
+bool Resampler::isPassthrough() const {
+    return passthrough;
+}
+
+int Resampler::getOutputChannels() const {
+    return outputChannels;
+}
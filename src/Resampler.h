@@ -0,0 +1,41 @@
+#pragma once
+#include "headers.hpp"
+
+// Streaming sample-rate and channel-layout converter from decoded track PCM to the output
+// device format. Filter history is carried between calls, so consecutive frames (and
+// gapless track changes at the same rate) are converted without discontinuities.
+class Resampler {
+public:
+    enum class Quality {
+        Linear,
+        Sinc
+    };
+private:
+    static constexpr int SINC_HALF_TAPS = 16;
+    static constexpr int SINC_PHASES = 256;
+    static constexpr int MAX_OUTPUT_CHANNELS = 2;
+
+    Quality quality = Quality::Sinc;
+    int inputRate = 0, inputChannels = 0, outputRate = 0, outputChannels = 0;
+    int halfTaps = 1;
+    uint32_t inputStep = 1, outputStep = 1, fraction = 0;
+    size_t position = 0;
+    bool passthrough = true;
+
+    std::vector<float> history;
+    std::vector<float> sincTable;
+
+    void buildSincTable();
+    void appendFrames(const int16_t* input, size_t frames);
+    static int16_t toSample(float value);
+public:
+    bool configure(int inputRate, int inputChannels, int outputRate, int outputChannels, Quality quality);
+    bool matches(int inputRate, int inputChannels, int outputRate, int outputChannels, Quality quality) const;
+
+    void process(const int16_t* input, size_t frames, std::vector<int16_t>& output);
+    void flush(std::vector<int16_t>& output);
+    void reset();
+
+    bool isPassthrough() const;
+    int getOutputChannels() const;
+};
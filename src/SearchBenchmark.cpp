@@ -0,0 +1,159 @@
+#include "SearchBenchmark.h"
+#include "Playlist.h"
+
+namespace {
+    constexpr size_t RESULT_LIMIT = 500;
+
+    const std::array<const wchar_t*, 40> SYLLABLES = {
+        L"ka", L"lo", L"mi", L"ne", L"ra", L"to", L"vel", L"shi", L"dor", L"an",
+        L"bri", L"cus", L"el", L"fa", L"gon", L"hal", L"is", L"jun", L"ker", L"lum",
+        L"mor", L"nis", L"o", L"pra", L"qui", L"ros", L"sa", L"tem", L"u", L"var",
+        L"wen", L"xi", L"yo", L"zan", L"ber", L"cha", L"dre", L"ost", L"phe", L"ing"
+    };
+
+    double millisecondsSince(std::chrono::steady_clock::time_point started) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    }
+
+    double percentile(std::vector<double>& values, double fraction) {
+        if (values.empty()) return 0.0;
+
+        size_t index = static_cast<size_t>(fraction * (values.size() - 1) + 0.5);
+        std::nth_element(values.begin(), values.begin() + index, values.end());
+        return values[index];
+    }
+
+    std::wstring syntheticWord(std::mt19937& generator) {
+        std::uniform_int_distribution<size_t> syllable(0, SYLLABLES.size() - 1);
+        std::uniform_int_distribution<int> length(1, 3);
+
+        std::wstring word;
+        for (int i = length(generator); i > 0; i--) word += SYLLABLES[syllable(generator)];
+        word[0] += L'A' - L'a';
+        return word;
+    }
+
+    std::wstring syntheticPhrase(std::mt19937& generator, int minWords, int maxWords) {
+        std::uniform_int_distribution<int> words(minWords, maxWords);
+
+        std::wstring phrase = syntheticWord(generator);
+        for (int i = words(generator) - 1; i > 0; i--) phrase += L" " + syntheticWord(generator);
+        return phrase;
+    }
+}
+
+int SearchBenchmark::runCommandLine(const std::vector<std::string>& arguments) {
+    size_t queries = 200;
+    std::vector<size_t> sizes;
+
+    for (size_t i = 1; i < arguments.size(); i++) {
+        if (arguments[i] == "--queries" && i + 1 < arguments.size()) queries = std::max(1, std::atoi(arguments[++i].c_str()));
+        else if (std::atol(arguments[i].c_str()) > 0) sizes.push_back(static_cast<size_t>(std::atol(arguments[i].c_str())));
+        else {
+            std::cerr << "usage: CLP --bench-search [--queries N] [tracks]...\n";
+            return 2;
+        }
+    }
+    if (sizes.empty()) sizes = { 1000, 10000, 100000 };
+
+    for (size_t tracks : sizes) printResult(measure(tracks, queries), std::cout);
+    return 0;
+}
+
+// Artists with a handful of albums each, laid out on disk as music/Artist/Album/NN Title.mp3.
+std::vector<LibraryTrack> SearchBenchmark::syntheticLibrary(size_t count) {
+    std::mt19937 generator(1);
+    size_t artistCount = std::max<size_t>(count / 50, 1);
+    std::vector<std::wstring> artists, albums;
+    for (size_t i = 0; i < artistCount; i++) artists.push_back(syntheticPhrase(generator, 1, 2));
+    for (size_t i = 0; i < artistCount * 4; i++) albums.push_back(syntheticPhrase(generator, 1, 3));
+
+    std::uniform_int_distribution<size_t> pickArtist(0, artistCount - 1), pickAlbum(0, 3);
+    std::vector<LibraryTrack> library;
+    library.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        size_t artist = pickArtist(generator);
+        const std::wstring& album = albums[artist * 4 + pickAlbum(generator)];
+
+        LibraryTrack track;
+        track.title = syntheticPhrase(generator, 1, 4);
+        track.artist = artists[artist];
+        track.album = album;
+        track.name = track.artist + L" - " + track.title;
+        track.path = std::filesystem::path(L"music") / track.artist / album / (std::to_wstring(i % 20 + 1) + L" " + track.title + L".mp3");
+        library.push_back(std::move(track));
+    }
+    return library;
+}
+
+// What people type into a search box: an artist, a title, a title word with the artist, and
+// a word with two letters swapped.
+std::vector<std::wstring> SearchBenchmark::syntheticQueries(const std::vector<LibraryTrack>& library, size_t count) {
+    std::mt19937 generator(2);
+    std::uniform_int_distribution<size_t> pickTrack(0, library.size() - 1);
+
+    std::vector<std::wstring> queries;
+    for (size_t i = 0; i < count; i++) {
+        const LibraryTrack& track = library[pickTrack(generator)];
+        std::wstring firstTitleWord = track.title.substr(0, track.title.find(L' '));
+
+        switch (i % 4) {
+        case 0:
+            queries.push_back(track.artist);
+            break;
+        case 1:
+            queries.push_back(track.title);
+            break;
+        case 2:
+            queries.push_back(firstTitleWord + L" " + track.artist.substr(0, track.artist.find(L' ')));
+            break;
+        default:
+            if (firstTitleWord.size() >= 4) std::swap(firstTitleWord[1], firstTitleWord[2]);
+            queries.push_back(firstTitleWord);
+            break;
+        }
+    }
+    return queries;
+}
+
+SearchBenchmark::Result SearchBenchmark::measure(size_t count, size_t queries) {
+    Result result;
+    result.tracks = count;
+    std::vector<LibraryTrack> library = syntheticLibrary(count);
+
+    auto started = std::chrono::steady_clock::now();
+    Playlist playlist;
+    for (const LibraryTrack& track : library) playlist.insert(track);
+    result.buildMilliseconds = millisecondsSince(started);
+
+    std::vector<Playlist::TrackId> results;
+    std::vector<double> latencies;
+    size_t totalMatches = 0;
+    for (const std::wstring& query : syntheticQueries(library, queries)) {
+        for (size_t typed = 1; typed <= query.size(); typed++) {
+            auto keystroke = std::chrono::steady_clock::now();
+            totalMatches += playlist.search(std::wstring_view(query).substr(0, typed), RESULT_LIMIT, results);
+            latencies.push_back(millisecondsSince(keystroke) * 1000.0);
+        }
+    }
+
+    result.keystrokes = latencies.size();
+    if (!latencies.empty()) {
+        result.averageMatches = static_cast<double>(totalMatches) / latencies.size();
+        result.maxMicroseconds = *std::max_element(latencies.begin(), latencies.end());
+    }
+    result.p50Microseconds = percentile(latencies, 0.50);
+    result.p99Microseconds = percentile(latencies, 0.99);
+    return result;
+}
+
+void SearchBenchmark::printResult(const Result& result, std::ostream& out) {
+    out << "{\"tracks\":" << result.tracks
+        << ",\"build_ms\":" << result.buildMilliseconds
+        << ",\"keystrokes\":" << result.keystrokes
+        << ",\"query_p50_us\":" << result.p50Microseconds
+        << ",\"query_p99_us\":" << result.p99Microseconds
+        << ",\"query_max_us\":" << result.maxMicroseconds
+        << ",\"average_matches\":" << result.averageMatches
+        << "}\n";
+}
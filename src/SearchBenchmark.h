@@ -0,0 +1,24 @@
+#pragma once
+#include "headers.hpp"
+#include "FilesystemModule.h"
+
+// `--bench-search` mode: indexes synthetic libraries of several sizes and replays typed
+// queries against them one keystroke at a time, the way the search box runs them. Prints
+// one JSON object per line with the index build time and the per-keystroke query latency.
+class SearchBenchmark {
+private:
+    struct Result {
+        size_t tracks = 0;
+        size_t keystrokes = 0;
+        double buildMilliseconds = 0.0;
+        double p50Microseconds = 0.0, p99Microseconds = 0.0, maxMicroseconds = 0.0;
+        double averageMatches = 0.0;
+    };
+
+    static std::vector<LibraryTrack> syntheticLibrary(size_t count);
+    static std::vector<std::wstring> syntheticQueries(const std::vector<LibraryTrack>& library, size_t count);
+    static Result measure(size_t count, size_t queries);
+    static void printResult(const Result& result, std::ostream& out);
+public:
+    static int runCommandLine(const std::vector<std::string>& arguments);
+};
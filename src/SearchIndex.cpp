@@ -0,0 +1,502 @@
+#include "SearchIndex.h"
+#include "CaseFold.h"
+
+namespace {
+    // Latin-1 letters 0xC0-0xFF without their accents; the multiplication and division signs
+    // break words like other punctuation.
+    constexpr wchar_t LATIN1_FOLDED[] = L"aaaaaaaceeeeiiiidnooooo ouuuuytsaaaaaaaceeeeiiiidnooooo ouuuuyty";
+    // Latin Extended-A/B (0x100-0x24F) and Latin Extended Additional (0x1E00-0x1EFF) letters
+    // without their accents; a dot keeps the letter as it is.
+    constexpr wchar_t LATIN_EXTENDED_FOLDED[] =
+        L"aaaaaaccccccccddddeeeeeeeeeegggggggghhhhiiiiiiii.i..jjkk.lllllll"
+        L"lllnnnnnn...oooooo..rrrrrrssssssssttttttuuuuuuuuuuuuwwyyyzzzzzzs"
+        L"b................ff.......l.....oo.............uu....zz........."
+        L".............aaiioouuuuuuuuuu.aaaa..ggggkkoooo..j...gg..nnaa...."
+        L"aaaaeeeeiiiioooorrrruuuusstt..hh......aaeeooooooooyy.........l.."
+        L"...b..eejj..rryy";
+    constexpr wchar_t LATIN_ADDITIONAL_FOLDED[] =
+        L"aabbbbbbccddddddddddeeeeeeeeeeffgghhhhhhhhhhiiiikkkkkkllllllllmm"
+        L"mmmmnnnnnnnnoooooooopppprrrrrrrrssssssssssttttttttuuuuuuuuuuvvvv"
+        L"wwwwwwwwwwxxxxyyzzzzzzhtwy.s....aaaaaaaaaaaaaaaaaaaaaaaaeeeeeeee"
+        L"eeeeeeeeiiiioooooooooooooooooooooooouuuuuuuuuuuuuuyyyyyyyy......";
+    // Greek vowels with tonos or dialytika, after case folding, and their plain forms.
+    constexpr std::array<std::pair<wchar_t, wchar_t>, 11> GREEK_FOLDED = { {
+        { 0x390, 0x3B9 }, { 0x3AC, 0x3B1 }, { 0x3AD, 0x3B5 }, { 0x3AE, 0x3B7 }, { 0x3AF, 0x3B9 }, { 0x3B0, 0x3C5 },
+        { 0x3CA, 0x3B9 }, { 0x3CB, 0x3C5 }, { 0x3CC, 0x3BF }, { 0x3CD, 0x3C5 }, { 0x3CE, 0x3C9 }
+    } };
+    constexpr std::array<int, 4> FIELD_BONUS = { 200, 150, 100, 0 };
+
+    const std::array<std::vector<uint32_t>, 4> NO_POSTINGS;
+
+    wchar_t withoutAccent(wchar_t c) {
+        wchar_t plain = L'.';
+        if (c >= 0x100 && c <= 0x24F) plain = LATIN_EXTENDED_FOLDED[c - 0x100];
+        else if (c >= 0x1E00 && c <= 0x1EFF) plain = LATIN_ADDITIONAL_FOLDED[c - 0x1E00];
+        else if (c >= 0x390 && c <= 0x3CE) {
+            auto found = std::find_if(GREEK_FOLDED.begin(), GREEK_FOLDED.end(), [c](const auto& entry) { return entry.first == c; });
+            if (found != GREEK_FOLDED.end()) plain = found->second;
+        }
+        return plain == L'.' ? c : plain;
+    }
+
+    // General punctuation (dashes, curly quotes, typographic spaces) and CJK punctuation.
+    bool isPunctuation(wchar_t c) {
+        return (c >= 0x2000 && c <= 0x206F) || (c >= 0x3000 && c <= 0x3003) || (c >= 0x3008 && c <= 0x3011);
+    }
+
+    wchar_t foldCharacter(wchar_t c) {
+        if ((c >= L'a' && c <= L'z') || (c >= L'0' && c <= L'9')) return c;
+        if (c >= L'A' && c <= L'Z') return c + (L'a' - L'A');
+        if (c >= 0xC0 && c <= 0xFF) return LATIN1_FOLDED[c - 0xC0];
+        if (c < 0xC0 || isPunctuation(c)) return L' ';
+        return withoutAccent(CaseFold::simple(c));
+    }
+
+    // A space stands for the start of a word and a zero for "no character".
+    uint64_t gram(wchar_t first, wchar_t second, wchar_t third) {
+        auto bits = [](wchar_t c) { return static_cast<uint64_t>(static_cast<uint32_t>(c) & 0x1FFFFF); };
+        return (bits(first) << 42) | (bits(second) << 21) | bits(third);
+    }
+
+    uint64_t wordStartGram(std::wstring_view word) {
+        return word.size() == 1 ? gram(L' ', word[0], 0) : gram(L' ', word[0], word[1]);
+    }
+
+    // Every word starting with two given letters also starts with the first of them.
+    uint64_t impliedGram(uint64_t wordStart) {
+        return (wordStart >> 42) == L' ' ? wordStart & ~uint64_t(0x1FFFFF) : wordStart;
+    }
+
+    // Normalized text is a space before every word; calls f for each word without its space.
+    template <typename Callback>
+    void forEachWord(std::wstring_view text, Callback f) {
+        size_t start = 0;
+        while (start < text.size()) {
+            size_t end = text.find(L' ', start + 1);
+            if (end == std::wstring_view::npos) end = text.size();
+            f(text.substr(start + 1, end - start - 1));
+            start = end;
+        }
+    }
+}
+
+void SearchIndex::appendNormalized(std::wstring_view text, std::wstring& out) {
+    bool wordBreak = true;
+    for (wchar_t c : text) {
+        wchar_t folded = foldCharacter(c);
+        if (folded == L' ') {
+            wordBreak = true;
+            continue;
+        }
+
+        if (wordBreak) out.push_back(L' ');
+        wordBreak = false;
+        out.push_back(folded);
+    }
+}
+
+void SearchIndex::collectKeyGrams(std::wstring_view text, uint32_t field, std::vector<std::pair<uint64_t, uint32_t>>& out) {
+    forEachWord(text, [&](std::wstring_view word) {
+        out.emplace_back(gram(L' ', word[0], 0), field);
+        if (word.size() >= 2) out.emplace_back(gram(L' ', word[0], word[1]), field);
+        for (size_t i = 0; i + 3 <= word.size(); i++) out.emplace_back(gram(word[i], word[i + 1], word[i + 2]), field);
+    });
+}
+
+void SearchIndex::addField(std::wstring_view text, Field field, uint32_t& keyLength) {
+    key.clear();
+    appendNormalized(text, key);
+    collectKeyGrams(key, field, keyGrams);
+    keyLength += static_cast<uint32_t>(key.size());
+}
+
+void SearchIndex::add(TrackId track, std::wstring_view title, std::wstring_view artist, std::wstring_view album, const std::filesystem::path& pathToSong) {
+    remove(track);
+
+    Document document;
+    document.track = track;
+    document.live = true;
+
+    keyGrams.clear();
+    addField(title, TITLE, document.keyLength);
+    addField(artist, ARTIST, document.keyLength);
+    addField(album, ALBUM, document.keyLength);
+    addField(pathToSong.parent_path().filename().wstring(), PATH, document.keyLength);
+    addField(pathToSong.stem().wstring(), PATH, document.keyLength);
+
+    // Sorting by gram, then field, leaves each gram's earliest field first.
+    std::sort(keyGrams.begin(), keyGrams.end());
+    keyGrams.erase(std::unique(keyGrams.begin(), keyGrams.end(), [](const auto& left, const auto& right) { return left.first == right.first; }), keyGrams.end());
+
+    uint32_t id = static_cast<uint32_t>(documents.size());
+    for (const auto& [keyGram, field] : keyGrams) postings[keyGram][field].push_back(id);
+    documents.push_back(document);
+    candidateState.push_back({ 0, 0, UINT32_MAX - document.keyLength });
+    candidateBits.resize(documents.size() / 64 + 1);
+    previousValid = false;
+
+    if (documentOfTrack.size() <= track) documentOfTrack.resize(track + 1, NO_DOCUMENT);
+    documentOfTrack[track] = id;
+}
+
+void SearchIndex::remove(TrackId track) {
+    if (track >= documentOfTrack.size() || documentOfTrack[track] == NO_DOCUMENT) return;
+
+    documents[documentOfTrack[track]].live = false;
+    candidateState[documentOfTrack[track]].keyRank = 0;
+    documentOfTrack[track] = NO_DOCUMENT;
+    deadDocuments++;
+    previousValid = false;
+
+    if (deadDocuments > 1024 && deadDocuments * 2 > documents.size()) compact();
+}
+
+void SearchIndex::clear() {
+    documents.clear();
+    postings.clear();
+    documentOfTrack.clear();
+    candidateState.clear();
+    candidateBits.clear();
+    deadDocuments = 0;
+    previousValid = false;
+}
+
+// Renumbers the live documents in order, which keeps every posting list sorted.
+void SearchIndex::compact() {
+    std::vector<uint32_t> renumbered(documents.size(), NO_DOCUMENT);
+    std::vector<Document> liveDocuments;
+    liveDocuments.reserve(documents.size() - deadDocuments);
+    candidateState.clear();
+
+    for (uint32_t id = 0; id < documents.size(); id++) {
+        if (!documents[id].live) continue;
+
+        renumbered[id] = static_cast<uint32_t>(liveDocuments.size());
+        documentOfTrack[documents[id].track] = renumbered[id];
+        liveDocuments.push_back(documents[id]);
+        candidateState.push_back({ 0, 0, UINT32_MAX - documents[id].keyLength });
+    }
+
+    for (auto posting = postings.begin(); posting != postings.end();) {
+        size_t entries = 0;
+        for (std::vector<uint32_t>& list : posting->second) {
+            size_t kept = 0;
+            for (uint32_t id : list) {
+                if (renumbered[id] != NO_DOCUMENT) list[kept++] = renumbered[id];
+            }
+            list.resize(kept);
+            entries += kept;
+        }
+
+        if (entries == 0) posting = postings.erase(posting);
+        else ++posting;
+    }
+
+    documents.swap(liveDocuments);
+    candidateBits.assign(documents.size() / 64 + 1, 0);
+    deadDocuments = 0;
+}
+
+int SearchIndex::queryGramIndex(uint64_t queryGram, bool counted) {
+    for (size_t i = 0; i < queryGrams.size(); i++) {
+        if (queryGrams[i].gram != queryGram) continue;
+        queryGrams[i].counted |= counted;
+        return static_cast<int>(i);
+    }
+
+    if (queryGrams.size() == MAX_QUERY_GRAMS) return -1;
+    queryGrams.push_back({ queryGram, &NO_POSTINGS, 0, static_cast<uint8_t>(queryGrams.size()), counted, 0 });
+    return static_cast<int>(queryGrams.size() - 1);
+}
+
+// One- and two-character terms are a single word-start gram. Longer terms are their inner
+// trigrams, which match anywhere, plus their word start as a bonus gram. Bonus grams are
+// added last so they never push a counted gram past the limit.
+void SearchIndex::collectQueryGrams() {
+    queryGrams.clear();
+    queryTerms.assign(terms.size(), QueryTerm());
+
+    for (size_t t = 0; t < terms.size(); t++) {
+        std::wstring_view term = terms[t];
+        QueryTerm& queryTerm = queryTerms[t];
+
+        if (term.size() <= 2) {
+            int index = queryGramIndex(wordStartGram(term), true);
+            if (index < 0) continue;
+            queryTerm.gramMask = uint64_t(1) << index;
+            queryTerm.startGram = index;
+            queryGrams[index].fieldWeight++;
+            continue;
+        }
+
+        for (size_t i = 0; i + 3 <= term.size(); i++) {
+            int index = queryGramIndex(gram(term[i], term[i + 1], term[i + 2]), true);
+            if (index < 0) break;
+            if (i == 0) queryGrams[index].fieldWeight++;
+            queryTerm.gramMask |= uint64_t(1) << index;
+        }
+    }
+
+    for (size_t t = 0; t < terms.size(); t++) {
+        if (terms[t].size() > 2 && queryTerms[t].gramMask != 0) queryTerms[t].startGram = queryGramIndex(wordStartGram(terms[t]), false);
+    }
+}
+
+bool SearchIndex::isCandidate(uint32_t id) const {
+    return (candidateBits[id / 64] >> (id % 64)) & 1;
+}
+
+void SearchIndex::addCandidate(uint32_t id) {
+    candidateBits[id / 64] |= uint64_t(1) << (id % 64);
+    candidates.push_back(id);
+}
+
+void SearchIndex::visit(uint32_t id, uint32_t field, const QueryGram& queryGram) {
+    Candidate& candidate = candidateState[id];
+    candidate.gramMask |= uint64_t(1) << queryGram.bit;
+    candidate.fieldBonus += FIELD_BONUS[field] * queryGram.fieldWeight;
+}
+
+// Broad grams fill the candidates from the title lists of the seed grams first, then artist,
+// album and path, sharing MAX_CANDIDATES tracks between the grams, so the tracks left out are
+// the ones that would rank lowest. The candidates are then put in document order and the
+// seed list entries past the cap only probed, like the other lists.
+void SearchIndex::seedCandidates(size_t seedLists) {
+    seeded.assign(seedLists * 4, 0);
+    for (uint32_t field = TITLE; field <= PATH; field++) {
+        for (size_t i = 0; i < seedLists; i++) {
+            size_t later = 0;
+            for (size_t j = i + 1; j < seedLists; j++) later += (*queryGrams[j].postings)[field].size();
+
+            size_t left = MAX_CANDIDATES - candidates.size();
+            size_t room = std::max(left / (seedLists - i), left - std::min(left, later));
+            const std::vector<uint32_t>& list = (*queryGrams[i].postings)[field];
+            size_t& taken = seeded[i * 4 + field];
+            for (; taken < list.size(); taken++) {
+                uint32_t id = list[taken];
+                if (!isCandidate(id)) {
+                    if (room == 0) break;
+                    room--;
+                    addCandidate(id);
+                }
+                visit(id, field, queryGrams[i]);
+            }
+        }
+    }
+
+    candidates.clear();
+    for (size_t word = 0; word < candidateBits.size(); word++) {
+        for (uint64_t bits = candidateBits[word]; bits != 0; bits &= bits - 1) candidates.push_back(static_cast<uint32_t>(word * 64 + std::countr_zero(bits)));
+    }
+
+    for (size_t i = 0; i < seedLists; i++) {
+        for (uint32_t field = TITLE; field <= PATH; field++) {
+            const std::vector<uint32_t>& list = (*queryGrams[i].postings)[field];
+            if (seeded[i * 4 + field] == list.size()) continue;
+
+            capped = true;
+            walkList(list.data() + seeded[i * 4 + field], list.data() + list.size(), field, queryGrams[i]);
+        }
+    }
+}
+
+// Probes a sorted run of postings for the candidates: a scan when the candidates are dense in
+// it, otherwise a galloping search from one candidate to the next.
+void SearchIndex::walkList(const uint32_t* begin, const uint32_t* end, uint32_t field, const QueryGram& queryGram) {
+    size_t length = static_cast<size_t>(end - begin);
+    if (candidates.empty() || length == 0) return;
+
+    if (candidates.size() * std::bit_width(length / candidates.size() + 1) >= length) {
+        for (const uint32_t* entry = begin; entry != end; entry++) {
+            if (isCandidate(*entry)) visit(*entry, field, queryGram);
+        }
+        return;
+    }
+
+    const uint32_t* at = begin;
+    for (uint32_t id : candidates) {
+        const uint32_t* bound = at;
+        for (size_t step = 1; bound != end && *bound < id; step *= 2) {
+            at = bound + 1;
+            bound = static_cast<size_t>(end - bound) > step ? bound + step : end;
+        }
+        at = std::lower_bound(at, bound, id);
+        if (at == end) return;
+        if (*at == id) visit(id, field, queryGram);
+    }
+}
+
+// Every track the query matches also matched the previous query when each previous gram is
+// one of the query's grams or implied by one, and the query's grams that cover no previous
+// gram, or cover one a second time, are no more than the extra grams it requires.
+bool SearchIndex::narrowsPrevious(uint64_t countedMask, int required) {
+    currentGrams.clear();
+    for (const QueryGram& queryGram : queryGrams) {
+        if ((countedMask >> queryGram.bit) & 1) currentGrams.push_back(queryGram.gram);
+    }
+    if (!previousValid) return false;
+
+    auto covers = [](uint64_t current, uint64_t previous) { return current == previous || impliedGram(current) == previous; };
+    int spare = required - previousRequired;
+    for (uint64_t current : currentGrams) {
+        if (std::none_of(previousGrams.begin(), previousGrams.end(), [&](uint64_t previous) { return covers(current, previous); })) spare--;
+    }
+    for (uint64_t previous : previousGrams) {
+        int covering = static_cast<int>(std::count_if(currentGrams.begin(), currentGrams.end(), [&](uint64_t current) { return covers(current, previous); }));
+        if (covering == 0) return false;
+        spare -= covering - 1;
+    }
+    return spare >= 0;
+}
+
+size_t SearchIndex::search(std::wstring_view text, size_t limit, std::vector<TrackId>& results) {
+    results.clear();
+    query.clear();
+    appendNormalized(text, query);
+
+    terms.clear();
+    forEachWord(query, [&](std::wstring_view term) { terms.push_back(term); });
+    collectQueryGrams();
+
+    uint64_t countedMask = 0, allMask = 0;
+    for (QueryGram& queryGram : queryGrams) {
+        auto found = postings.find(queryGram.gram);
+        if (found != postings.end()) {
+            queryGram.postings = &found->second;
+            for (const std::vector<uint32_t>& list : found->second) queryGram.entries += list.size();
+        }
+        if (queryGram.counted) countedMask |= uint64_t(1) << queryGram.bit;
+        allMask |= uint64_t(1) << queryGram.bit;
+    }
+    if (countedMask == 0) {
+        previousValid = false;
+        return 0;
+    }
+
+    // A swapped or mistyped letter in the middle of a word breaks up to four of its trigrams,
+    // so when nothing holds two thirds of the grams, half will do, word starts included.
+    int gramCount = std::popcount(countedMask), required = gramCount - gramCount / 3;
+    int looseRequired = (std::popcount(allMask) + 1) / 2;
+    findMatches(countedMask, required, limit, narrowsPrevious(countedMask, required));
+
+    previousValid = !capped;
+    if (matchCount == 0 && (allMask != countedMask || looseRequired < required)) {
+        findMatches(allMask, looseRequired, limit, false);
+        previousValid = false;
+    }
+    if (previousValid) {
+        previousGrams.swap(currentGrams);
+        previousMatches.swap(currentMatches);
+        previousRequired = required;
+    }
+
+    std::sort(matches.begin(), matches.end(), better);
+    for (const Match& match : matches) results.push_back(documents[match.document].track);
+    return matchCount;
+}
+
+void SearchIndex::findMatches(uint64_t countedMask, int required, size_t limit, bool narrow) {
+    auto counted = [countedMask](const QueryGram& queryGram) { return ((countedMask >> queryGram.bit) & 1) != 0; };
+    std::sort(queryGrams.begin(), queryGrams.end(), [&](const QueryGram& left, const QueryGram& right) {
+        if (counted(left) != counted(right)) return counted(left);
+        return left.entries < right.entries;
+    });
+
+    // A match holds at least `required` grams, so it is in at least one of the shortest
+    // gramCount - required + 1 counted lists. Those seed the candidates, unless the previous
+    // query's matches are fewer; the other lists are only probed, by binary search when that
+    // touches fewer entries than a scan.
+    int gramCount = std::popcount(countedMask);
+    size_t seedLists = static_cast<size_t>(gramCount - required + 1), seedEntries = 0;
+    for (size_t i = 0; i < seedLists; i++) seedEntries += queryGrams[i].entries;
+
+    candidates.clear();
+    capped = false;
+    if (narrow && previousMatches.size() < seedEntries) {
+        for (uint32_t id : previousMatches) addCandidate(id);
+        seedLists = 0;
+    }
+    else seedCandidates(seedLists);
+    // Each counted list probed leaves one fewer chance for a candidate to reach `required`, so
+    // the ones that no longer can are dropped before the next list.
+    int unprobed = gramCount - static_cast<int>(seedLists);
+    for (size_t i = seedLists; i < queryGrams.size(); i++) {
+        if (counted(queryGrams[i])) pruneCandidates(countedMask, required - unprobed--);
+        for (uint32_t field = TITLE; field <= PATH; field++) {
+            const std::vector<uint32_t>& list = (*queryGrams[i].postings)[field];
+            walkList(list.data(), list.data() + list.size(), field, queryGrams[i]);
+        }
+    }
+
+    // Only the best `limit` matches are kept: once twice that many are held, the rest are cut
+    // and anything ranked below the last one kept is skipped.
+    matches.clear();
+    currentMatches.clear();
+    matchCount = 0;
+    uint64_t threshold = 0;
+    for (uint32_t id : candidates) {
+        Candidate& candidate = candidateState[id];
+        int gramHits = std::popcount(candidate.gramMask & countedMask);
+        if (gramHits >= required && candidate.keyRank != 0) {
+            matchCount++;
+            if (!capped) currentMatches.push_back(id);
+
+            uint64_t rank = (static_cast<uint64_t>(score(candidate, gramHits, gramCount)) << 32) | candidate.keyRank;
+            if (limit > 0 && rank >= threshold) {
+                matches.push_back({ rank, id });
+                if (matches.size() == limit * 2) {
+                    std::nth_element(matches.begin(), matches.begin() + (limit - 1), matches.end(), better);
+                    threshold = matches[limit - 1].rank;
+                    matches.resize(limit);
+                }
+            }
+        }
+        candidate.gramMask = 0;
+        candidate.fieldBonus = 0;
+        candidateBits[id / 64] = 0;
+    }
+
+    if (matches.size() > limit) {
+        std::nth_element(matches.begin(), matches.begin() + (limit - 1), matches.end(), better);
+        matches.resize(limit);
+    }
+}
+
+void SearchIndex::pruneCandidates(uint64_t countedMask, int minimumHits) {
+    if (minimumHits <= 0) return;
+
+    size_t kept = 0;
+    for (uint32_t id : candidates) {
+        Candidate& candidate = candidateState[id];
+        if (std::popcount(candidate.gramMask & countedMask) >= minimumHits) {
+            candidates[kept++] = id;
+            continue;
+        }
+        candidate.gramMask = 0;
+        candidate.fieldBonus = 0;
+        candidateBits[id / 64] &= ~(uint64_t(1) << (id % 64));
+    }
+    candidates.resize(kept);
+}
+
+// A term whose grams are all present counts as found, and as found at a word start when the
+// track also has a word beginning with its first letters.
+int SearchIndex::score(const Candidate& candidate, int gramHits, int gramCount) const {
+    uint64_t mask = candidate.gramMask;
+    int total = gramHits * 1000 / gramCount + static_cast<int>(candidate.fieldBonus);
+
+    for (const QueryTerm& term : queryTerms) {
+        if (term.gramMask == 0 || (mask & term.gramMask) != term.gramMask) continue;
+        total += 300;
+        if (term.startGram >= 0 && (mask >> term.startGram) & 1) total += 200;
+    }
+    return total;
+}
+
+bool SearchIndex::better(const Match& left, const Match& right) {
+    return left.rank != right.rank ? left.rank > right.rank : left.document < right.document;
+}
+
+size_t SearchIndex::size() const {
+    return documents.size() - deadDocuments;
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include "headers.hpp"
+
+// Trigram index over each track's title, artist, album, folder and file name, for
+// type-to-filter search. Text is case folded in every script, Latin and Greek letters lose
+// their accents, and punctuation breaks words. Every word contributes its inner trigrams plus
+// its first one and two characters, so one- and two-letter terms match word prefixes and
+// longer terms match anywhere. A track matches when it holds at least two thirds of the query's grams; when no
+// track does, half of them will do, counting word starts, so a mistyped or transposed letter
+// still finds the word.
+//
+// Ranking is computed from the posting lists alone, so a query never touches track text:
+// each gram keeps one list per field it first occurs in, and a match scores for gram
+// overlap, for every term whose grams are all present, for terms that also start a word,
+// and for the field each term was found in (title, then artist, then album).
+//
+// A query whose grams are broad ranks at most MAX_CANDIDATES tracks, taken from the title
+// lists first, then artist, album and path, and its match count is then a lower bound. When
+// a query extends the previous one and every track it can match provably matched the previous
+// one, those matches are the candidates instead of the posting lists.
+//
+// Documents are only ever appended and removals are tombstoned, so posting lists stay sorted
+// without moving entries; the lists are compacted once half of the documents are dead.
+class SearchIndex {
+public:
+    using TrackId = uint32_t;
+private:
+    enum Field { TITLE, ARTIST, ALBUM, PATH };
+
+    // A gram's documents, sorted, one list for each field the gram first occurs in.
+    using Postings = std::array<std::vector<uint32_t>, 4>;
+
+    struct Document {
+        TrackId track = 0;
+        uint32_t keyLength = 0;
+        bool live = false;
+    };
+
+    // A query gram and its posting list. Counted grams decide whether a track matches;
+    // the word-start grams of longer terms only add to the score.
+    struct QueryGram {
+        uint64_t gram;
+        const Postings* postings;
+        size_t entries;
+        uint8_t bit;
+        bool counted;
+        uint8_t fieldWeight;
+    };
+
+    // Per-document query state: which query grams the document holds and the field bonus
+    // of the terms it holds, next to the document's key length rank (zero once removed). Kept
+    // together so visiting a posting touches one cache line.
+    struct Candidate {
+        uint64_t gramMask = 0;
+        uint32_t fieldBonus = 0;
+        uint32_t keyRank = 0;
+    };
+
+    struct QueryTerm {
+        uint64_t gramMask = 0;
+        int startGram = -1;
+    };
+
+    // Score in the high half and shorter keys first in the low half, so ranking compares one
+    // integer instead of looking the documents up.
+    struct Match {
+        uint64_t rank;
+        uint32_t document;
+    };
+
+    static constexpr uint32_t NO_DOCUMENT = std::numeric_limits<uint32_t>::max();
+    static constexpr size_t MAX_QUERY_GRAMS = 64;
+    static constexpr size_t MAX_CANDIDATES = 2048;
+
+    std::vector<Document> documents;
+    std::unordered_map<uint64_t, Postings> postings;
+    std::vector<uint32_t> documentOfTrack;
+    size_t deadDocuments = 0;
+
+    // Scratch reused by every call, so typing does not allocate once the buffers are warm.
+    std::wstring key, query;
+    std::vector<std::pair<uint64_t, uint32_t>> keyGrams;
+    std::vector<std::wstring_view> terms;
+    std::vector<QueryGram> queryGrams;
+    std::vector<QueryTerm> queryTerms;
+    std::vector<Candidate> candidateState;
+    std::vector<uint64_t> candidateBits;
+    std::vector<uint32_t> candidates;
+    std::vector<size_t> seeded;
+    std::vector<Match> matches;
+    size_t matchCount = 0;
+    bool capped = false;
+
+    // The previous query's counted grams and every track it matched, kept while the index is
+    // unchanged and the matches were complete.
+    std::vector<uint64_t> previousGrams, currentGrams;
+    std::vector<uint32_t> previousMatches, currentMatches;
+    int previousRequired = 0;
+    bool previousValid = false;
+
+    static void appendNormalized(std::wstring_view text, std::wstring& out);
+    static void collectKeyGrams(std::wstring_view text, uint32_t field, std::vector<std::pair<uint64_t, uint32_t>>& out);
+    void addField(std::wstring_view text, Field field, uint32_t& keyLength);
+    void collectQueryGrams();
+    int queryGramIndex(uint64_t gram, bool counted);
+    bool narrowsPrevious(uint64_t countedMask, int required);
+    void seedCandidates(size_t seedLists);
+    bool isCandidate(uint32_t id) const;
+    void addCandidate(uint32_t id);
+    void visit(uint32_t id, uint32_t field, const QueryGram& queryGram);
+    void walkList(const uint32_t* begin, const uint32_t* end, uint32_t field, const QueryGram& queryGram);
+    void pruneCandidates(uint64_t countedMask, int minimumHits);
+    void findMatches(uint64_t countedMask, int required, size_t limit, bool narrow);
+    int score(const Candidate& candidate, int gramHits, int gramCount) const;
+    static bool better(const Match& left, const Match& right);
+    void compact();
+public:
+    void add(TrackId track, std::wstring_view title, std::wstring_view artist, std::wstring_view album, const std::filesystem::path& pathToSong);
+    void remove(TrackId track);
+    void clear();
+
+    // Fills results with at most limit tracks, best match first, and returns how many matched,
+    // or how many of the ranked candidates did when the query was too broad to rank them all.
+    size_t search(std::wstring_view text, size_t limit, std::vector<TrackId>& results);
+    size_t size() const;
+};
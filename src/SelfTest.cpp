@@ -0,0 +1,1139 @@
+#include "SelfTest.h"
+#include "SoundModule.hpp"
+#include "CircularBuffer.h"
+#include "FilesystemModule.h"
+#include "Id3Reader.h"
+#include "PlayQueue.h"
+#include "Playlist.h"
+#include "Mp3Decoder.h"
+
+namespace {
+    constexpr int SAMPLE_RATE = 44100, CHANNELS = 2;
+
+    // A directory of generated input files that is removed again when the check ends.
+    class ScratchDirectory {
+    private:
+        std::filesystem::path path;
+    public:
+        ScratchDirectory() {
+            path = std::filesystem::temp_directory_path() / ("clp-self-test-" + std::to_string(std::random_device{}()));
+            std::filesystem::create_directories(path);
+        }
+
+        ~ScratchDirectory() {
+            std::error_code error;
+            std::filesystem::remove_all(path, error);
+        }
+
+        std::filesystem::path operator/(const std::string& name) const {
+            return path / name;
+        }
+    };
+
+    // Writes a 16-bit stereo WAV file whose samples come from sample(frame, channel).
+    void writeWav(const std::filesystem::path& path, size_t frames, const std::function<int16_t(size_t, int)>& sample) {
+        std::vector<uint8_t> bytes(44 + frames * CHANNELS * sizeof(int16_t));
+        auto put = [&](size_t offset, uint32_t value, int count) {
+            for (int i = 0; i < count; i++) bytes[offset + i] = static_cast<uint8_t>(value >> (8 * i));
+        };
+
+        uint32_t blockAlign = CHANNELS * sizeof(int16_t);
+        uint32_t dataSize = static_cast<uint32_t>(frames * blockAlign);
+        std::memcpy(bytes.data(), "RIFF", 4);
+        put(4, 36 + dataSize, 4);
+        std::memcpy(bytes.data() + 8, "WAVEfmt ", 8);
+        put(16, 16, 4);
+        put(20, 1, 2);
+        put(22, CHANNELS, 2);
+        put(24, SAMPLE_RATE, 4);
+        put(28, SAMPLE_RATE * blockAlign, 4);
+        put(32, blockAlign, 2);
+        put(34, 16, 2);
+        std::memcpy(bytes.data() + 36, "data", 4);
+        put(40, dataSize, 4);
+
+        for (size_t frame = 0; frame < frames; frame++) {
+            for (int channel = 0; channel < CHANNELS; channel++) {
+                put(44 + (frame * CHANNELS + channel) * sizeof(int16_t), static_cast<uint16_t>(sample(frame, channel)), 2);
+            }
+        }
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    }
+
+    // A realtime null sink that keeps everything it plays, remembers when each period was
+    // rendered and counts the samples the engine could not supply while playing.
+    class CaptureSink : public NullAudioSink {
+    private:
+        struct Period {
+            size_t end;
+            std::chrono::steady_clock::time_point rendered;
+        };
+
+        mutable std::mutex capturedMutex;
+        std::vector<int16_t> captured;
+        std::vector<Period> periods;
+        std::atomic<size_t> missing = 0;
+    protected:
+        void consume(const int16_t* samples, size_t count) override {
+            std::lock_guard<std::mutex> lock(capturedMutex);
+            captured.insert(captured.end(), samples, samples + count);
+            periods.push_back({ captured.size(), std::chrono::steady_clock::now() });
+        }
+    public:
+        bool open(const AudioFormat& requested, RenderFunction render) override {
+            return NullAudioSink::open(requested, [this, render](int16_t* output, size_t samples) {
+                size_t rendered = render(output, samples);
+                missing += samples - rendered;
+                return rendered;
+            });
+        }
+
+        std::vector<int16_t> capture() const {
+            std::lock_guard<std::mutex> lock(capturedMutex);
+            return captured;
+        }
+
+        size_t capturedSamples() const {
+            std::lock_guard<std::mutex> lock(capturedMutex);
+            return captured.size();
+        }
+
+        size_t missingSamples() const {
+            return missing.load();
+        }
+
+        // When the captured frame becomes audible: the last frame of each period is heard one
+        // reported latency after that period was rendered.
+        std::chrono::steady_clock::time_point audibleAt(size_t frame) const {
+            std::lock_guard<std::mutex> lock(capturedMutex);
+            size_t sample = frame * CHANNELS;
+            auto period = std::upper_bound(periods.begin(), periods.end(), sample, [](size_t value, const Period& candidate) {
+                return value < candidate.end;
+            });
+            if (period == periods.end()) return std::chrono::steady_clock::time_point::max();
+
+            AudioFormat format = getFormat();
+            double framesAhead = static_cast<double>(period->end - sample) / CHANNELS - 1.0;
+            double delaySeconds = (format.latencyFrames - framesAhead) / format.frequency;
+            return period->rendered + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(delaySeconds));
+        }
+    };
+
+    // Serves a byte vector the way MappedInputSource serves a file.
+    class MemoryInputSource : public InputSource {
+    private:
+        const std::vector<uint8_t>& bytes;
+        uint64_t offset = 0;
+    public:
+        explicit MemoryInputSource(const std::vector<uint8_t>& bytes) : bytes(bytes) {}
+
+        bool open(const std::filesystem::path&) override { return false; }
+        void close() override {}
+
+        size_t fill(size_t) override { return available(); }
+        const uint8_t* data() const override { return bytes.data() + offset; }
+        size_t available() const override { return static_cast<size_t>(bytes.size() - offset); }
+        void consume(size_t count) override { offset = std::min<uint64_t>(offset + count, bytes.size()); }
+
+        bool seek(uint64_t newOffset) override {
+            if (newOffset > bytes.size()) return false;
+            offset = newOffset;
+            return true;
+        }
+
+        uint64_t position() const override { return offset; }
+        uint64_t size() const override { return bytes.size(); }
+    };
+
+    // Builds ID3v2 tags frame by frame. Version 4 tags get an extended header and sync-safe
+    // frame sizes; unsynchronised frames get 0x00 stuffed after every 0xFF.
+    class TagBuilder {
+    private:
+        int version;
+        std::vector<uint8_t> frames;
+
+        static void putSize(std::vector<uint8_t>& out, uint32_t size, int bytes, bool syncsafe) {
+            for (int i = bytes - 1; i >= 0; i--) out.push_back(static_cast<uint8_t>(syncsafe ? (size >> (7 * i)) & 0x7F : size >> (8 * i)));
+        }
+    public:
+        explicit TagBuilder(int version) : version(version) {}
+
+        TagBuilder& frame(const std::string& id, std::vector<uint8_t> payload, bool unsynchronised = false) {
+            if (unsynchronised) {
+                std::vector<uint8_t> stuffed;
+                for (uint8_t byte : payload) {
+                    stuffed.push_back(byte);
+                    if (byte == 0xFF) stuffed.push_back(0x00);
+                }
+                payload.swap(stuffed);
+            }
+
+            frames.insert(frames.end(), id.begin(), id.end());
+            putSize(frames, static_cast<uint32_t>(payload.size()), version == 2 ? 3 : 4, version == 4);
+            if (version > 2) {
+                frames.push_back(0);
+                frames.push_back(unsynchronised ? 0x02 : 0x00);
+            }
+            frames.insert(frames.end(), payload.begin(), payload.end());
+            return *this;
+        }
+
+        TagBuilder& text(const std::string& id, const std::string& value) {
+            std::vector<uint8_t> payload = { 0 };
+            payload.insert(payload.end(), value.begin(), value.end());
+            return frame(id, payload);
+        }
+
+        // Tag followed by a few bytes of frame syncs standing in for the audio.
+        std::vector<uint8_t> build() const {
+            std::vector<uint8_t> body;
+            if (version == 4) body = { 0, 0, 0, 6, 1, 0 };
+            body.insert(body.end(), frames.begin(), frames.end());
+            body.resize(body.size() + 64, 0);
+
+            std::vector<uint8_t> tag = { 'I', 'D', '3', static_cast<uint8_t>(version), 0, static_cast<uint8_t>(version == 4 ? 0x40 : 0) };
+            putSize(tag, static_cast<uint32_t>(body.size()), 4, true);
+            tag.insert(tag.end(), body.begin(), body.end());
+            for (int i = 0; i < 256; i++) tag.push_back((i % 2 == 0) ? 0xFF : 0xFB);
+            return tag;
+        }
+    };
+
+    enum class Mp3Tag { None, Info, Vbri };
+
+    // MPEG-1 Layer III at 128 kbps, 44.1 kHz, joint stereo: 417-byte frames of 1152 samples.
+    constexpr size_t MP3_FRAME_BYTES = 417, MP3_FRAME_SAMPLES = 1152, MP3_TAG_OFFSET = 4 + 32;
+    constexpr uint32_t MP3_DELAY = 1105, MP3_PADDING = 700;
+
+    // Frames whose side info and main data are random, so the audio is noise that leans on
+    // the bit reservoir, led by an Info tag with LAME delay and padding, a VBRI tag
+    // with a delay, or nothing. A decoder must still reproduce it bit for bit.
+    std::vector<uint8_t> syntheticMp3(size_t frames, Mp3Tag tag) {
+        std::vector<uint8_t> file;
+        auto appendFrame = [&file] {
+            size_t start = file.size();
+            file.resize(start + MP3_FRAME_BYTES, 0);
+            file[start] = 0xFF;
+            file[start + 1] = 0xFB;
+            file[start + 2] = 0x90;
+            file[start + 3] = 0x40;
+            return start;
+        };
+        auto putBigEndian = [&file](size_t offset, uint32_t value, int bytes) {
+            for (int i = 0; i < bytes; i++) file[offset + i] = static_cast<uint8_t>(value >> (8 * (bytes - 1 - i)));
+        };
+
+        if (tag != Mp3Tag::None) {
+            size_t tagStart = appendFrame() + MP3_TAG_OFFSET;
+            if (tag == Mp3Tag::Info) {
+                std::memcpy(&file[tagStart], "Info", 4);
+                putBigEndian(tagStart + 4, 1, 4);
+                putBigEndian(tagStart + 8, static_cast<uint32_t>(frames), 4);
+                std::memcpy(&file[tagStart + 12], "LAME3.100", 9);
+
+                // The LAME header stores both values less the decoder's own 529-sample delay.
+                uint32_t delay = MP3_DELAY - 529, padding = MP3_PADDING + 529;
+                putBigEndian(tagStart + 12 + 21, (delay << 12) | padding, 3);
+            }
+            else {
+                std::memcpy(&file[tagStart], "VBRI", 4);
+                putBigEndian(tagStart + 4, 1, 2);
+                putBigEndian(tagStart + 6, MP3_DELAY, 2);
+                putBigEndian(tagStart + 14, static_cast<uint32_t>(frames), 4);
+            }
+        }
+
+        // Valid side info with random fields. The four granules take at most 70% of a frame's
+        // main data, and main_data_begin reaches back up to 300 bytes into what earlier frames
+        // left unused, as an encoder's bit reservoir would.
+        std::mt19937 random(static_cast<uint32_t>(tag) + 17);
+        auto between = [&random](uint32_t low, uint32_t high) { return std::uniform_int_distribution<uint32_t>(low, high)(random); };
+        constexpr uint32_t MAIN_DATA_BITS = (MP3_FRAME_BYTES - MP3_TAG_OFFSET) * 8;
+
+        uint32_t reservoir = 0;
+        for (size_t frame = 0; frame < frames; frame++) {
+            size_t start = appendFrame();
+            size_t bit = (start + 4) * 8;
+            auto putBits = [&](uint32_t value, int count) {
+                for (int i = count - 1; i >= 0; i--, bit++) {
+                    if ((value >> i) & 1) file[bit / 8] |= static_cast<uint8_t>(0x80 >> (bit % 8));
+                }
+            };
+
+            uint32_t mainDataBegin = between(0, std::min<uint32_t>(reservoir, 300));
+            uint32_t granuleBits[4], usedBits = 0;
+            for (uint32_t& bits : granuleBits) usedBits += bits = between(0, MAIN_DATA_BITS * 7 / 40);
+            reservoir = mainDataBegin + MAIN_DATA_BITS / 8 - (usedBits + 7) / 8;
+
+            putBits(mainDataBegin, 9);
+            putBits(0, 3);
+            putBits(between(0, 255), 8);
+            for (int granule = 0; granule < 4; granule++) {
+                putBits(granuleBits[granule], 12);
+                putBits(between(0, 288), 9);
+                putBits(between(140, 170), 8);
+                putBits(between(0, 15), 4);
+                putBits(0, 1);
+                for (int region = 0; region < 3; region++) {
+                    uint32_t table = between(0, 29);
+                    putBits(table + (table >= 4) + (table >= 13), 5);
+                }
+                putBits(between(0, 15), 4);
+                putBits(between(0, 7), 3);
+                putBits(between(0, 7), 3);
+            }
+            for (size_t i = MP3_TAG_OFFSET; i < MP3_FRAME_BYTES; i++) file[start + i] = static_cast<uint8_t>(random());
+        }
+        return file;
+    }
+
+    // Every frame from the given offset through the plain mp3dec_decode_frame API, with nothing
+    // trimmed.
+    std::vector<int16_t> referenceMp3Decode(const std::vector<uint8_t>& bytes, size_t offset) {
+        mp3dec_t decoder;
+        mp3dec_init(&decoder);
+        std::vector<int16_t> samples;
+        mp3d_sample_t pcm[MINIMP3_MAX_SAMPLES_PER_FRAME];
+
+        while (offset < bytes.size()) {
+            mp3dec_frame_info_t info = {};
+            int frameSamples = mp3dec_decode_frame(&decoder, bytes.data() + offset, static_cast<int>(bytes.size() - offset), pcm, &info);
+            if (info.frame_bytes == 0) break;
+
+            offset += info.frame_bytes;
+            samples.insert(samples.end(), pcm, pcm + static_cast<size_t>(frameSamples) * info.channels);
+        }
+        return samples;
+    }
+
+    bool waitUntil(const std::function<bool()>& condition, std::chrono::milliseconds timeout) {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (!condition()) {
+            if (std::chrono::steady_clock::now() > deadline) return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+
+    double seconds(std::chrono::nanoseconds duration) {
+        return std::chrono::duration<double>(duration).count();
+    }
+
+    // Spreads a frame number over both channels, so any captured frame says where it came from.
+    int16_t frameNumberSample(size_t frame, int channel) {
+        return static_cast<int16_t>(channel == 0 ? frame & 0x7FFF : frame >> 15);
+    }
+
+    size_t frameNumberAt(const std::vector<int16_t>& samples, size_t frame) {
+        return static_cast<size_t>(samples[frame * CHANNELS]) | static_cast<size_t>(samples[frame * CHANNELS + 1]) << 15;
+    }
+}
+
+SelfTest::Report::Report(std::string check) : check(std::move(check)) {}
+
+void SelfTest::Report::record(const std::string& key, double value) {
+    measurements.emplace_back(key, value);
+}
+
+void SelfTest::Report::expect(bool condition, const std::string& failure) {
+    if (!condition) failures.push_back(failure);
+}
+
+bool SelfTest::Report::passed() const {
+    return failures.empty();
+}
+
+void SelfTest::Report::print(std::ostream& out) const {
+    std::streamsize precision = out.precision(9);
+    out << "{\"check\":\"" << check << "\",\"pass\":" << (passed() ? "true" : "false");
+    for (const auto& [key, value] : measurements) out << ",\"" << key << "\":" << value;
+
+    out << ",\"failures\":[";
+    for (size_t i = 0; i < failures.size(); i++) out << (i > 0 ? "," : "") << "\"" << failures[i] << "\"";
+    out << "]}\n";
+    out.precision(precision);
+}
+
+const std::vector<SelfTest::Check>& SelfTest::checks() {
+    static const std::vector<Check> all = {
+        { "ring-buffer", &SelfTest::ringBufferOrder },
+        { "command-stress", &SelfTest::commandStress },
+        { "clock-accuracy", &SelfTest::clockAccuracy },
+        { "watcher-cost", &SelfTest::watcherCost },
+        { "id3-fuzz", &SelfTest::id3Fuzz },
+        { "shuffle-cycle", &SelfTest::shuffleCycle },
+        { "playlist-churn", &SelfTest::playlistChurn },
+        { "seek-gap", &SelfTest::seekSilenceGap },
+        { "seek-latency", &SelfTest::seekLatency },
+        { "lookahead-seek", &SelfTest::seekDuringLookahead },
+        { "lookahead-requeue", &SelfTest::requeueDuringLookahead },
+        { "mp3-reference", &SelfTest::mp3Reference },
+    };
+    return all;
+}
+
+int SelfTest::runCommandLine(const std::vector<std::string>& arguments) {
+    std::vector<const Check*> selected;
+    for (size_t i = 1; i < arguments.size(); i++) {
+        auto found = std::find_if(checks().begin(), checks().end(), [&](const Check& check) { return arguments[i] == check.name; });
+        if (found == checks().end()) {
+            std::cerr << "usage: CLP --self-test [check]...\nchecks:";
+            for (const Check& check : checks()) std::cerr << " " << check.name;
+            std::cerr << "\n";
+            return 2;
+        }
+        selected.push_back(&*found);
+    }
+    if (selected.empty()) {
+        for (const Check& check : checks()) selected.push_back(&check);
+    }
+
+    bool allPassed = true;
+    for (const Check* check : selected) {
+        Report report(check->name);
+        check->run(report);
+        report.print(std::cout);
+        allPassed = allPassed && report.passed();
+    }
+    return allPassed ? 0 : 1;
+}
+
+// Streams millions of samples through a small ring from one thread to another, in chunk
+// sizes that keep both sides wrapping at different points. Every sample must come out once,
+// in order.
+void SelfTest::ringBufferOrder(Report& report) {
+    constexpr size_t SAMPLES = size_t(1) << 24, CAPACITY = 1000, MAX_CHUNK = 777;
+    auto sampleAt = [](size_t index) { return static_cast<int16_t>(index ^ (index >> 16)); };
+
+    CircularBuffer ring(CAPACITY);
+    auto started = std::chrono::steady_clock::now();
+    std::thread producer([&] {
+        std::mt19937 generator(1);
+        std::vector<int16_t> chunk(MAX_CHUNK);
+        size_t written = 0;
+        while (written < SAMPLES) {
+            size_t count = std::min<size_t>(std::uniform_int_distribution<size_t>(1, MAX_CHUNK)(generator), SAMPLES - written);
+            for (size_t i = 0; i < count; i++) chunk[i] = sampleAt(written + i);
+
+            size_t offset = 0;
+            while (offset < count) {
+                size_t accepted = ring.write(chunk.data() + offset, count - offset);
+                if (accepted == 0) std::this_thread::yield();
+                offset += accepted;
+            }
+            written += count;
+        }
+    });
+
+    std::mt19937 generator(2);
+    std::vector<int16_t> chunk(MAX_CHUNK);
+    size_t read = 0, mismatches = 0, firstMismatch = SAMPLES;
+    while (read < SAMPLES) {
+        size_t count = ring.read(chunk.data(), std::uniform_int_distribution<size_t>(1, MAX_CHUNK)(generator));
+        if (count == 0) std::this_thread::yield();
+        for (size_t i = 0; i < count; i++) {
+            if (chunk[i] == sampleAt(read + i)) continue;
+            if (mismatches++ == 0) firstMismatch = read + i;
+        }
+        read += count;
+    }
+    producer.join();
+    double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    report.record("frames", static_cast<double>(SAMPLES / CHANNELS));
+    report.record("capacity", static_cast<double>(ring.getCapacity()));
+    report.record("mismatches", static_cast<double>(mismatches));
+    report.record("mframes_per_second", SAMPLES / CHANNELS / elapsedSeconds / 1e6);
+    report.expect(mismatches == 0, "sample " + std::to_string(firstMismatch) + " was lost or reordered");
+    report.expect(ring.empty(), "samples were left over");
+}
+
+// Several threads post random commands as fast as they can while another reads the status,
+// against an unthrottled and a realtime sink. Nothing may block or report an impossible
+// position, and the engine must still play afterwards. Build with ThreadSanitizer to check
+// for races.
+void SelfTest::commandStress(Report& report) {
+    constexpr int THREADS = 4, COMMANDS = 4000;
+
+    ScratchDirectory directory;
+    std::filesystem::path tracks[] = { directory / "short.wav", directory / "long.wav" };
+    writeWav(tracks[0], SAMPLE_RATE, frameNumberSample);
+    writeWav(tracks[1], 3 * SAMPLE_RATE, frameNumberSample);
+
+    std::atomic<size_t> badStatus = 0;
+    size_t unresponsive = 0;
+    auto started = std::chrono::steady_clock::now();
+    for (NullAudioSink::Pacing pacing : { NullAudioSink::Pacing::Unthrottled, NullAudioSink::Pacing::Realtime }) {
+        SoundModule soundModule(std::make_unique<NullAudioSink>(pacing));
+        std::atomic<bool> posting = true;
+
+        std::thread reader([&] {
+            while (posting.load()) {
+                double progress = soundModule.getProgress();
+                if (progress < 0.0 || progress > 1.0 || soundModule.getTimeElapsed() < 0.0 || soundModule.getSongDuration() < 0.0) badStatus++;
+            }
+        });
+
+        std::vector<std::thread> posters;
+        for (int thread = 0; thread < THREADS; thread++) {
+            posters.emplace_back([&, thread] {
+                std::mt19937 generator(thread);
+                for (int command = 0; command < COMMANDS; command++) {
+                    switch (generator() % 8) {
+                    case 0: soundModule.play(tracks[generator() % 2]); break;
+                    case 1: soundModule.queueNext(tracks[generator() % 2]); break;
+                    case 2: soundModule.pause(); break;
+                    case 3: if (generator() % 8 == 0) soundModule.stop(); break;
+                    case 4: soundModule.seekTo(static_cast<int>(generator() % 101)); break;
+                    case 5: soundModule.seekToSeconds(static_cast<int>(generator() % 41) - 20); break;
+                    case 6: soundModule.changeVolume(static_cast<int>(generator() % 101)); break;
+                    default: soundModule.clearQueue(); break;
+                    }
+                    if (command % 64 == 0) std::this_thread::sleep_for(std::chrono::microseconds(200));
+                }
+            });
+        }
+        for (std::thread& poster : posters) poster.join();
+        posting = false;
+        reader.join();
+
+        soundModule.play(tracks[1]);
+        bool playing = waitUntil([&] { return soundModule.getPlaybackPosition().elapsed.count() > 0; }, std::chrono::seconds(5));
+        if (!playing) unresponsive++;
+    }
+
+    report.record("commands", static_cast<double>(2 * THREADS * COMMANDS));
+    report.record("elapsed_s", std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count());
+    report.record("bad_status_reads", static_cast<double>(badStatus.load()));
+    report.expect(badStatus == 0, "a status read was out of range");
+    report.expect(unresponsive == 0, "the engine did not play after the stress");
+}
+
+// Reads the playback position continuously for a few seconds and compares it with when the
+// sink says the track's first frame became audible. Also checks the position never moves
+// backwards and holds still while paused.
+void SelfTest::clockAccuracy(Report& report) {
+    constexpr size_t FRAMES = 6 * SAMPLE_RATE;
+    constexpr double LIMIT_MILLISECONDS = 10.0;
+
+    ScratchDirectory directory;
+    std::filesystem::path track = directory / "track.wav";
+    writeWav(track, FRAMES, frameNumberSample);
+
+    auto capturingSink = std::make_unique<CaptureSink>();
+    CaptureSink* sink = capturingSink.get();
+    SoundModule soundModule(std::move(capturingSink));
+    soundModule.setOutputFormat(SAMPLE_RATE, CHANNELS);
+
+    soundModule.play(track);
+    bool started = waitUntil([&] { return soundModule.getPlaybackPosition().elapsed.count() > 0; }, std::chrono::seconds(10));
+    report.expect(started, "playback never started");
+
+    struct Reading {
+        std::chrono::steady_clock::time_point at;
+        std::chrono::nanoseconds elapsed;
+    };
+    std::vector<Reading> readings;
+    size_t backwards = 0;
+    auto until = std::chrono::steady_clock::now() + std::chrono::seconds(4);
+    while (std::chrono::steady_clock::now() < until) {
+        auto at = std::chrono::steady_clock::now();
+        std::chrono::nanoseconds elapsed = soundModule.getPlaybackPosition().elapsed;
+        if (!readings.empty() && elapsed < readings.back().elapsed) backwards++;
+        readings.push_back({ at, elapsed });
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+    }
+
+    soundModule.pause();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    std::chrono::nanoseconds pausedAt = soundModule.getPlaybackPosition().elapsed;
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    double pausedDrift = std::chrono::duration<double, std::milli>(soundModule.getPlaybackPosition().elapsed - pausedAt).count();
+    soundModule.stop();
+
+    std::chrono::steady_clock::time_point firstAudible = sink->audibleAt(0);
+    std::vector<double> errors;
+    for (const Reading& reading : readings) {
+        double heard = std::chrono::duration<double, std::milli>(reading.at - firstAudible).count();
+        errors.push_back(std::abs(std::chrono::duration<double, std::milli>(reading.elapsed).count() - heard));
+    }
+    std::sort(errors.begin(), errors.end());
+
+    report.record("reads", static_cast<double>(readings.size()));
+    report.record("error_p50_ms", errors.empty() ? 0.0 : errors[errors.size() / 2]);
+    report.record("error_max_ms", errors.empty() ? 0.0 : errors.back());
+    report.record("backwards", static_cast<double>(backwards));
+    report.record("paused_drift_ms", pausedDrift);
+    report.expect(!errors.empty() && errors.back() < LIMIT_MILLISECONDS, "the position was more than 10 ms from what was heard");
+    report.expect(backwards == 0, "the position moved backwards");
+    report.expect(std::abs(pausedDrift) < 1.0, "the position moved while paused");
+}
+
+// Times the library update for a watcher batch at two library sizes, one file added or
+// removed at a time and ten at a time. The median cost must follow the size of the batch,
+// not the size of the library.
+void SelfTest::watcherCost(Report& report) {
+    constexpr size_t SMALL_LIBRARY = 500, LARGE_LIBRARY = 5000, TRACKS_PER_DIRECTORY = 100, BATCH = 10;
+    constexpr int REPEATS = 20;
+
+    ScratchDirectory directory;
+    std::filesystem::path source = directory / "source.wav";
+    writeWav(source, 64, frameNumberSample);
+
+    auto measure = [&](size_t librarySize, size_t batchSize) {
+        std::filesystem::path library = directory / ("library-" + std::to_string(librarySize));
+        for (size_t track = 0; track < librarySize; track++) {
+            std::filesystem::path folder = library / ("d" + std::to_string(track / TRACKS_PER_DIRECTORY));
+            std::filesystem::create_directories(folder);
+            std::filesystem::copy_file(source, folder / ("t" + std::to_string(track) + ".wav"), std::filesystem::copy_options::skip_existing);
+        }
+
+        FilesystemModule filesystem(library, directory / ("library-" + std::to_string(librarySize) + ".cache"));
+        std::atomic<bool> scanned = false;
+        filesystem.readMusicList(nullptr, [&] { scanned = true; });
+        waitUntil([&] { return scanned.load(); }, std::chrono::seconds(60));
+
+        std::vector<std::filesystem::path> batch;
+        for (size_t file = 0; file < batchSize; file++) batch.push_back(library / "d0" / ("new" + std::to_string(file) + ".wav"));
+
+        std::vector<double> costs;
+        auto update = [&] {
+            auto started = std::chrono::steady_clock::now();
+            filesystem.applyChanges(batch);
+            costs.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - started).count());
+        };
+        for (int repeat = 0; repeat < REPEATS; repeat++) {
+            for (const std::filesystem::path& path : batch) std::filesystem::copy_file(source, path);
+            update();
+            for (const std::filesystem::path& path : batch) std::filesystem::remove(path);
+            update();
+        }
+        filesystem.cancelAnalysis();
+
+        std::sort(costs.begin(), costs.end());
+        return costs[costs.size() / 2];
+    };
+
+    double smallSingle = measure(SMALL_LIBRARY, 1), smallBatch = measure(SMALL_LIBRARY, BATCH);
+    double largeSingle = measure(LARGE_LIBRARY, 1), largeBatch = measure(LARGE_LIBRARY, BATCH);
+    report.record("small_library", SMALL_LIBRARY);
+    report.record("large_library", LARGE_LIBRARY);
+    report.record("small_single_us", smallSingle);
+    report.record("small_batch_us", smallBatch);
+    report.record("large_single_us", largeSingle);
+    report.record("large_batch_us", largeBatch);
+    report.expect(largeSingle < 3.0 * smallSingle, "a one-file update grew with the library");
+    report.expect(largeBatch < 3.0 * smallBatch, "a ten-file update grew with the library");
+}
+
+// Reads well-formed v2.2, v2.3 and v2.4 tags, then hundreds of thousands of corrupted copies:
+// flipped bits, overwritten bytes, huge sizes and truncation, aimed mostly at the headers.
+// The reader must never leave the stream or return a field longer than its buffer; run it
+// under AddressSanitizer to catch reads past the data.
+void SelfTest::id3Fuzz(Report& report) {
+    constexpr int ITERATIONS = 200000;
+    constexpr size_t MAX_FIELD_CHARACTERS = 4096, HEADER_REGION = 160;
+
+    std::vector<uint8_t> artistUtf16 = { 1, 0xFF, 0xFE, 0xC4, 0x00, 'r', 0, 't', 0, 'i', 0, 's', 0, 't', 0, 0, 0 };
+    auto latin1 = [](std::initializer_list<std::string_view> fields) {
+        std::vector<uint8_t> payload = { 0 };
+        for (std::string_view field : fields) {
+            payload.insert(payload.end(), field.begin(), field.end());
+            payload.push_back(0);
+        }
+        return payload;
+    };
+    std::vector<uint8_t> replayGain = latin1({ "REPLAYGAIN_TRACK_GAIN", "-6.50 dB" });
+    std::vector<uint8_t> cover = latin1({ "image/png", "\3" });
+    cover.resize(cover.size() + 8192, 0xFF);
+
+    std::vector<std::vector<uint8_t>> seeds = {
+        TagBuilder(2).text("TT2", "Title").frame("TP1", artistUtf16).text("TAL", "Album").text("TRK", "3/12").text("TYE", "1999")
+            .text("TCO", "(17)").text("TLE", "215000").build(),
+        TagBuilder(3).text("TIT2", "Title").frame("TPE1", artistUtf16).text("TALB", "Album").frame("APIC", cover).text("TRCK", "3/12")
+            .text("TYER", "1999").text("TCON", "(17)").text("TLEN", "215000").frame("TXXX", replayGain).build(),
+        TagBuilder(4).text("TIT2", "Title").frame("TPE1", artistUtf16, true).frame("APIC", cover).text("TALB", "Album")
+            .text("TRCK", "3/12").text("TDRC", "1999-04-01").text("TCON", "Rock").text("TLEN", "215000").frame("TXXX", replayGain).build(),
+    };
+
+    int seedsRead = 0;
+    for (const std::vector<uint8_t>& seed : seeds) {
+        MemoryInputSource source(seed);
+        Id3Reader::Tags tags;
+        bool read = Id3Reader(source).read(tags);
+        bool expected = tags.title == L"Title" && tags.artist == L"\u00C4rtist" && tags.album == L"Album" && tags.trackNumber == 3
+                        && tags.year == 1999 && tags.genre == L"Rock" && tags.lengthMilliseconds == 215000;
+        if (read && expected && (seed[3] == 2 || std::abs(tags.replayGain.trackGain + 6.5f) < 0.01f)) seedsRead++;
+    }
+
+    std::mt19937 generator(21);
+    size_t accepted = 0, violations = 0;
+    Id3Reader::Tags tags;
+    auto started = std::chrono::steady_clock::now();
+    for (int iteration = 0; iteration < ITERATIONS; iteration++) {
+        std::vector<uint8_t> bytes = seeds[iteration % seeds.size()];
+        int mutations = 1 + static_cast<int>(generator() % 8);
+        for (int mutation = 0; mutation < mutations && !bytes.empty(); mutation++) {
+            size_t region = (generator() % 5 != 0) ? std::min(bytes.size(), HEADER_REGION) : bytes.size();
+            size_t at = generator() % region;
+            switch (generator() % 5) {
+            case 0: bytes[at] ^= static_cast<uint8_t>(1 << (generator() % 8)); break;
+            case 1: bytes[at] = static_cast<uint8_t>(generator()); break;
+            case 2: bytes[at] = std::array<uint8_t, 4>{ 0x00, 0x7F, 0x80, 0xFF }[generator() % 4]; break;
+            case 3: for (size_t i = at; i < std::min(at + 4, bytes.size()); i++) bytes[i] = (generator() % 2 == 0) ? 0x7F : 0xFF; break;
+            default: bytes.resize(at); break;
+            }
+        }
+
+        MemoryInputSource source(bytes);
+        if (Id3Reader(source).read(tags)) accepted++;
+
+        size_t longest = std::max({ tags.title.size(), tags.artist.size(), tags.album.size(), tags.genre.size() });
+        if (source.position() > bytes.size() || longest > MAX_FIELD_CHARACTERS) violations++;
+    }
+    double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    report.record("seeds_read", seedsRead);
+    report.record("iterations", ITERATIONS);
+    report.record("accepted", static_cast<double>(accepted));
+    report.record("violations", static_cast<double>(violations));
+    report.record("tags_per_second", ITERATIONS / elapsedSeconds);
+    report.expect(seedsRead == static_cast<int>(seeds.size()), "a well-formed tag was not read correctly");
+    report.expect(violations == 0, "a corrupted tag was read past its bounds");
+}
+
+// Steps the shuffle through whole cycles at several library sizes: every track must play
+// exactly once per cycle and never twice in a row across a cycle boundary. Also steps back
+// and forward through the history, and changes the library mid-cycle.
+void SelfTest::shuffleCycle(Report& report) {
+    constexpr int CYCLES = 20;
+    size_t cycles = 0, badCycles = 0, unstablePeeks = 0, repeats = 0;
+
+    for (uint32_t tracks : { 1u, 2u, 3u, 10u, 1000u }) {
+        PlayQueue queue;
+        for (uint32_t track = 0; track < tracks; track++) queue.add(track);
+
+        PlayQueue::TrackId previous = PlayQueue::NO_TRACK;
+        for (int cycle = 0; cycle < CYCLES; cycle++) {
+            std::vector<int> plays(tracks, 0);
+            for (uint32_t step = 0; step < tracks; step++) {
+                PlayQueue::TrackId next = queue.peekNext(true);
+                if (queue.peekNext(true) != next) unstablePeeks++;
+                if (next >= tracks) break;
+                if (tracks > 1 && next == previous) repeats++;
+
+                queue.started(next);
+                plays[next]++;
+                previous = next;
+            }
+            cycles++;
+            if (std::any_of(plays.begin(), plays.end(), [](int count) { return count != 1; })) badCycles++;
+        }
+    }
+
+    // Going back and then forward again must replay the same tracks, and the draws after
+    // them must still finish the cycle without repeats.
+    size_t historyErrors = 0;
+    {
+        constexpr uint32_t TRACKS = 50, PLAYED = 10;
+        PlayQueue queue;
+        for (uint32_t track = 0; track < TRACKS; track++) queue.add(track);
+
+        std::vector<PlayQueue::TrackId> played;
+        for (uint32_t step = 0; step < PLAYED; step++) {
+            played.push_back(queue.peekNext(true));
+            queue.started(played.back());
+        }
+        for (int step = PLAYED - 2; step >= 0; step--) {
+            PlayQueue::TrackId back = queue.previous();
+            if (back != played[step]) historyErrors++;
+            queue.started(back);
+        }
+        if (queue.previous() != PlayQueue::NO_TRACK) historyErrors++;
+        for (uint32_t step = 1; step < PLAYED; step++) {
+            PlayQueue::TrackId next = queue.peekNext(true);
+            if (next != played[step]) historyErrors++;
+            queue.started(next);
+        }
+
+        std::vector<bool> seen(TRACKS, false);
+        for (PlayQueue::TrackId track : played) seen[track] = true;
+        for (uint32_t step = PLAYED; step < TRACKS; step++) {
+            PlayQueue::TrackId next = queue.peekNext(true);
+            if (next >= TRACKS || seen[next]) historyErrors++;
+            else seen[next] = true;
+            queue.started(next);
+        }
+    }
+
+    // Tracks added mid-cycle join the rest of the cycle and removed ones never play.
+    size_t changeErrors = 0;
+    {
+        constexpr uint32_t TRACKS = 100, PLAYED = 30, ADDED = 10;
+        PlayQueue queue;
+        for (uint32_t track = 0; track < TRACKS; track++) queue.add(track);
+
+        std::unordered_set<PlayQueue::TrackId> unplayed;
+        for (uint32_t track = 0; track < TRACKS; track++) unplayed.insert(track);
+        for (uint32_t step = 0; step < PLAYED; step++) {
+            PlayQueue::TrackId next = queue.peekNext(true);
+            queue.started(next);
+            unplayed.erase(next);
+        }
+
+        std::vector<PlayQueue::TrackId> removed(unplayed.begin(), std::next(unplayed.begin(), 10));
+        for (PlayQueue::TrackId track : removed) {
+            queue.remove(track);
+            unplayed.erase(track);
+        }
+        for (uint32_t track = TRACKS; track < TRACKS + ADDED; track++) {
+            queue.add(track);
+            unplayed.insert(track);
+        }
+
+        size_t remaining = unplayed.size();
+        for (size_t step = 0; step < remaining; step++) {
+            PlayQueue::TrackId next = queue.peekNext(true);
+            if (unplayed.erase(next) == 0) changeErrors++;
+            queue.started(next);
+        }
+        changeErrors += unplayed.size();
+    }
+
+    report.record("cycles", static_cast<double>(cycles));
+    report.record("bad_cycles", static_cast<double>(badCycles));
+    report.record("back_to_back_repeats", static_cast<double>(repeats));
+    report.record("history_errors", static_cast<double>(historyErrors));
+    report.record("library_change_errors", static_cast<double>(changeErrors));
+    report.expect(badCycles == 0, "a track did not play exactly once in a cycle");
+    report.expect(unstablePeeks == 0, "asking for the next track twice changed the answer");
+    report.expect(repeats == 0, "a track played twice in a row");
+    report.expect(historyErrors == 0, "stepping back and forward did not replay the same tracks");
+    report.expect(changeErrors == 0, "a library change mid-cycle broke the cycle");
+}
+
+// Renames every track of a library again and again, the way rescans and the watcher replace
+// tracks. The string pool must stay within twice the live strings, plus the slack it waits
+// for before compacting, and every path must still find its track under its latest name.
+void SelfTest::playlistChurn(Report& report) {
+    constexpr int TRACKS = 2000, ROUNDS = 40;
+    Playlist playlist;
+    std::vector<LibraryTrack> library(TRACKS);
+
+    auto renamed = [](LibraryTrack& track, int index, int round) {
+        track.title = L"Title " + std::to_wstring(index) + L" take " + std::to_wstring(round);
+        track.artist = L"Artist " + std::to_wstring(index % 50);
+        track.album = L"Album " + std::to_wstring(index % 200);
+        track.name = track.artist + L" - " + track.title;
+        track.path = std::filesystem::path(L"music") / track.artist / track.album / (track.title + L".mp3");
+    };
+
+    for (int index = 0; index < TRACKS; index++) {
+        renamed(library[index], index, 0);
+        playlist.insert(library[index]);
+    }
+
+    size_t liveCharacters = 0, peakCharacters = playlist.stringCharacters(), lookupErrors = 0;
+    for (int round = 1; round <= ROUNDS; round++) {
+        liveCharacters = 0;
+        for (int index = 0; index < TRACKS; index++) {
+            playlist.remove(library[index].path);
+            renamed(library[index], index, round);
+            playlist.insert(library[index]);
+            liveCharacters += library[index].name.size() + library[index].path.wstring().size();
+            peakCharacters = std::max(peakCharacters, playlist.stringCharacters());
+        }
+    }
+
+    for (const LibraryTrack& track : library) {
+        int row = playlist.find(track.path);
+        if (row < 0 || playlist.name(row) != track.name || playlist.path(row) != track.path) lookupErrors++;
+    }
+
+    report.record("live_characters", static_cast<double>(liveCharacters));
+    report.record("peak_characters", static_cast<double>(peakCharacters));
+    report.record("final_characters", static_cast<double>(playlist.stringCharacters()));
+    report.record("lookup_errors", static_cast<double>(lookupErrors));
+    report.expect(playlist.size() == TRACKS, "the playlist lost or duplicated tracks");
+    report.expect(peakCharacters <= 2 * liveCharacters + 64 * 1024, "removed tracks' strings were not released");
+    report.expect(lookupErrors == 0, "a track was not found under its latest name");
+}
+
+// Seeks around a playing track and measures the silence each seek leaves, as the samples the
+// output asked for and the engine could not supply. Frame numbers in the audio show where
+// playback resumed, which must be the seek target apart from the crossfade.
+void SelfTest::seekSilenceGap(Report& report) {
+    constexpr size_t FRAMES = 12 * SAMPLE_RATE;
+    constexpr int TARGETS[] = { 20, 60, 10, 80, 40, 50, 30, 70, 15, 85 };
+    constexpr size_t RUN_FRAMES = 2000, SPLICE_SLACK_FRAMES = SAMPLE_RATE / 20;
+
+    ScratchDirectory directory;
+    std::filesystem::path track = directory / "track.wav";
+    writeWav(track, FRAMES, frameNumberSample);
+
+    auto capturingSink = std::make_unique<CaptureSink>();
+    CaptureSink* sink = capturingSink.get();
+    SoundModule soundModule(std::move(capturingSink));
+    soundModule.setOutputFormat(SAMPLE_RATE, CHANNELS);
+
+    soundModule.play(track);
+    bool started = waitUntil([&] { return soundModule.getPlaybackPosition().elapsed.count() > 0; }, std::chrono::seconds(10));
+    report.expect(started, "playback never started");
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+    std::vector<double> gaps;
+    int resumedAtTarget = 0;
+    for (int target : TARGETS) {
+        size_t missingBefore = sink->missingSamples(), capturedBefore = sink->capturedSamples();
+        soundModule.seekTo(target);
+        std::this_thread::sleep_for(std::chrono::milliseconds(400));
+        gaps.push_back(static_cast<double>(sink->missingSamples() - missingBefore) / CHANNELS * 1000.0 / SAMPLE_RATE);
+
+        // The first run of consecutive frames after the seek is where playback resumed.
+        std::vector<int16_t> captured = sink->capture();
+        size_t targetFrame = static_cast<size_t>(FRAMES * (target / 100.0f));
+        for (size_t frame = capturedBefore / CHANNELS; frame + RUN_FRAMES < captured.size() / CHANNELS; frame++) {
+            size_t number = frameNumberAt(captured, frame);
+            if (number < targetFrame || number > targetFrame + SPLICE_SLACK_FRAMES) continue;
+
+            size_t run = 1;
+            while (run < RUN_FRAMES && frameNumberAt(captured, frame + run) == number + run) run++;
+            if (run == RUN_FRAMES) {
+                resumedAtTarget++;
+                break;
+            }
+        }
+    }
+    soundModule.stop();
+
+    std::sort(gaps.begin(), gaps.end());
+    report.record("seeks", static_cast<double>(gaps.size()));
+    report.record("gap_median_ms", gaps[gaps.size() / 2]);
+    report.record("gap_max_ms", gaps.back());
+    report.record("resumed_at_target", resumedAtTarget);
+    report.expect(gaps.back() < 5.0, "a seek left an audible silence");
+    report.expect(resumedAtTarget == static_cast<int>(gaps.size()), "playback did not resume at every seek target");
+}
+
+// Times each seek from the call until the first sample of the new position is heard. Old
+// audio plays on as consecutive frame numbers, so the first break in the sequence is where
+// the crossfade into the target begins.
+void SelfTest::seekLatency(Report& report) {
+    constexpr size_t FRAMES = 12 * SAMPLE_RATE;
+    constexpr int SEEKS = 20;
+    constexpr double LIMIT_MILLISECONDS = 100.0;
+
+    ScratchDirectory directory;
+    std::filesystem::path track = directory / "track.wav";
+    writeWav(track, FRAMES, frameNumberSample);
+
+    auto capturingSink = std::make_unique<CaptureSink>();
+    CaptureSink* sink = capturingSink.get();
+    SoundModule soundModule(std::move(capturingSink));
+    soundModule.setOutputFormat(SAMPLE_RATE, CHANNELS);
+
+    soundModule.play(track);
+    bool started = waitUntil([&] { return soundModule.getPlaybackPosition().elapsed.count() > 0; }, std::chrono::seconds(10));
+    report.expect(started, "playback never started");
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+    std::vector<double> latencies;
+    for (int seek = 0; seek < SEEKS; seek++) {
+        size_t firstFrame = sink->capturedSamples() / CHANNELS;
+        auto requested = std::chrono::steady_clock::now();
+        soundModule.seekTo(seek % 2 == 0 ? 60 : 20);
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+
+        std::vector<int16_t> captured = sink->capture();
+        for (size_t frame = firstFrame + 1; frame < captured.size() / CHANNELS; frame++) {
+            if (frameNumberAt(captured, frame) == frameNumberAt(captured, frame - 1) + 1) continue;
+
+            latencies.push_back(std::chrono::duration<double, std::milli>(sink->audibleAt(frame) - requested).count());
+            break;
+        }
+    }
+    soundModule.stop();
+
+    report.record("seeks", static_cast<double>(latencies.size()));
+    report.expect(latencies.size() == SEEKS, "a seek was never heard");
+    if (latencies.empty()) return;
+
+    std::sort(latencies.begin(), latencies.end());
+    report.record("latency_p50_ms", latencies[latencies.size() / 2]);
+    report.record("latency_max_ms", latencies.back());
+    report.expect(latencies.back() < LIMIT_MILLISECONDS, "a seek took longer than 100 ms to be heard");
+}
+
+// Seeks back two seconds near the end of a track, after the next track has started decoding.
+// The seek must land in the track being heard, and the next track must then play in full,
+// once. The left channel tells the tracks apart and the right channel counts frames.
+void SelfTest::seekDuringLookahead(Report& report) {
+    constexpr int16_t FIRST_MARKER = 8000, SECOND_MARKER = -8000;
+    constexpr size_t FIRST_FRAMES = 3 * SAMPLE_RATE, SECOND_FRAMES = SAMPLE_RATE;
+    constexpr double SEEK_AT = 2.8;
+
+    ScratchDirectory directory;
+    std::filesystem::path first = directory / "first.wav", second = directory / "second.wav";
+    writeWav(first, FIRST_FRAMES, [](size_t frame, int channel) { return static_cast<int16_t>(channel == 0 ? FIRST_MARKER : frame / 8); });
+    writeWav(second, SECOND_FRAMES, [](size_t frame, int channel) { return static_cast<int16_t>(channel == 0 ? SECOND_MARKER : frame / 8); });
+
+    auto capturingSink = std::make_unique<CaptureSink>();
+    CaptureSink* sink = capturingSink.get();
+    std::atomic<int> songChanges = 0;
+    std::atomic<bool> finished = false;
+    std::vector<int16_t> captured;
+    {
+        SoundModule soundModule(std::move(capturingSink));
+        soundModule.setOutputFormat(SAMPLE_RATE, CHANNELS);
+        soundModule.setBufferLength(500);
+        soundModule.setOnSongChangedCallback([&](const std::filesystem::path&) { songChanges++; });
+        soundModule.setOnSongFinishedCallback([&] { finished = true; });
+
+        soundModule.play(first);
+        soundModule.queueNext(second);
+        bool reached = waitUntil([&] { return seconds(soundModule.getPlaybackPosition().elapsed) >= SEEK_AT; }, std::chrono::seconds(10));
+        report.expect(reached, "playback never reached the seek point");
+
+        // With half a second buffered, the first track has finished decoding by now.
+        double seekedFrom = seconds(soundModule.getPlaybackPosition().elapsed);
+        soundModule.seekToSeconds(-2);
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        SoundModule::PlaybackPosition afterSeek = soundModule.getPlaybackPosition();
+        report.record("seeked_from_s", seekedFrom);
+        report.record("elapsed_after_seek_s", seconds(afterSeek.elapsed));
+        report.expect(songChanges == 0, "the seek moved on to the next track");
+        report.expect(std::abs(seconds(afterSeek.duration) - 3.0) < 0.01, "the position no longer describes the first track");
+        report.expect(seconds(afterSeek.elapsed) < seekedFrom - 1.5, "the position did not move back");
+
+        report.expect(waitUntil([&] { return finished.load(); }, std::chrono::seconds(10)), "playback never finished");
+        captured = sink->capture();
+    }
+
+    size_t firstFrames = 0, secondFrames = 0, firstAfterSecond = 0;
+    int secondStart = -1, firstEnd = -1;
+    for (size_t i = 0; i + 1 < captured.size(); i += CHANNELS) {
+        if (captured[i] > FIRST_MARKER / 2) {
+            firstFrames++;
+            firstEnd = captured[i + 1];
+            if (secondFrames > 0) firstAfterSecond++;
+        }
+        else if (captured[i] < SECOND_MARKER / 2) {
+            if (secondFrames++ == 0) secondStart = captured[i + 1];
+        }
+    }
+
+    double firstSeconds = static_cast<double>(firstFrames) / SAMPLE_RATE;
+    report.record("song_changes", songChanges.load());
+    report.record("first_track_heard_s", firstSeconds);
+    report.record("second_track_frames", static_cast<double>(secondFrames));
+    report.expect(songChanges == 1, "the next track was not entered exactly once");
+    report.expect(firstSeconds > SEEK_AT + 1.9 && firstSeconds < SEEK_AT + 2.5, "the first track did not replay from the seek target");
+    report.expect(firstEnd == static_cast<int16_t>((FIRST_FRAMES - 1) / 8), "the first track did not play to its end");
+    report.expect(firstAfterSecond == 0, "the first track was heard after the next one started");
+    report.expect(secondFrames == SECOND_FRAMES && secondStart == 0, "the next track did not play in full from its start");
+}
+
+// Queues a third track once the second has started decoding but is not yet audible. The
+// song-changed callback must name the second track when it becomes audible, not the track
+// queued last, and then the third.
+void SelfTest::requeueDuringLookahead(Report& report) {
+    constexpr size_t TRACK_FRAMES = SAMPLE_RATE;
+    constexpr double REQUEUE_AT = 0.7;
+
+    ScratchDirectory directory;
+    std::vector<std::filesystem::path> tracks = { directory / "first.wav", directory / "second.wav", directory / "third.wav" };
+    for (const std::filesystem::path& track : tracks) writeWav(track, TRACK_FRAMES, [](size_t, int) { return int16_t{ 1000 }; });
+
+    std::mutex enteredMutex;
+    std::vector<std::filesystem::path> entered;
+    std::atomic<bool> finished = false;
+    {
+        SoundModule soundModule(std::make_unique<CaptureSink>());
+        soundModule.setOutputFormat(SAMPLE_RATE, CHANNELS);
+        soundModule.setBufferLength(500);
+        soundModule.setOnSongChangedCallback([&](const std::filesystem::path& pathToSong) {
+            std::lock_guard<std::mutex> lock(enteredMutex);
+            entered.push_back(pathToSong);
+        });
+        soundModule.setOnSongFinishedCallback([&] { finished = true; });
+
+        soundModule.play(tracks[0]);
+        soundModule.queueNext(tracks[1]);
+        bool reached = waitUntil([&] { return seconds(soundModule.getPlaybackPosition().elapsed) >= REQUEUE_AT; }, std::chrono::seconds(10));
+        report.expect(reached, "playback never reached the requeue point");
+
+        // With half a second buffered, the second track is decoding by now.
+        {
+            std::lock_guard<std::mutex> lock(enteredMutex);
+            report.expect(entered.empty(), "the second track was entered before the requeue");
+        }
+        soundModule.queueNext(tracks[2]);
+        report.expect(waitUntil([&] { return finished.load(); }, std::chrono::seconds(10)), "playback never finished");
+    }
+
+    report.record("song_changes", static_cast<double>(entered.size()));
+    report.expect(entered.size() == 2, "the queued tracks were not entered exactly once each");
+    report.expect(entered.size() > 0 && entered[0] == tracks[1], "the first song change did not name the second track");
+    report.expect(entered.size() > 1 && entered[1] == tracks[2], "the second song change did not name the third track");
+}
+
+// Decodes generated MP3 files through Mp3Decoder and through a plain mp3dec_decode_frame
+// loop. After the tag frame is skipped and the tagged delay and padding trimmed, a linear
+// decode and the audio after every seek must match the reference sample for sample.
+void SelfTest::mp3Reference(Report& report) {
+    constexpr size_t FRAMES = 200, SEEKS = 40, COMPARED_FRAMES = 4096;
+
+    std::mt19937 random(5);
+    for (Mp3Tag tag : { Mp3Tag::None, Mp3Tag::Info, Mp3Tag::Vbri }) {
+        const char* name = (tag == Mp3Tag::None) ? "untagged" : (tag == Mp3Tag::Info) ? "info" : "vbri";
+        std::vector<uint8_t> bytes = syntheticMp3(FRAMES, tag);
+
+        std::vector<int16_t> reference = referenceMp3Decode(bytes, (tag == Mp3Tag::None) ? 0 : MP3_FRAME_BYTES);
+        size_t delay = (tag == Mp3Tag::None) ? 0 : MP3_DELAY * CHANNELS;
+        size_t padding = (tag == Mp3Tag::Info) ? MP3_PADDING * CHANNELS : 0;
+        reference.erase(reference.end() - std::min(padding, reference.size()), reference.end());
+        reference.erase(reference.begin(), reference.begin() + std::min(delay, reference.size()));
+        size_t referenceFrames = reference.size() / CHANNELS;
+
+        Mp3Decoder decoder;
+        if (!decoder.open(std::make_unique<MemoryInputSource>(bytes))) {
+            report.expect(false, std::string(name) + ": the file did not open");
+            continue;
+        }
+
+        // The tagged length is known before anything is decoded; the untagged one after a scan.
+        uint64_t totalFrames = decoder.getTotalFrames();
+        std::vector<int16_t> decoded;
+        AudioDecoder::Block block;
+        while (decoder.decode(block)) decoded.insert(decoded.end(), block.samples, block.samples + block.frames * block.channels);
+
+        size_t audible = 0;
+        for (int16_t sample : reference) audible += (sample != 0);
+        report.record(std::string(name) + "_frames", static_cast<double>(referenceFrames));
+        report.record(std::string(name) + "_audible_fraction", reference.empty() ? 0.0 : static_cast<double>(audible) / reference.size());
+        report.expect(referenceFrames > (FRAMES - 2) * MP3_FRAME_SAMPLES - MP3_DELAY - MP3_PADDING, std::string(name) + ": the reference decoded too little audio");
+        report.expect(totalFrames == referenceFrames, std::string(name) + ": the reported length differs from the reference");
+        report.expect(decoded == reference, std::string(name) + ": the linear decode differs from the reference");
+
+        // Frame boundaries, the first and last samples, and random positions.
+        std::vector<uint64_t> targets = { 0, 1, MP3_FRAME_SAMPLES - 1, MP3_FRAME_SAMPLES, 10 * MP3_FRAME_SAMPLES + 1, referenceFrames - 1 };
+        while (targets.size() < SEEKS) targets.push_back(std::uniform_int_distribution<uint64_t>(0, referenceFrames - 1)(random));
+
+        size_t seekMismatches = 0;
+        for (uint64_t target : targets) {
+            std::vector<int16_t> afterSeek;
+            if (decoder.seek(target)) {
+                while (afterSeek.size() < COMPARED_FRAMES * CHANNELS && decoder.decode(block))
+                    afterSeek.insert(afterSeek.end(), block.samples, block.samples + block.frames * block.channels);
+            }
+
+            size_t compared = std::min<size_t>(COMPARED_FRAMES, referenceFrames - target) * CHANNELS;
+            bool matches = afterSeek.size() >= compared && std::equal(afterSeek.begin(), afterSeek.begin() + compared, reference.begin() + target * CHANNELS);
+            if (!matches) seekMismatches++;
+        }
+        report.record(std::string(name) + "_seek_mismatches", static_cast<double>(seekMismatches));
+        report.expect(seekMismatches == 0, std::string(name) + ": audio after a seek differs from the reference");
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "headers.hpp"
+
+// `--self-test` mode: end-to-end checks of the playback engine and the data structures behind
+// it, run against generated audio and a null sink so they need no music folder or audio
+// device. Runs every check, or only the named ones, and prints one JSON object per line with
+// the check's measurements, whether it passed and why not. Exits with 1 if any check failed.
+class SelfTest {
+private:
+    class Report {
+    private:
+        std::string check;
+        std::vector<std::pair<std::string, double>> measurements;
+        std::vector<std::string> failures;
+    public:
+        explicit Report(std::string check);
+
+        void record(const std::string& key, double value);
+        void expect(bool condition, const std::string& failure);
+        bool passed() const;
+        void print(std::ostream& out) const;
+    };
+
+    struct Check {
+        const char* name;
+        void (*run)(Report& report);
+    };
+
+    static const std::vector<Check>& checks();
+    static void ringBufferOrder(Report& report);
+    static void commandStress(Report& report);
+    static void clockAccuracy(Report& report);
+    static void watcherCost(Report& report);
+    static void id3Fuzz(Report& report);
+    static void shuffleCycle(Report& report);
+    static void playlistChurn(Report& report);
+    static void seekSilenceGap(Report& report);
+    static void seekLatency(Report& report);
+    static void seekDuringLookahead(Report& report);
+    static void requeueDuringLookahead(Report& report);
+    static void mp3Reference(Report& report);
+public:
+    static int runCommandLine(const std::vector<std::string>& arguments);
+};
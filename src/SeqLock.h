@@ -0,0 +1,50 @@
+#pragma once
+#include "headers.hpp"
+
+// Single-writer sequence lock for small trivially copyable values. store() never waits and
+// load() retries while a store is in flight, so neither side blocks the other. The value is
+// kept in atomic words, which keeps the torn copies a reader may discard well-defined.
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable_v<T>, "SeqLock values are copied word by word");
+private:
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    std::atomic<uint64_t> sequence = 0;
+    std::array<std::atomic<uint64_t>, WORDS> words{};
+public:
+    SeqLock() {
+        store(T{});
+    }
+
+    SeqLock(const SeqLock&) = delete;
+    SeqLock& operator=(const SeqLock&) = delete;
+
+    void store(const T& value) {
+        uint64_t raw[WORDS] = {};
+        std::memcpy(raw, &value, sizeof(T));
+
+        uint64_t current = sequence.load(std::memory_order_relaxed);
+        sequence.store(current + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (size_t i = 0; i < WORDS; i++) words[i].store(raw[i], std::memory_order_relaxed);
+        sequence.store(current + 2, std::memory_order_release);
+    }
+
+    T load() const {
+        uint64_t raw[WORDS];
+        uint64_t before = 0, after = 0;
+
+        do {
+            before = sequence.load(std::memory_order_acquire);
+            for (size_t i = 0; i < WORDS; i++) raw[i] = words[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = sequence.load(std::memory_order_relaxed);
+        } while ((before & 1) != 0 || before != after);
+
+        T value;
+        std::memcpy(&value, raw, sizeof(T));
+        return value;
+    }
+};
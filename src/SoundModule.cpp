@@ -1,494 +1,628 @@
 #include "SoundModule.hpp"
 
-void SoundModule::soundCallback(void* userdata, uint8_t* stream, int len) {
-    SoundModule* sm = static_cast<SoundModule*>(userdata);
+size_t SoundModule::renderAudio(int16_t* output, size_t samples) {
+    if (isPaused.load()) return 0;
 
-    std::memset(stream, 0, len);
+    gainStage.setTarget(volume.load() / 100.0f);
 
-    if (!sm->shouldPlay.load() || sm->isPaused.load()) return;
+    size_t samplesRead = callbackBuffer.read(output, samples);
+    gainStage.process(output, output, samplesRead);
+    playbackClock.update(callbackBuffer.readPosition(), static_cast<size_t>(deviceFormat.latencyFrames) * deviceFormat.channels,
+                         static_cast<double>(deviceFormat.frequency) * deviceFormat.channels);
 
-    std::lock_guard<std::mutex> bufferLock(sm->callbackBufferMutex);
-    
-    int samplesNeeded = len / sizeof(uint16_t);
-    int samplesAvailable = std::min(samplesNeeded, static_cast<int>(sm->callbackBuffer.size()));
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (producerWaiting.load() && (callbackBuffer.size() <= wakeThreshold.load() || boundaryReached())) wakeProducer();
+    return samplesRead;
+}
 
-    if (samplesAvailable > 0) {
-        std::vector<uint16_t> tempBuffer(samplesAvailable);
-        std::copy(sm->callbackBuffer.begin(), sm->callbackBuffer.begin() + samplesAvailable, tempBuffer.begin());
-        sm->callbackBuffer.erase(sm->callbackBuffer.begin(), sm->callbackBuffer.begin() + samplesAvailable);
+SoundModule::SoundModule() : SoundModule(std::make_unique<SdlAudioSink>()) {}
 
-        int sdlVolume = (sm->volume * SDL_MIX_MAXVOLUME) / 100;
-        SDL_MixAudioFormat(stream, reinterpret_cast<uint8_t*>(tempBuffer.data()), 
-                           AUDIO_S16SYS, samplesAvailable * sizeof(uint16_t), sdlVolume);
-    }
+SoundModule::SoundModule(std::unique_ptr<AudioSink> outputSink) : sink(std::move(outputSink)) {
+    musicThread = std::thread([this] {
+        while (!exitThread.load()) {
+            processCommands();
+
+            if (state == EngineState::Stopped || isPaused.load()) waitForCommand();
+            else if (state == EngineState::Draining) drainPlayback();
+            else if (callbackBuffer.size() >= highWatermark) waitForConsumer(lowWatermark, true);
+            else decodeBlock();
+        }
+    });
 }
 
-SoundModule::SoundModule() {
-	if (SDL_Init(SDL_INIT_AUDIO) != 0) {
-		std::cerr << "SDL init error: " << SDL_GetError();
-		return;
-	}
-	mp3dec_init(&mp3d);
+SoundModule::~SoundModule() {
+    exitThread.store(true);
+    wakeProducer();
 
-	musicThread = std::thread([this] {
-		std::unique_lock<std::mutex> lock(playCvMutex);
+    if (musicThread.joinable()) musicThread.join();
 
-		while (!exitThread.load()) {
-            bool hasMusic = false;
-            {
-                std::lock_guard<std::mutex> queueLock(musicQueueMutex);
-                hasMusic = !musicQueue.empty();
-            }
+    sink->close();
 
-            if (!hasMusic) {
-                playCv.wait(lock);
-                continue;
-            }
+    callbackBuffer.clear();
+    trackDecoder.reset();
+}
 
-            if (exitThread.load()) break;
+void SoundModule::setOnSongFinishedCallback(std::function<void()> callback) {
+    songEndingCallback = callback;
+}
 
-            if (deviceId != 0) {
-                SDL_CloseAudioDevice(deviceId);
-                deviceId = 0;
-            }
-            
-            {
-                std::unique_lock<std::mutex> lock(musicQueueMutex);
-                if (musicQueue.empty()) continue;
-                currentSong = musicQueue.front();
-                musicQueue.pop_front();
-            }
+void SoundModule::setOnSongChangedCallback(std::function<void(const std::filesystem::path&)> callback) {
+    songChangedCallback = callback;
+}
 
-            double duration = songDuration(currentSong);
-            {
-                std::lock_guard<std::mutex> timeLock(timeMutex);
-                currentSongDuration = std::chrono::duration<double>(duration);
-                timeElapsed = std::chrono::seconds(0);
-            }
+void SoundModule::setOnStatusChangedCallback(std::function<void()> callback) {
+    statusChangedCallback = callback;
+}
 
-            std::ifstream file(currentSong, std::ios::binary);
-            
-            if (!file) continue;
-
-            file.seekg(0, std::ios::end);
-            std::streamsize size = file.tellg();
-            file.seekg(0, std::ios::beg);
-
-            songBuffer.resize(size);
-            if (!file.read(reinterpret_cast<char*>(songBuffer.data()), size)) {
-                {
-                    std::lock_guard<std::mutex> stopLockGuard(stopCvMutex);
-                    shouldPlay.store(false);
-                }
-                stopCv.notify_one();
-                continue;
-            }
+void SoundModule::setDurationVerification(bool enabled) {
+    verifyDurations.store(enabled);
 
-            short pcm[MINIMP3_MAX_SAMPLES_PER_FRAME];
-            mp3dec_frame_info_t info;
-            uint8_t* musicData = songBuffer.data();
-            size_t remaining = songBuffer.size();
-            specInitialized = false;
-            {
-                std::lock_guard<std::mutex> stopLockGuard(stopCvMutex);
-                shouldPlay.store(true);
-            }
-            {
-                std::lock_guard<std::mutex> bufferLock(callbackBufferMutex);
-                callbackBuffer.clear();
-            }
+    std::lock_guard<std::mutex> cacheLock(durationCacheMutex);
+    durationCache.clear();
+}
 
-            while (remaining > 0 && shouldPlay.load()) {
-                if (isPaused.load()) {
-                    if (deviceId != 0) SDL_PauseAudioDevice(deviceId, 1);
-                   
-                    std::unique_lock<std::mutex> pauseLock(pauseMutex);
-                    pauseCv.wait(pauseLock, [this] { return !isPaused.load() || !shouldPlay.load(); });
-
-                    if (!shouldPlay.load()) break;
-                    if (deviceId != 0) SDL_PauseAudioDevice(deviceId, 0);
-                }
-                    
-                if (seekRequested.load()) {
-                    std::lock_guard<std::mutex> seekLock(seekMutex);
-                    seekRequested.store(false);
-                    if (progressSeek.load()) seekByProgress(musicData, remaining);
-                    else seekBySeconds(musicData, remaining);
-                }
-
-                int samples = mp3dec_decode_frame(&mp3d, musicData, remaining, pcm, &info);
-
-                if (!shouldPlay.load()) break;
-
-                if (info.frame_bytes == 0) {
-                    musicData++;
-                    remaining--;
-                    continue;
-                }
-
-                if (!specInitialized) {
-                    spec.freq = info.hz;
-                    spec.format = AUDIO_S16SYS;
-                    spec.channels = info.channels;
-                    spec.samples = 4096;
-                    spec.callback = soundCallback;
-                    spec.userdata = this;
-
-                    deviceId = SDL_OpenAudioDevice(nullptr, 0, &spec, nullptr, 0);
-                    if (deviceId == 0) {
-                        {
-                            std::lock_guard<std::mutex> stopLockGuard(stopCvMutex);
-                            stop();
-                        }
-                        stopCv.notify_one();
-                        continue;
-                    }
-                    SDL_PauseAudioDevice(deviceId, 0);
-
-                    specInitialized = true;
-                }
-
-                if (samples > 0) {
-                    double frameDuration = static_cast<double>(samples) / info.hz;
-
-                    {
-                        std::lock_guard<std::mutex> bufferLock(callbackBufferMutex);
-                        callbackBuffer.insert(callbackBuffer.end(), pcm, pcm + (samples * info.channels));
-                    }
-
-                    while (callbackBuffer.size() > static_cast<uint32_t>(spec.freq * spec.channels)
-                        && shouldPlay.load())
-                    {
-                        SDL_Delay(5);
-                    }
-
-                    {
-                        std::lock_guard<std::mutex> timeLock(timeMutex);
-                        timeElapsed += std::chrono::duration<double>(frameDuration);
-                    }
-                    
-                }
-
-                musicData += info.frame_bytes;
-                remaining -= info.frame_bytes;
-            }
+void SoundModule::setOutputFormat(int frequency, int channels) {
+    outputFrequency.store(std::clamp(frequency, 8000, 192000));
+    outputChannels.store(std::clamp(channels, 1, 2));
+}
 
-            while (!callbackBuffer.empty() && shouldPlay.load()) {
-                SDL_Delay(10);
-            }
-            
-            {
-                std::lock_guard<std::mutex> bufferLock(callbackBufferMutex);
-                std::vector<uint16_t>().swap(callbackBuffer);
-                std::vector<uint8_t>().swap(songBuffer);
-            }
+void SoundModule::setResampleQuality(Resampler::Quality quality) {
+    resampleQuality.store(quality);
+}
 
-            if (songEndingCallback != nullptr && shouldPlay.load()) {
-                songEndingCallback();
-            }
+void SoundModule::setVolumeRamp(GainStage::Ramp ramp) {
+    volumeRamp.store(ramp);
+}
 
-            bool hasMoreSongs = false;
-            {
-                std::lock_guard<std::mutex> queueLock(musicQueueMutex);
-                hasMoreSongs = !musicQueue.empty();
-            }
+void SoundModule::setBufferLength(int milliseconds) {
+    bufferMilliseconds.store(static_cast<size_t>(std::clamp(milliseconds, 20, 1000)));
+}
 
-            if (hasMoreSongs) {
-                continue;
-            }
+void SoundModule::setSeekCrossfade(int milliseconds) {
+    seekCrossfadeMilliseconds.store(static_cast<size_t>(std::clamp(milliseconds, 0, 50)));
+}
 
-            if (deviceId != 0) {
-                SDL_CloseAudioDevice(deviceId);
-                deviceId = 0;
-            }
+void SoundModule::setGainLookup(std::function<ReplayGain(const std::filesystem::path&)> lookup) {
+    gainLookup = std::move(lookup);
+}
 
-            {
-                std::lock_guard<std::mutex> stopLockGuard(stopCvMutex);
-                stop();
-            }
-            stopCv.notify_one();
-			
-		}
-	});
+void SoundModule::setReplayGain(ReplayGain::Mode mode, float preampDb) {
+    replayGainMode.store(mode);
+    replayGainPreamp.store(std::clamp(preampDb, -15.0f, 15.0f));
 }
 
-SoundModule::~SoundModule() {
-    {
-        std::lock_guard<std::mutex> stopLock(stopCvMutex);
-        stopCv.notify_one();
+void SoundModule::post(SoundCommand command) {
+    while (!commands.push(command)) std::this_thread::yield();
+    wakeProducer();
+}
+
+void SoundModule::processCommands() {
+    SoundCommand command;
+    while (commands.pop(command)) handleCommand(command);
+}
+
+void SoundModule::handleCommand(SoundCommand& command) {
+    switch (command.type) {
+    case SoundCommand::Type::Play:
+        nextSong.clear();
+        startTrack(command.path, command.replayGain, false);
+        break;
+    case SoundCommand::Type::QueueNext:
+        nextSong = std::move(command.path);
+        nextSongGain = command.replayGain;
+        break;
+    case SoundCommand::Type::ClearQueue:
+        nextSong.clear();
+        break;
+    case SoundCommand::Type::TogglePause:
+        togglePause();
+        break;
+    case SoundCommand::Type::Stop:
+        nextSong.clear();
+        stopPlayback();
+        break;
+    case SoundCommand::Type::SeekProgress:
+        if (prepareSeek()) seekByProgress(command.value);
+        break;
+    case SoundCommand::Type::SeekSeconds:
+        if (prepareSeek()) seekBySeconds(command.value);
+        break;
+    case SoundCommand::Type::Volume:
+        volume.store(command.value);
+        break;
     }
+}
 
-    playCv.notify_one();
-    pauseCv.notify_one();
+void SoundModule::waitForCommand() {
+    uint32_t observedSignal = flowSignal.load();
+    if (commands.empty() && !exitThread.load()) flowSignal.wait(observedSignal);
+}
 
-    exitThread.store(true);
-    if (musicThread.joinable()) musicThread.join();
+void SoundModule::publishStatus() {
+    statusSnapshot.store(status);
+    if (statusChangedCallback != nullptr) statusChangedCallback();
+}
+
+double SoundModule::playedFrames(const PlaybackStatus& snapshot) const {
+    if (!snapshot.playing || snapshot.channels == 0) return 0.0;
+
+    double audible = std::max(playbackClock.position() - static_cast<double>(snapshot.anchorPosition), 0.0);
+    return std::min(snapshot.anchorFrame + audible / snapshot.channels, static_cast<double>(snapshot.durationFrames));
+}
+
+uint64_t SoundModule::toOutputFrames(uint64_t samples, int sampleRate) const {
+    if (sampleRate <= 0) return 0;
+    return samples * static_cast<uint64_t>(deviceFormat.frequency) / static_cast<uint64_t>(sampleRate);
+}
 
-    if (deviceId != 0) {
-        SDL_CloseAudioDevice(deviceId);
-        deviceId = 0;
+void SoundModule::startTrack(const std::filesystem::path& pathToSong, const ReplayGain& replayGain, bool continuing) {
+    double duration = songDuration(pathToSong);
+
+    if (!openTrack(pathToSong)) {
+        if (continuing) state = EngineState::Draining;
+        else stopPlayback();
+        return;
     }
 
-    {
-        std::lock_guard<std::mutex> bufferLock(callbackBufferMutex);
-        callbackBuffer.clear();
+    state = EngineState::Playing;
+    if (continuing) {
+        peakLimiter.setGain(trackGainFactor(replayGain), false);
+        pendingBoundaries.push_back({ callbackBuffer.writePosition(), static_cast<uint64_t>(duration * deviceFormat.frequency + 0.5),
+                                      pathToSong, replayGain });
+        watchNextBoundary();
+        return;
+    }
+
+    currentSong = pathToSong;
+    currentSongGain = replayGain;
+    pendingBoundaries.clear();
+    watchNextBoundary();
+    isPaused.store(false);
+
+    if (!ensureDevice()) {
+        stopPlayback();
+        return;
     }
-    currentSong.clear();
-    songBuffer.clear();
 
-    SDL_QuitSubSystem(SDL_INIT_AUDIO);
+    status = { true, false, status.segment + 1, deviceFormat.frequency, deviceFormat.channels, callbackBuffer.writePosition(), 0,
+               static_cast<uint64_t>(duration * deviceFormat.frequency + 0.5) };
+    publishStatus();
+
+    clearCallbackBuffer();
+    resampler.reset();
+    peakLimiter.setGain(trackGainFactor(replayGain), true);
+    peakLimiter.reset();
+    updateWatermarks();
+    sink->pause(false);
 }
 
-void SoundModule::setOnSongFinishedCallback(std::function<void()> callback) {
-    songEndingCallback = callback;
+void SoundModule::decodeBlock() {
+    checkTrackBoundaries();
+
+    AudioDecoder::Block block;
+    if (!trackDecoder->decode(block)) {
+        finishTrack();
+        return;
+    }
+
+    if (block.frames > 0) pushFrames(block.samples, block.frames, block.sampleRate, block.channels);
 }
 
-void SoundModule::play(const std::filesystem::path& pathToSong) {
-    if (shouldPlay.load()) {
-        shouldPlay.store(false);
+void SoundModule::finishTrack() {
+    trackDecoder.reset();
 
-        std::unique_lock<std::mutex> stopLock(stopCvMutex);
-        stopCv.wait(stopLock, [this]() { return !shouldPlay.load(); });
+    if (!nextSong.empty()) {
+        startTrack(std::exchange(nextSong, {}), nextSongGain, true);
+        return;
     }
 
-    {
-        std::lock_guard<std::mutex> timeLock(timeMutex);
-        timeElapsed = std::chrono::seconds(0);
-        currentSongDuration = std::chrono::duration<double>(songDuration(pathToSong));
+    flushResampler();
+    state = EngineState::Draining;
+}
+
+void SoundModule::drainPlayback() {
+    if (!nextSong.empty()) {
+        startTrack(std::exchange(nextSong, {}), nextSongGain, true);
+        return;
     }
-    {
-        std::lock_guard<std::mutex> queueLock(musicQueueMutex);
-        musicQueue.emplace_front(pathToSong);
+
+    if (!callbackBuffer.empty()) {
+        waitForConsumer(0, true);
+        return;
     }
-    {
-        std::lock_guard<std::mutex> pauseLock(pauseMutex);
-        isPaused.store(false);
+
+    checkTrackBoundaries();
+    stopPlayback();
+    if (songEndingCallback != nullptr) songEndingCallback();
+}
+
+void SoundModule::stopPlayback() {
+    trackDecoder.reset();
+    pendingBoundaries.clear();
+    watchNextBoundary();
+
+    state = EngineState::Stopped;
+    status = { false, false, status.segment + 1 };
+    publishStatus();
+
+    isPaused.store(false);
+    clearCallbackBuffer();
+    if (sink->isOpen()) sink->pause(true);
+}
+
+void SoundModule::togglePause() {
+    if (state == EngineState::Stopped) return;
+
+    bool nowPaused = !isPaused.load();
+    isPaused.store(nowPaused);
+    sink->pause(nowPaused);
+
+    if (nowPaused) {
+        sink->lock();
+        playbackClock.freeze();
+        sink->unlock();
     }
 
-    pauseCv.notify_one();
-    playCv.notify_one();
+    status.paused = nowPaused;
+    publishStatus();
+}
+
+void SoundModule::play(const std::filesystem::path& pathToSong) {
+    post(SoundCommand::withPath(SoundCommand::Type::Play, pathToSong, lookupReplayGain(pathToSong)));
+}
+
+void SoundModule::queueNext(const std::filesystem::path& pathToSong) {
+    post(SoundCommand::withPath(SoundCommand::Type::QueueNext, pathToSong, lookupReplayGain(pathToSong)));
+}
+
+void SoundModule::clearQueue() {
+    post(SoundCommand::withValue(SoundCommand::Type::ClearQueue));
 }
 
 void SoundModule::pause() {
-    std::lock_guard<std::mutex> pauseLock(pauseMutex);
-    isPaused.store(!isPaused.load());
-    pauseCv.notify_one();
+    post(SoundCommand::withValue(SoundCommand::Type::TogglePause));
 }
 
 void SoundModule::stop() {
-    {
-        std::lock_guard<std::mutex> timeLock(timeMutex);
-        timeElapsed = std::chrono::seconds(0);
-        currentSongDuration = std::chrono::seconds(0);
-    }
-    
-    {
-        std::lock_guard<std::mutex> pauseLock(pauseMutex);
-        isPaused.store(false);
+    post(SoundCommand::withValue(SoundCommand::Type::Stop));
+}
+
+double SoundModule::getSongDuration() {
+    PlaybackStatus snapshot = statusSnapshot.load();
+    if (snapshot.frequency == 0) return 0.0;
+    return static_cast<double>(snapshot.durationFrames) / snapshot.frequency;
+}
+
+double SoundModule::getSongDuration(const std::filesystem::path& pathToSong) {
+    return songDuration(pathToSong);
+}
+
+bool SoundModule::openTrack(const std::filesystem::path& pathToSong) {
+    trackDecoder = DecoderRegistry::open(pathToSong);
+    return trackDecoder != nullptr;
+}
+
+ReplayGain SoundModule::lookupReplayGain(const std::filesystem::path& pathToSong) const {
+    if (replayGainMode.load() == ReplayGain::Mode::Off || gainLookup == nullptr) return {};
+    return gainLookup(pathToSong);
+}
+
+float SoundModule::trackGainFactor(const ReplayGain& replayGain) const {
+    ReplayGain::Mode mode = replayGainMode.load();
+    if (mode == ReplayGain::Mode::Off || !replayGain.known()) return 1.0f;
+    return std::pow(10.0f, (replayGain.gainFor(mode) + replayGainPreamp.load()) / 20.0f);
+}
+
+bool SoundModule::ensureDevice() {
+    int frequency = outputFrequency.load();
+    int channels = outputChannels.load();
+    if (sink->isOpen() && openedFrequency == frequency && openedChannels == channels) return true;
+
+    sink->close();
+    bool opened = sink->open({ frequency, channels }, [this](int16_t* output, size_t samples) {
+        return renderAudio(output, samples);
+    });
+    if (!opened) return false;
+
+    openedFrequency = frequency;
+    openedChannels = channels;
+    deviceFormat = sink->getFormat();
+    gainStage.configure(deviceFormat.channels, static_cast<size_t>(deviceFormat.frequency / 100), volumeRamp.load());
+    peakLimiter.configure(deviceFormat.channels, deviceFormat.frequency);
+    return true;
+}
+
+void SoundModule::pushFrames(const int16_t* samples, size_t frames, int frequency, int channels) {
+    Resampler::Quality quality = resampleQuality.load();
+    if (!resampler.matches(frequency, channels, deviceFormat.frequency, deviceFormat.channels, quality)) {
+        flushResampler();
+        resampler.configure(frequency, channels, deviceFormat.frequency, deviceFormat.channels, quality);
     }
 
-    {
-        std::lock_guard<std::mutex> bufferLock(callbackBufferMutex);
-        std::vector<uint16_t>().swap(callbackBuffer);
-        std::vector<uint8_t>().swap(songBuffer);
+    resampler.process(samples, frames, resampleBuffer);
+    peakLimiter.process(resampleBuffer.data(), resampleBuffer.size());
+    writeSamples(resampleBuffer.data(), resampleBuffer.size());
+}
+
+void SoundModule::flushResampler() {
+    resampler.flush(resampleBuffer);
+    peakLimiter.process(resampleBuffer.data(), resampleBuffer.size());
+    writeSamples(resampleBuffer.data(), resampleBuffer.size());
+}
+
+void SoundModule::writeSamples(const int16_t* samples, size_t count) {
+    while (count > 0 && !exitThread.load()) {
+        size_t written = callbackBuffer.write(samples, count);
+        samples += written;
+        count -= written;
+        if (count > 0) waitForConsumer(callbackBuffer.getCapacity() - std::min(count, callbackBuffer.getCapacity()), false);
     }
 
-    currentSong.clear();
-    shouldPlay.store(false);
+    if (callbackBuffer.size() >= highWatermark) waitForConsumer(lowWatermark, true);
 }
 
-double SoundModule::getSongDuration() {
-    std::lock_guard<std::mutex> timeLock(timeMutex);
-    if (currentSongDuration == std::chrono::seconds(0)) return 0.0;
-    return currentSongDuration.count();
+void SoundModule::waitForConsumer(size_t threshold, bool interruptible) {
+    auto interrupted = [&] { return exitThread.load() || (interruptible && !commands.empty()); };
+
+    while (callbackBuffer.size() > threshold && !interrupted()) {
+        uint32_t observedSignal = flowSignal.load();
+        wakeThreshold.store(threshold);
+        producerWaiting.store(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (callbackBuffer.size() > threshold && !interrupted() && !boundaryReached()) flowSignal.wait(observedSignal);
+
+        producerWaiting.store(false);
+        checkTrackBoundaries();
+    }
 }
 
-void SoundModule::seekByProgress(uint8_t*& musicData, size_t& remaining) {
-    MP3_Header header = recieveHeader(songBuffer.data());
-    size_t songStart = 10 + header.tagSize;
+void SoundModule::wakeProducer() {
+    flowSignal.fetch_add(1);
+    flowSignal.notify_one();
+}
 
-    float newProgress = static_cast<float>(newSeekPosition.load()) / 100.0f;
-    if (newProgress > 0.99f) {
-        newProgress = 0.99f;
+bool SoundModule::boundaryReached() const {
+    if (!boundaryWatched.load()) return false;
+    return callbackBuffer.readPosition() - watchedBoundary.load() <= callbackBuffer.getCapacity();
+}
+
+void SoundModule::watchNextBoundary() {
+    if (pendingBoundaries.empty()) {
+        boundaryWatched.store(false);
+        return;
     }
 
-    size_t songSize = songBuffer.size() - songStart;
-    size_t newPosInBuffer = static_cast<size_t>(songSize * newProgress) + songStart;
+    watchedBoundary.store(pendingBoundaries.front().bufferPosition);
+    boundaryWatched.store(true);
+}
+
+void SoundModule::updateWatermarks() {
+    size_t samplesPerMillisecond = static_cast<size_t>(deviceFormat.frequency) * deviceFormat.channels / 1000;
+    size_t periodSamples = static_cast<size_t>(std::max(deviceFormat.periodFrames, 1)) * deviceFormat.channels;
+    size_t maxWatermark = callbackBuffer.getCapacity() - callbackBuffer.getCapacity() / 8;
+
+    highWatermark = std::clamp(bufferMilliseconds.load() * samplesPerMillisecond, periodSamples * 2, maxWatermark);
+    lowWatermark = std::max(highWatermark / 2, periodSamples);
+}
 
-    uint8_t* newMusicData = songBuffer.data() + newPosInBuffer;
-    size_t newRemaining = songSize - (newPosInBuffer - songStart);
+void SoundModule::checkTrackBoundaries() {
+    while (!pendingBoundaries.empty()) {
+        size_t played = callbackBuffer.readPosition() - pendingBoundaries.front().bufferPosition;
+        if (played > callbackBuffer.getCapacity()) break;
 
-    while (newRemaining > 0) {
-        if ((*newMusicData & 0xFF) == 0xFF)
-            break;
-        newRemaining--;
-        newMusicData++;
-        newPosInBuffer++;
+        enterNextTrack(pendingBoundaries.front().bufferPosition);
     }
-    if (newRemaining > 0) {
-        remaining = newRemaining;
-        musicData = newMusicData;
-
-        {
-            std::lock_guard<std::mutex> timeLock(timeMutex);
-            timeElapsed = std::chrono::duration<double>(
-                (static_cast<double>(newPosInBuffer - songStart) / songSize) * currentSongDuration.count()
-            );
-        }
+}
 
-        {
-            std::lock_guard<std::mutex> bufferLock(callbackBufferMutex);
-            callbackBuffer.clear();
-        }
+void SoundModule::enterNextTrack(size_t bufferPosition) {
+    status.segment++;
+    status.anchorPosition = bufferPosition;
+    status.anchorFrame = 0;
+    status.durationFrames = pendingBoundaries.front().durationFrames;
+    publishStatus();
+
+    currentSong = std::move(pendingBoundaries.front().path);
+    currentSongGain = pendingBoundaries.front().replayGain;
+    pendingBoundaries.pop_front();
+    watchNextBoundary();
+
+    if (songChangedCallback != nullptr) songChangedCallback(currentSong);
+}
+
+// Once the next track has started decoding, the decoder no longer belongs to the track being
+// heard. A seek then reopens the audible track and gives up the lookahead; the next track is
+// queued again and decoded afresh when the audible one ends.
+bool SoundModule::prepareSeek() {
+    checkTrackBoundaries();
+    if (pendingBoundaries.empty()) return state == EngineState::Playing;
+
+    std::unique_ptr<AudioDecoder> decoder = DecoderRegistry::open(currentSong);
+    if (decoder == nullptr) return false;
+
+    nextSong = std::move(pendingBoundaries.front().path);
+    nextSongGain = pendingBoundaries.front().replayGain;
+    pendingBoundaries.clear();
+    watchNextBoundary();
+
+    trackDecoder = std::move(decoder);
+    state = EngineState::Playing;
+    peakLimiter.setGain(trackGainFactor(currentSongGain), true);
+    return true;
+}
+
+void SoundModule::seekByProgress(int progressPoint) {
+    float newProgress = static_cast<float>(progressPoint) / 100.0f;
+    if (newProgress > 0.99f) {
+        newProgress = 0.99f;
     }
+
+    seekToSample(static_cast<uint64_t>(trackDecoder->getTotalFrames() * newProgress));
+}
+
+void SoundModule::seekBySeconds(int secondsFromCurrentPoint) {
+    double currentTime = playedFrames(status) / status.frequency;
+    double targetTime = std::clamp(currentTime + secondsFromCurrentPoint, 0.0, static_cast<double>(status.durationFrames) / status.frequency);
+    seekToSample(static_cast<uint64_t>(targetTime * trackDecoder->getSampleRate()));
 }
 
-void SoundModule::seekBySeconds(uint8_t*& musicData, size_t& remaining) {
-    double targetTime = seekToTime.load();
-    double totalDuration = getSongDuration();
+void SoundModule::seekToSample(uint64_t targetSample) {
+    uint64_t totalFrames = trackDecoder->getTotalFrames();
+    if (totalFrames == 0) return;
+
+    targetSample = std::min(targetSample, totalFrames - 1);
+    if (!trackDecoder->seek(targetSample)) return;
+
+    // The old audio keeps playing while the target region is decoded; only then is the
+    // queued audio replaced, so a seek costs no silence unless decoding outruns the buffer.
+    resampler.reset();
+    prerollSeek();
 
-    if (targetTime < 0) targetTime = 0;
-    if (targetTime > totalDuration) targetTime = totalDuration;
+    status.segment++;
+    status.anchorPosition = callbackBuffer.writePosition();
+    status.anchorFrame = toOutputFrames(targetSample, trackDecoder->getSampleRate());
+    status.durationFrames = toOutputFrames(totalFrames, trackDecoder->getSampleRate());
+    publishStatus();
 
-    double progress = targetTime / totalDuration;
+    spliceSeekAudio();
+}
+
+void SoundModule::prerollSeek() {
+    seekPreroll.clear();
+    Resampler::Quality quality = resampleQuality.load();
 
-    MP3_Header header = recieveHeader(songBuffer.data());
-    size_t songStart = 10 + header.tagSize;
-    size_t songSize = songBuffer.size() - songStart;
-    size_t newPosInBuffer = static_cast<size_t>(songSize * progress) + songStart;
+    AudioDecoder::Block block;
+    while (seekPreroll.size() < lowWatermark && trackDecoder->decode(block)) {
+        if (block.frames == 0) continue;
 
-    uint8_t* newMusicData = songBuffer.data() + newPosInBuffer;
-    size_t newRemaining = songSize - (newPosInBuffer - songStart);
+        if (!resampler.matches(block.sampleRate, block.channels, deviceFormat.frequency, deviceFormat.channels, quality))
+            resampler.configure(block.sampleRate, block.channels, deviceFormat.frequency, deviceFormat.channels, quality);
 
-    while (newRemaining > 0) {
-        if ((*newMusicData & 0xFF) == 0xFF)
-            break;
-        newRemaining--;
-        newMusicData++;
-        newPosInBuffer++;
+        resampler.process(block.samples, block.frames, resampleBuffer);
+        peakLimiter.process(resampleBuffer.data(), resampleBuffer.size());
+        seekPreroll.insert(seekPreroll.end(), resampleBuffer.begin(), resampleBuffer.end());
     }
+}
 
-    if (newRemaining > 0) {
-        remaining = newRemaining;
-        musicData = newMusicData;
+void SoundModule::spliceSeekAudio() {
+    size_t channels = static_cast<size_t>(deviceFormat.channels);
+    size_t fadeSamples = seekCrossfadeMilliseconds.load() * static_cast<size_t>(deviceFormat.frequency) / 1000 * channels;
+    fadeSamples = std::min(fadeSamples, seekPreroll.size());
+    spliceTail.resize(fadeSamples);
 
-        {
-            std::lock_guard<std::mutex> timeLock(timeMutex);
-            timeElapsed = std::chrono::duration<double>(targetTime);
-        }
+    sink->lock();
+
+    size_t tailSamples = callbackBuffer.read(spliceTail.data(), fadeSamples);
+    tailSamples -= tailSamples % channels;
+    callbackBuffer.clear();
 
-        {
-            std::lock_guard<std::mutex> bufferLock(callbackBufferMutex);
-            callbackBuffer.clear();
+    // Equal-power fade from the audio that was about to play into the new position.
+    size_t fadeFrames = tailSamples / channels;
+    for (size_t frame = 0; frame < fadeFrames; frame++) {
+        float phase = (frame + 0.5f) / fadeFrames * 1.5707964f;
+        float oldGain = std::cos(phase), newGain = std::sin(phase);
+
+        for (size_t channel = 0; channel < channels; channel++) {
+            size_t i = frame * channels + channel;
+            float mixed = spliceTail[i] * oldGain + seekPreroll[i] * newGain;
+            seekPreroll[i] = static_cast<int16_t>(std::lrint(std::clamp(mixed, -32768.0f, 32767.0f)));
         }
     }
+
+    callbackBuffer.write(seekPreroll.data(), seekPreroll.size());
+    sink->unlock();
 }
 
 double SoundModule::songDuration(const std::filesystem::path& pathToSong) {
-    std::ifstream file(pathToSong, std::ios::binary);
-    if (!file) return 0.0;
+    {
+        std::lock_guard<std::mutex> cacheLock(durationCacheMutex);
+        auto cached = durationCache.find(pathToSong.wstring());
+        if (cached != durationCache.end()) return cached->second;
+    }
+
+    double duration = verifyDurations.load() ? decodeSongDuration(pathToSong) : probeSongDuration(pathToSong);
 
-    file.seekg(0, std::ios::end);
-    std::streamsize size = file.tellg();
-    file.seekg(0, std::ios::beg);
-    
-    std::vector<uint8_t> buffer(size);
-    if (!file.read(reinterpret_cast<char*>(buffer.data()), size)) return 0.0;
+    std::lock_guard<std::mutex> cacheLock(durationCacheMutex);
+    durationCache[pathToSong.wstring()] = duration;
+    return duration;
+}
 
-    std::streamsize remaining = buffer.size();
-    uint8_t* musicData = buffer.data();
+double SoundModule::probeSongDuration(const std::filesystem::path& pathToSong) {
+    std::unique_ptr<AudioDecoder> decoder = DecoderRegistry::open(pathToSong);
+    if (!decoder) return 0.0;
 
-    mp3dec_t durationDecoder;
-    mp3dec_init(&durationDecoder);
+    uint64_t totalFrames = decoder->estimateTotalFrames();
+    if (decoder->getSampleRate() == 0) return 0.0;
+    return static_cast<double>(totalFrames) / decoder->getSampleRate();
+}
 
-    mp3dec_frame_info_t frameInfo;
-    uint64_t totalSamplesPerChannel = 0;
-    int sampleRate = 0;
+double SoundModule::decodeSongDuration(const std::filesystem::path& pathToSong) {
+    std::unique_ptr<AudioDecoder> decoder = DecoderRegistry::open(pathToSong);
+    if (!decoder) return 0.0;
 
-    while (remaining > 0) {
-        int samples = mp3dec_decode_frame(&durationDecoder, musicData, remaining, nullptr, &frameInfo);
-        if (frameInfo.frame_bytes == 0) {
-            musicData++;
-            remaining--;
-            continue;
-        }
+    AudioDecoder::Block block;
+    uint64_t totalFrames = 0;
+    int sampleRate = 0;
 
-        if (samples > 0) {
+    while (decoder->decode(block)) {
+        if (block.frames > 0) {
             if (sampleRate == 0) {
-                sampleRate = frameInfo.hz;
+                sampleRate = block.sampleRate;
             }
-            totalSamplesPerChannel += samples;
+            totalFrames += block.frames;
         }
-
-        musicData += frameInfo.frame_bytes;
-        remaining -= frameInfo.frame_bytes;
     }
 
-    return static_cast<double>(totalSamplesPerChannel / sampleRate);
+    if (sampleRate == 0) return 0.0;
+    return static_cast<double>(totalFrames) / sampleRate;
 }
 
-double SoundModule::songDuration() {
-    return songDuration(currentSong);
+void SoundModule::clearCallbackBuffer() {
+    sink->lock();
+    callbackBuffer.clear();
+    sink->unlock();
 }
 
 double SoundModule::getTimeElapsed() {
-    std::lock_guard<std::mutex> timeLock(timeMutex);
-    return timeElapsed.count();
+    PlaybackStatus snapshot = statusSnapshot.load();
+    if (snapshot.frequency == 0) return 0.0;
+    return playedFrames(snapshot) / snapshot.frequency;
 }
 
 double SoundModule::getProgress() {
-    std::lock_guard<std::mutex> timeLock(timeMutex);
-    if (currentSongDuration == std::chrono::seconds(0)) return 0.0;
-    double progress = timeElapsed.count() / currentSongDuration.count();
-    if (progress > 1.0) progress = 1.0;
-    
-    return progress;
+    PlaybackStatus snapshot = statusSnapshot.load();
+    if (snapshot.durationFrames == 0) return 0.0;
+    return playedFrames(snapshot) / snapshot.durationFrames;
+}
+
+SoundModule::PlaybackPosition SoundModule::getPlaybackPosition() const {
+    PlaybackStatus snapshot = statusSnapshot.load();
+    if (snapshot.frequency == 0) return { {}, {}, snapshot.segment, snapshot.playing, snapshot.paused };
+
+    auto toNanoseconds = [&](double frames) {
+        return std::chrono::nanoseconds(static_cast<int64_t>(frames * 1e9 / snapshot.frequency));
+    };
+    return { toNanoseconds(playedFrames(snapshot)), toNanoseconds(static_cast<double>(snapshot.durationFrames)),
+             snapshot.segment, snapshot.playing, snapshot.paused };
 }
 
 bool SoundModule::paused() {
-    return isPaused.load();
+    return statusSnapshot.load().paused;
 }
 
 void SoundModule::seekTo(int newProgressPoint) {
-    if (!shouldPlay.load()) return;
-    if (newProgressPoint < 0) newProgressPoint = 0;
-    if (newProgressPoint > 100) newProgressPoint = 100;
-
-    std::lock_guard<std::mutex> seekLock(seekMutex);
-    newSeekPosition.store(newProgressPoint);
-    progressSeek.store(true);
-    seekRequested.store(true);
+    post(SoundCommand::withValue(SoundCommand::Type::SeekProgress, std::clamp(newProgressPoint, 0, 100)));
 }
 
 void SoundModule::seekToSeconds(int secondsFromCurrentPoint) {
-    if (!shouldPlay.load()) return;
-
-    double currentTime = getTimeElapsed();
-    double newTime = currentTime + secondsFromCurrentPoint;
-
-    if (newTime < 0) newTime = 0;
-    double maxTime = getSongDuration();
-    if (newTime > maxTime) newTime = maxTime;
-
-    std::lock_guard<std::mutex> seekLock(seekMutex);
-    seekToTime.store(newTime);
-    progressSeek.store(false);          
-    seekRequested.store(true);
+    post(SoundCommand::withValue(SoundCommand::Type::SeekSeconds, secondsFromCurrentPoint));
 }
 
 void SoundModule::changeVolume(int newVolume) {
-    if (newVolume < 0) newVolume = 0;
-    if (newVolume > 100) newVolume = 100;
-    volume = static_cast<uint8_t>(newVolume);
+    post(SoundCommand::withValue(SoundCommand::Type::Volume, std::clamp(newVolume, 0, 100)));
 }
 
-std::wstring SoundModule::fromDoubleToTime(const double& seconds) {
-    if (seconds <= 0) return L"00:00";
-    int min = static_cast<int>(seconds) / 60, sec = static_cast<int>(seconds) % 60;
-    
-    std::wostringstream resultStr;
-    resultStr << std::setfill(L'0') << std::setw(2) << min << L":" << std::setw(2) << sec;
-    return resultStr.str();
+void SoundModule::formatTime(double seconds, TimeText& out) {
+    unsigned totalSeconds = (seconds > 0) ? static_cast<unsigned>(seconds) : 0;
+    std::swprintf(out.data(), out.size(), L"%02u:%02u", std::min(totalSeconds / 60, 99999u), totalSeconds % 60);
 }
-
-
@@ -1,50 +1,175 @@
 #pragma once
 #include "headers.hpp"
+#include "CircularBuffer.h"
+#include "DecoderRegistry.h"
+#include "Resampler.h"
+#include "GainStage.h"
+#include "PeakLimiter.h"
+#include "ReplayGain.h"
+#include "AudioSink.h"
+#include "CommandQueue.h"
+#include "SeqLock.h"
+#include "PlaybackClock.h"
 
 class SoundModule {
 private:
-    mp3dec_t mp3d = {};
+    enum class EngineState {
+        Stopped,
+        Playing,
+        Draining
+    };
+
+    // Position is published as counters rather than seconds: the track was at anchorFrame
+    // (in output frames) when the callback's read position reached anchorPosition, and
+    // readers add whatever the callback has consumed since.
+    struct PlaybackStatus {
+        bool playing = false;
+        bool paused = false;
+        uint64_t segment = 0;
+        int frequency = 0;
+        int channels = 0;
+        size_t anchorPosition = 0;
+        uint64_t anchorFrame = 0;
+        uint64_t durationFrames = 0;
+    };
+
     std::thread musicThread;
-    std::filesystem::path currentSong;
-    std::list<std::filesystem::path> musicQueue = {};
-    std::vector<uint8_t> songBuffer;
-    std::vector<uint16_t> callbackBuffer;
-    std::chrono::duration<double> timeElapsed = std::chrono::seconds(0), currentSongDuration = std::chrono::seconds(0);
-
-
-    std::condition_variable playCv, pauseCv, stopCv, seekCv;
-    std::mutex musicQueueMutex, playCvMutex, stopCvMutex, seekCvMutex, pauseMutex, timeMutex, seekMutex, callbackBufferMutex;
-
-    uint32_t deviceId = 0;
-    bool specInitialized = false;
-    SDL_AudioSpec spec = {};
-    int8_t volume = 100;
-    std::atomic<bool> isPaused = false, shouldPlay = false, exitThread = false, seekRequested = false, 
-                      volumeChangeRequested = false, progressSeek = false;
-    std::atomic<int> newSeekPosition = 0, seekToTime = 0;
-    std::function<void()> songEndingCallback;
-    
-    void seekByProgress(uint8_t*& musicData, size_t& remaining);
-    void seekBySeconds(uint8_t*& musicData, size_t& remaining);
+    CommandQueue commands{ 256 };
+    SeqLock<PlaybackStatus> statusSnapshot;
+    PlaybackClock playbackClock;
+
+    EngineState state = EngineState::Stopped;
+    PlaybackStatus status;
+    std::filesystem::path currentSong, nextSong;
+    ReplayGain currentSongGain, nextSongGain;
+    std::unique_ptr<AudioDecoder> trackDecoder;
+    CircularBuffer callbackBuffer{ 1 << 17 };
+    std::vector<int16_t> resampleBuffer, seekPreroll, spliceTail;
+    Resampler resampler;
+    GainStage gainStage;
+    PeakLimiter peakLimiter;
+
+    struct TrackBoundary {
+        size_t bufferPosition;
+        uint64_t durationFrames;
+        std::filesystem::path path;
+        ReplayGain replayGain;
+    };
+    std::deque<TrackBoundary> pendingBoundaries;
+
+    size_t highWatermark = 0, lowWatermark = 0;
+    std::atomic<size_t> bufferMilliseconds = 250, seekCrossfadeMilliseconds = 10, wakeThreshold = 0, watchedBoundary = 0;
+    std::atomic<uint32_t> flowSignal = 0;
+    std::atomic<bool> producerWaiting = false, boundaryWatched = false;
+
+    std::unordered_map<std::wstring, double> durationCache;
+    std::mutex durationCacheMutex;
+    std::atomic<bool> verifyDurations = false;
+
+    std::unique_ptr<AudioSink> sink;
+    AudioFormat deviceFormat;
+    std::atomic<bool> isPaused = false, exitThread = false;
+    std::atomic<int> outputFrequency = 44100, outputChannels = 2, volume = 100;
+    std::atomic<Resampler::Quality> resampleQuality = Resampler::Quality::Sinc;
+    std::atomic<GainStage::Ramp> volumeRamp = GainStage::Ramp::Exponential;
+    std::atomic<ReplayGain::Mode> replayGainMode = ReplayGain::Mode::Track;
+    std::atomic<float> replayGainPreamp = 0.0f;
+    std::function<ReplayGain(const std::filesystem::path&)> gainLookup;
+    int openedFrequency = 0, openedChannels = 0;
+    std::function<void()> songEndingCallback, statusChangedCallback;
+    std::function<void(const std::filesystem::path&)> songChangedCallback;
+
+    void post(SoundCommand command);
+    void processCommands();
+    void handleCommand(SoundCommand& command);
+    void waitForCommand();
+    void publishStatus();
+    double playedFrames(const PlaybackStatus& snapshot) const;
+    uint64_t toOutputFrames(uint64_t samples, int sampleRate) const;
+
+    void startTrack(const std::filesystem::path& pathToSong, const ReplayGain& replayGain, bool continuing);
+    void decodeBlock();
+    void finishTrack();
+    void drainPlayback();
+    void stopPlayback();
+    void togglePause();
+
+    bool openTrack(const std::filesystem::path& pathToSong);
+    ReplayGain lookupReplayGain(const std::filesystem::path& pathToSong) const;
+    float trackGainFactor(const ReplayGain& replayGain) const;
+    bool ensureDevice();
+    void pushFrames(const int16_t* samples, size_t frames, int frequency, int channels);
+    void flushResampler();
+    void writeSamples(const int16_t* samples, size_t count);
+    void waitForConsumer(size_t threshold, bool interruptible);
+    void wakeProducer();
+    bool boundaryReached() const;
+    void watchNextBoundary();
+    void updateWatermarks();
+    void checkTrackBoundaries();
+    void enterNextTrack(size_t bufferPosition);
+
+    bool prepareSeek();
+    void seekByProgress(int progressPoint);
+    void seekBySeconds(int secondsFromCurrentPoint);
+    void seekToSample(uint64_t targetSample);
+    void prerollSeek();
+    void spliceSeekAudio();
+
     double songDuration(const std::filesystem::path& pathToSong);
-    double songDuration();
+    void clearCallbackBuffer();
 
-    static void soundCallback(void* userdata, uint8_t* stream, int len);
+    size_t renderAudio(int16_t* output, size_t samples);
 public:
+    using TimeText = std::array<wchar_t, 16>;
+
+    // What is audible right now, from the samples the output has taken and its reported
+    // latency. elapsed never decreases within a segment; a new segment starts on play,
+    // seek and track change.
+    struct PlaybackPosition {
+        std::chrono::nanoseconds elapsed{ 0 };
+        std::chrono::nanoseconds duration{ 0 };
+        uint64_t segment = 0;
+        bool playing = false;
+        bool paused = false;
+    };
+
     SoundModule();
+    explicit SoundModule(std::unique_ptr<AudioSink> outputSink);
     ~SoundModule();
 
     void setOnSongFinishedCallback(std::function<void()> callback);
+    // Receives the track that became audible, which may differ from the one last queued.
+    void setOnSongChangedCallback(std::function<void(const std::filesystem::path&)> callback);
+    // Runs on the engine thread whenever playback starts, stops, pauses, resumes, seeks or
+    // moves to the next track, so a display can sleep while nothing changes.
+    void setOnStatusChangedCallback(std::function<void()> callback);
+    void setDurationVerification(bool enabled);
+    void setOutputFormat(int frequency, int channels);
+    void setResampleQuality(Resampler::Quality quality);
+    void setVolumeRamp(GainStage::Ramp ramp);
+    void setBufferLength(int milliseconds);
+    void setSeekCrossfade(int milliseconds);
+    // Runs on the thread that calls play() or queueNext(), never on the engine thread.
+    void setGainLookup(std::function<ReplayGain(const std::filesystem::path&)> lookup);
+    void setReplayGain(ReplayGain::Mode mode, float preampDb);
 
     void play(const std::filesystem::path& pathToSong);
+    void queueNext(const std::filesystem::path& pathToSong);
+    void clearQueue();
     void pause();
     void stop();
     double getSongDuration();
+    double getSongDuration(const std::filesystem::path& pathToSong);
     double getTimeElapsed();
+    PlaybackPosition getPlaybackPosition() const;
     double getProgress();
     bool paused();
     void seekTo(int newProgressPoint);
     void seekToSeconds(int secondsFromCurrentPoint);
     void changeVolume(int newVolume);
-    std::wstring fromDoubleToTime(const double& seconds);
+    static void formatTime(double seconds, TimeText& out);
+    // Length from the container headers or frame headers, and from a full decode.
+    static double probeSongDuration(const std::filesystem::path& pathToSong);
+    static double decodeSongDuration(const std::filesystem::path& pathToSong);
 };
\ No newline at end of file
@@ -0,0 +1,59 @@
+#include "StringPool.h"
+
+StringPool::Id StringPool::intern(std::wstring_view text) {
+    auto found = ids.find(text);
+    if (found != ids.end()) return found->second;
+
+    std::wstring_view stored = store(text);
+    Id id = static_cast<Id>(strings.size());
+    strings.push_back(stored);
+    ids.emplace(stored, id);
+    return id;
+}
+
+// Strings longer than a block get a block of their own.
+std::wstring_view StringPool::store(std::wstring_view text) {
+    if (text.empty()) return {};
+    storedCharacters += text.size();
+
+    if (text.size() > BLOCK_CHARACTERS - blockUsed) {
+        size_t capacity = std::max(text.size(), BLOCK_CHARACTERS);
+        blocks.push_back(std::make_unique<wchar_t[]>(capacity));
+        blockUsed = (capacity == BLOCK_CHARACTERS) ? 0 : BLOCK_CHARACTERS;
+        if (capacity != BLOCK_CHARACTERS) {
+            std::copy(text.begin(), text.end(), blocks.back().get());
+            return std::wstring_view(blocks.back().get(), text.size());
+        }
+    }
+
+    wchar_t* destination = blocks.back().get() + blockUsed;
+    std::copy(text.begin(), text.end(), destination);
+    blockUsed += text.size();
+    return std::wstring_view(destination, text.size());
+}
+
+std::optional<StringPool::Id> StringPool::find(std::wstring_view text) const {
+    auto found = ids.find(text);
+    if (found == ids.end()) return std::nullopt;
+    return found->second;
+}
+
+std::wstring_view StringPool::view(Id id) const {
+    return strings[id];
+}
+
+size_t StringPool::size() const {
+    return strings.size();
+}
+
+size_t StringPool::characters() const {
+    return storedCharacters;
+}
+
+void StringPool::clear() {
+    ids.clear();
+    strings.clear();
+    blocks.clear();
+    blockUsed = BLOCK_CHARACTERS;
+    storedCharacters = 0;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include "headers.hpp"
+
+// Interns wide strings into large fixed-size blocks. Each distinct string is stored once
+// and referred to by a 32-bit id; blocks never move, so ids and the views they resolve to
+// stay valid as the pool grows. Strings are only released by clear(), so an owner that drops
+// strings rebuilds the pool from the ones it still uses once characters() has grown too far.
+class StringPool {
+public:
+    using Id = uint32_t;
+private:
+    static constexpr size_t BLOCK_CHARACTERS = 64 * 1024;
+
+    std::vector<std::unique_ptr<wchar_t[]>> blocks;
+    size_t blockUsed = BLOCK_CHARACTERS;
+    size_t storedCharacters = 0;
+    std::vector<std::wstring_view> strings;
+    std::unordered_map<std::wstring_view, Id> ids;
+
+    std::wstring_view store(std::wstring_view text);
+public:
+    Id intern(std::wstring_view text);
+    std::optional<Id> find(std::wstring_view text) const;
+    std::wstring_view view(Id id) const;
+
+    size_t size() const;
+    size_t characters() const;
+    void clear();
+};
@@ -0,0 +1,124 @@
+#include "ThreadPool.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+thread_local ThreadPool* ThreadPool::currentPool = nullptr;
+thread_local size_t ThreadPool::currentWorker = 0;
+
+ThreadPool::ThreadPool(size_t threadCount, Priority priority) {
+    if (threadCount == 0) threadCount = 1;
+
+    for (size_t i = 0; i < threadCount; i++)
+        queues.push_back(std::make_unique<WorkerQueue>());
+
+    for (size_t i = 0; i < threadCount; i++)
+        workers.emplace_back([this, i, priority] { workerLoop(i, priority); });
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> sleepLock(sleepMutex);
+        stopping.store(true);
+    }
+    sleepCv.notify_all();
+
+    for (std::thread& worker : workers) {
+        if (worker.joinable()) worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    size_t queueIndex = (currentPool == this) ? currentWorker : nextQueue.fetch_add(1) % queues.size();
+
+    pendingTasks.fetch_add(1);
+    {
+        // Counted under the queue lock, so a worker never sees the count ahead of the task.
+        std::lock_guard<std::mutex> queueLock(queues[queueIndex]->mutex);
+        queues[queueIndex]->tasks.push_back(std::move(task));
+        queuedTasks.fetch_add(1);
+    }
+    {
+        // A worker checks the count under this lock before it sleeps, so taking it here means
+        // the notification cannot fall between that check and the wait.
+        std::lock_guard<std::mutex> sleepLock(sleepMutex);
+    }
+    sleepCv.notify_one();
+}
+
+void ThreadPool::waitIdle() {
+    std::unique_lock<std::mutex> sleepLock(sleepMutex);
+    idleCv.wait(sleepLock, [this] { return pendingTasks.load() == 0; });
+}
+
+size_t ThreadPool::size() const {
+    return workers.size();
+}
+
+bool ThreadPool::popTask(size_t workerIndex, std::function<void()>& task) {
+    {
+        WorkerQueue& own = *queues[workerIndex];
+        std::lock_guard<std::mutex> queueLock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            queuedTasks.fetch_sub(1);
+            return true;
+        }
+    }
+
+    for (size_t offset = 1; offset < queues.size(); offset++) {
+        WorkerQueue& victim = *queues[(workerIndex + offset) % queues.size()];
+        std::lock_guard<std::mutex> queueLock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queuedTasks.fetch_sub(1);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::workerLoop(size_t workerIndex, Priority priority) {
+    currentPool = this;
+    currentWorker = workerIndex;
+    if (priority == Priority::Background) lowerThreadPriority();
+
+    while (true) {
+        std::function<void()> task;
+        if (popTask(workerIndex, task)) {
+            task();
+            if (pendingTasks.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> sleepLock(sleepMutex);
+                idleCv.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> sleepLock(sleepMutex);
+        sleepCv.wait(sleepLock, [this] { return stopping.load() || queuedTasks.load() > 0; });
+        if (stopping.load() && queuedTasks.load() == 0) return;
+    }
+}
+
+void ThreadPool::lowerThreadPriority() {
+#ifdef _WIN32
+    // Background mode lowers the thread's I/O and memory priority along with the CPU one.
+    SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+#elif defined(__linux__)
+    sched_param parameters = {};
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &parameters);
+#else
+    sched_param parameters = {};
+    parameters.sched_priority = sched_get_priority_min(SCHED_OTHER);
+    pthread_setschedparam(pthread_self(), SCHED_OTHER, &parameters);
+#endif
+}
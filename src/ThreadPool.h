@@ -0,0 +1,44 @@
+#pragma once
+#include "headers.hpp"
+
+// Fixed set of workers, each with its own task deque. A worker pops from the back of its
+// own deque and, when that is empty, steals from the front of the others. Tasks submitted
+// from inside a worker go to that worker's deque, so recursive fan-out stays local.
+// Background pools run their workers at idle priority so they only use spare cores.
+class ThreadPool {
+public:
+    enum class Priority {
+        Normal,
+        Background
+    };
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex sleepMutex;
+    std::condition_variable sleepCv, idleCv;
+    std::atomic<size_t> queuedTasks = 0, pendingTasks = 0, nextQueue = 0;
+    std::atomic<bool> stopping = false;
+
+    static thread_local ThreadPool* currentPool;
+    static thread_local size_t currentWorker;
+
+    bool popTask(size_t workerIndex, std::function<void()>& task);
+    void workerLoop(size_t workerIndex, Priority priority);
+    static void lowerThreadPriority();
+public:
+    explicit ThreadPool(size_t threadCount = std::thread::hardware_concurrency(), Priority priority = Priority::Normal);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> task);
+    void waitIdle();
+    size_t size() const;
+};
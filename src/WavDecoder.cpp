@@ -0,0 +1,140 @@
+#include "WavDecoder.h"
+
+namespace {
+    constexpr uint16_t FORMAT_PCM = 0x0001;
+    constexpr uint16_t FORMAT_FLOAT = 0x0003;
+    constexpr uint16_t FORMAT_EXTENSIBLE = 0xFFFE;
+
+    uint32_t getLittleEndian(const uint8_t* data, int bytes) {
+        uint32_t value = 0;
+        for (int i = 0; i < bytes; i++) value |= static_cast<uint32_t>(data[i]) << (8 * i);
+        return value;
+    }
+
+    int16_t fromFloat(double value) {
+        value *= 32768.0;
+        if (value >= 32767.0) return 32767;
+        if (value <= -32768.0) return -32768;
+        return static_cast<int16_t>(std::lrint(value));
+    }
+}
+
+bool WavDecoder::open(std::unique_ptr<InputSource> source) {
+    this->source = std::move(source);
+    if (!this->source || !this->source->seek(0) || !sniff(*this->source)) return false;
+
+    uint64_t fileSize = this->source->size();
+    uint64_t offset = 12;
+    bool formatFound = false;
+
+    while (offset + 8 <= fileSize) {
+        if (!this->source->seek(offset) || this->source->fill(8) < 8) return false;
+
+        const uint8_t* header = this->source->data();
+        uint32_t chunkSize = getLittleEndian(header + 4, 4);
+
+        if (std::memcmp(header, "fmt ", 4) == 0) {
+            this->source->consume(8);
+            if (this->source->fill(chunkSize) < chunkSize || !readFormat(this->source->data(), chunkSize)) return false;
+            formatFound = true;
+        }
+        else if (std::memcmp(header, "data", 4) == 0) {
+            if (!formatFound) return false;
+
+            dataOffset = offset + 8;
+            uint64_t dataBytes = std::min<uint64_t>(chunkSize, fileSize - dataOffset);
+            if (chunkSize == 0xFFFFFFFF) dataBytes = fileSize - dataOffset;
+
+            totalFrames = dataBytes / bytesPerFrame;
+            pcm.assign(BLOCK_FRAMES * channels, 0);
+            return seek(0);
+        }
+
+        offset += 8 + static_cast<uint64_t>(chunkSize) + (chunkSize & 1);
+    }
+
+    return false;
+}
+
+bool WavDecoder::readFormat(const uint8_t* chunk, uint32_t chunkSize) {
+    if (chunkSize < 16) return false;
+
+    uint16_t formatTag = static_cast<uint16_t>(getLittleEndian(chunk, 2));
+    if (formatTag == FORMAT_EXTENSIBLE && chunkSize >= 40) formatTag = static_cast<uint16_t>(getLittleEndian(chunk + 24, 2));
+
+    channels = static_cast<int>(getLittleEndian(chunk + 2, 2));
+    sampleRate = static_cast<int>(getLittleEndian(chunk + 4, 4));
+    bytesPerFrame = getLittleEndian(chunk + 12, 2);
+    if (channels <= 0 || channels > 8 || sampleRate <= 0 || bytesPerFrame % channels != 0) return false;
+
+    // The container size decides the layout; valid bits are left-justified within it.
+    bytesPerSample = static_cast<int>(bytesPerFrame / channels);
+
+    if (formatTag == FORMAT_PCM && bytesPerSample >= 1 && bytesPerSample <= 4) encoding = Encoding::Integer;
+    else if (formatTag == FORMAT_FLOAT && (bytesPerSample == 4 || bytesPerSample == 8)) encoding = Encoding::Float;
+    else return false;
+
+    return true;
+}
+
+bool WavDecoder::decode(Block& block) {
+    if (framePosition >= totalFrames) return false;
+
+    size_t frames = static_cast<size_t>(std::min<uint64_t>(BLOCK_FRAMES, totalFrames - framePosition));
+    frames = std::min(frames, source->fill(frames * bytesPerFrame) / bytesPerFrame);
+    if (frames == 0) return false;
+
+    convertSamples(source->data(), frames * channels, pcm.data());
+    source->consume(frames * bytesPerFrame);
+    framePosition += frames;
+
+    block.samples = pcm.data();
+    block.frames = frames;
+    block.sampleRate = sampleRate;
+    block.channels = channels;
+    return true;
+}
+
+void WavDecoder::convertSamples(const uint8_t* data, size_t count, int16_t* out) const {
+    if (encoding == Encoding::Float) {
+        for (size_t i = 0; i < count; i++, data += bytesPerSample) {
+            if (bytesPerSample == 4) out[i] = fromFloat(std::bit_cast<float>(getLittleEndian(data, 4)));
+            else out[i] = fromFloat(std::bit_cast<double>(static_cast<uint64_t>(getLittleEndian(data, 4)) | static_cast<uint64_t>(getLittleEndian(data + 4, 4)) << 32));
+        }
+        return;
+    }
+
+    switch (bytesPerSample) {
+    case 1:
+        for (size_t i = 0; i < count; i++) out[i] = static_cast<int16_t>((data[i] - 128) * 256);
+        break;
+    case 2:
+        for (size_t i = 0; i < count; i++, data += 2) out[i] = static_cast<int16_t>(getLittleEndian(data, 2));
+        break;
+    default:
+        for (size_t i = 0; i < count; i++, data += bytesPerSample) out[i] = static_cast<int16_t>(getLittleEndian(data + bytesPerSample - 2, 2));
+        break;
+    }
+}
+
+bool WavDecoder::seek(uint64_t frame) {
+    framePosition = std::min(frame, totalFrames);
+    return source->seek(dataOffset + framePosition * bytesPerFrame);
+}
+
+uint64_t WavDecoder::getTotalFrames() {
+    return totalFrames;
+}
+
+int WavDecoder::getSampleRate() const {
+    return sampleRate;
+}
+
+const char* WavDecoder::getFormatName() const {
+    return "wav";
+}
+
+bool WavDecoder::sniff(InputSource& source) {
+    if (source.fill(12) < 12) return false;
+    return std::memcmp(source.data(), "RIFF", 4) == 0 && std::memcmp(source.data() + 8, "WAVE", 4) == 0;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "headers.hpp"
+#include "AudioDecoder.h"
+
+// RIFF/WAVE backend for uncompressed audio: 8/16/24/32-bit integer and 32/64-bit float PCM,
+// plain or WAVE_FORMAT_EXTENSIBLE. Samples are converted to int16 a block at a time, and a
+// seek is a single byte offset, so it is sample-exact by construction.
+class WavDecoder : public AudioDecoder {
+private:
+    enum class Encoding {
+        Integer,
+        Float
+    };
+
+    static constexpr size_t BLOCK_FRAMES = 4096;
+
+    std::unique_ptr<InputSource> source;
+    std::vector<int16_t> pcm;
+    Encoding encoding = Encoding::Integer;
+    int sampleRate = 0, channels = 0, bytesPerSample = 0;
+    size_t bytesPerFrame = 0;
+    uint64_t dataOffset = 0, totalFrames = 0, framePosition = 0;
+
+    bool readFormat(const uint8_t* chunk, uint32_t chunkSize);
+    void convertSamples(const uint8_t* data, size_t count, int16_t* out) const;
+public:
+    bool open(std::unique_ptr<InputSource> source) override;
+    bool decode(Block& block) override;
+    bool seek(uint64_t frame) override;
+
+    uint64_t getTotalFrames() override;
+    int getSampleRate() const override;
+    const char* getFormatName() const override;
+
+    static bool sniff(InputSource& source);
+};
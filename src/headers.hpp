@@ -7,8 +7,10 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include <array>
 #include <filesystem>
 #include <fstream>
@@ -17,9 +19,19 @@
 #include <atomic>
 #include <optional>
 #include <list>
+#include <deque>
+#include <functional>
+#include <utility>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <bit>
+#include <chrono>
 #include <condition_variable>
 #include <mutex>
 #include <random>
+#include <limits>
+#include <map>
 
 // UI HEADERS
 
@@ -1,7 +1,29 @@
 ﻿#include "headers.hpp"
 #include "Player.hpp"
+#include "OfflineRenderer.h"
+#include "DecoderBenchmark.h"
+#include "RenderBenchmark.h"
+#include "SearchBenchmark.h"
+#include "LibraryBenchmark.h"
+#include "DspBenchmark.h"
+#include "LoudnessAnalyzer.h"
+#include "SelfTest.h"
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> arguments(argv + 1, argv + argc);
+    if (!arguments.empty() && arguments[0] == "--render") return OfflineRenderer::runCommandLine(arguments);
+    if (!arguments.empty() && arguments[0] == "--bench-decode") return DecoderBenchmark::runCommandLine(arguments);
+    if (!arguments.empty() && arguments[0] == "--bench-tags") return DecoderBenchmark::runTagCommandLine(arguments);
+    if (!arguments.empty() && arguments[0] == "--bench-duration") return DecoderBenchmark::runDurationCommandLine(arguments);
+    if (!arguments.empty() && arguments[0] == "--bench-render") return RenderBenchmark::runCommandLine(arguments);
+    if (!arguments.empty() && arguments[0] == "--bench-search") return SearchBenchmark::runCommandLine(arguments);
+    if (!arguments.empty() && arguments[0] == "--bench-startup") return LibraryBenchmark::runStartupCommandLine(arguments);
+    if (!arguments.empty() && arguments[0] == "--bench-scan") return LibraryBenchmark::runScalingCommandLine(arguments);
+    if (!arguments.empty() && arguments[0] == "--bench-resample") return DspBenchmark::runResampleCommandLine(arguments);
+    if (!arguments.empty() && arguments[0] == "--bench-gain") return DspBenchmark::runGainCommandLine(arguments);
+    if (!arguments.empty() && arguments[0] == "--analyze-gain") return LoudnessAnalyzer::runCommandLine(arguments);
+    if (!arguments.empty() && arguments[0] == "--self-test") return SelfTest::runCommandLine(arguments);
 
-int main() {
     Player player;
     return 0;
 }
\ No newline at end of file